@@ -0,0 +1,152 @@
+#include "Allocations.h"
+#include <cstdlib>
+#include <new>
+
+namespace {
+
+// Plain pointer, so reading it from operator new never runs a thread_local constructor.
+thread_local Allocations::Scope* currentScope = nullptr;
+
+}
+
+Allocations::Scope::Scope() : parent(currentScope) {
+    currentScope = this;
+}
+
+Allocations::Scope::~Scope() {
+    // Nested scopes also count towards the enclosing one, e.g. an operation called by another.
+    currentScope = parent;
+    if (parent) {
+        parent->allocations.fetch_add(allocations.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        parent->bytes.fetch_add(bytes.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    }
+}
+
+Allocations::Adopt::Adopt(Scope* scope) : previous(currentScope) {
+    currentScope = scope;
+}
+
+Allocations::Adopt::~Adopt() {
+    currentScope = previous;
+}
+
+Allocations::Scope* Allocations::current() {
+    return currentScope;
+}
+
+#ifdef NLP_COUNT_ALLOCATIONS
+
+// Replacements of every form of the global allocation functions, so memory from malloc never
+// reaches a default operator delete.
+namespace {
+
+void* allocate(size_t size) {
+    if (Allocations::Scope* scope = currentScope) scope->add(size);
+    return std::malloc(size ? size : 1);
+}
+
+void* allocateAligned(size_t size, std::align_val_t alignment) {
+    if (Allocations::Scope* scope = currentScope) scope->add(size);
+    size_t align = static_cast<size_t>(alignment);
+#ifdef _WIN32
+    return _aligned_malloc(size ? size : 1, align);
+#else
+    // aligned_alloc wants a non-zero multiple of the alignment.
+    size_t rounded = size == 0 ? align : (size + align - 1) / align * align;
+    return std::aligned_alloc(align, rounded);
+#endif
+}
+
+void releaseAligned(void* p) {
+#ifdef _WIN32
+    _aligned_free(p);
+#else
+    std::free(p);
+#endif
+}
+
+}
+
+void* operator new(size_t size) {
+    if (void* p = allocate(size)) return p;
+    throw std::bad_alloc();
+}
+
+void* operator new[](size_t size) {
+    return operator new(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+    return allocate(size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+    return allocate(size);
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void* p, size_t) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, const std::nothrow_t&) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void* p, const std::nothrow_t&) noexcept {
+    std::free(p);
+}
+
+void* operator new(size_t size, std::align_val_t alignment) {
+    if (void* p = allocateAligned(size, alignment)) return p;
+    throw std::bad_alloc();
+}
+
+void* operator new[](size_t size, std::align_val_t alignment) {
+    return operator new(size, alignment);
+}
+
+void* operator new(size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    return allocateAligned(size, alignment);
+}
+
+void* operator new[](size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    return allocateAligned(size, alignment);
+}
+
+void operator delete(void* p, std::align_val_t) noexcept {
+    releaseAligned(p);
+}
+
+void operator delete[](void* p, std::align_val_t) noexcept {
+    releaseAligned(p);
+}
+
+void operator delete(void* p, size_t, std::align_val_t) noexcept {
+    releaseAligned(p);
+}
+
+void operator delete[](void* p, size_t, std::align_val_t) noexcept {
+    releaseAligned(p);
+}
+
+void operator delete(void* p, std::align_val_t, const std::nothrow_t&) noexcept {
+    releaseAligned(p);
+}
+
+void operator delete[](void* p, std::align_val_t, const std::nothrow_t&) noexcept {
+    releaseAligned(p);
+}
+
+#endif
@@ -0,0 +1,64 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+struct AllocationStats {
+    uint64_t allocations = 0;
+    uint64_t bytes = 0;
+};
+
+// Opt-in allocation accounting. Built with NLP_COUNT_ALLOCATIONS, the library replaces the global
+// operator new and charges every allocation to the innermost Scope of the allocating thread; tasks
+// run by a ThreadPool are charged to the scope that enqueued them, so they must finish before it ends
+// (long-lived tasks are enqueued with no scope, see ThreadPool::enqueue). Metrics::Timer opens a
+// scope per operation. Without the option nothing is counted and every Scope reports 0.
+//
+//     Allocations::Scope scope;
+//     tokenizer.batchEncode(sentences, 8, "");
+//     AllocationStats stats = scope.stats();         // Includes the pool workers' allocations.
+class Allocations {
+public:
+#ifdef NLP_COUNT_ALLOCATIONS
+    static constexpr bool enabled = true;
+#else
+    static constexpr bool enabled = false;
+#endif
+
+    class Scope {
+    private:
+        std::atomic<uint64_t> allocations{ 0 };
+        std::atomic<uint64_t> bytes{ 0 };
+        Scope* parent;
+
+    public:
+        Scope();
+        ~Scope();
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+        void add(size_t size) {
+            allocations.fetch_add(1, std::memory_order_relaxed);
+            bytes.fetch_add(size, std::memory_order_relaxed);
+        }
+
+        AllocationStats stats() const {
+            return AllocationStats{ allocations.load(std::memory_order_relaxed), bytes.load(std::memory_order_relaxed) };
+        }
+    };
+
+    // Makes `scope` the current scope of this thread while in scope; used by ThreadPool to run a task
+    // under the scope of the thread that enqueued it.
+    class Adopt {
+    private:
+        Scope* previous;
+
+    public:
+        explicit Adopt(Scope* scope);
+        ~Adopt();
+        Adopt(const Adopt&) = delete;
+        Adopt& operator=(const Adopt&) = delete;
+    };
+
+    static Scope* current();
+};
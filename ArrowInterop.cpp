@@ -0,0 +1,217 @@
+#include "ArrowInterop.h"
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+namespace {
+
+// Private data of every exported array node. The owner keeps the C++ buffers alive; a node's
+// children are allocated with it and released with it unless the consumer moved them out.
+struct ArrayHolder {
+    std::shared_ptr<const void> owner;
+    const void* buffers[3] = {};
+    ArrowArray* children[1] = {};
+};
+
+void releaseArray(ArrowArray* array) {
+    auto* holder = static_cast<ArrayHolder*>(array->private_data);
+    for (int64_t i = 0; i < array->n_children; ++i) {
+        ArrowArray* child = array->children[i];
+        if (child->release) child->release(child);
+        delete child;
+    }
+    delete holder;
+    array->release = nullptr;
+}
+
+void fillArray(ArrowArray* out, std::shared_ptr<const void> owner, int64_t length, std::vector<const void*> buffers, ArrowArray* child = nullptr) {
+    auto* holder = new ArrayHolder();
+    holder->owner = std::move(owner);
+    for (size_t i = 0; i < buffers.size(); ++i) holder->buffers[i] = buffers[i];
+    holder->children[0] = child;
+
+    out->length = length;
+    out->null_count = 0;
+    out->offset = 0;
+    out->n_buffers = static_cast<int64_t>(buffers.size());
+    out->n_children = child ? 1 : 0;
+    out->buffers = holder->buffers;
+    out->children = child ? holder->children : nullptr;
+    out->dictionary = nullptr;
+    out->release = releaseArray;
+    out->private_data = holder;
+}
+
+struct SchemaHolder {
+    ArrowSchema* children[1] = {};
+};
+
+void releaseSchema(ArrowSchema* schema) {
+    auto* holder = static_cast<SchemaHolder*>(schema->private_data);
+    for (int64_t i = 0; i < schema->n_children; ++i) {
+        ArrowSchema* child = schema->children[i];
+        if (child->release) child->release(child);
+        delete child;
+    }
+    delete holder;
+    schema->release = nullptr;
+}
+
+void fillSchema(ArrowSchema* out, const char* format, const char* name, ArrowSchema* child = nullptr) {
+    // Formats and names are string literals, valid for the whole program.
+    auto* holder = new SchemaHolder();
+    holder->children[0] = child;
+
+    out->format = format;
+    out->name = name;
+    out->metadata = nullptr;
+    out->flags = 0;
+    out->n_children = child ? 1 : 0;
+    out->children = child ? holder->children : nullptr;
+    out->dictionary = nullptr;
+    out->release = releaseSchema;
+    out->private_data = holder;
+}
+
+// Arrow's large types use int64 offsets, which our size_t offsets already are on 64-bit targets.
+// Elsewhere they are widened into a vector kept next to the exported data.
+const void* int64Offsets(std::vector<size_t>& offsets, std::vector<int64_t>& widened) {
+    if (offsets.empty()) offsets.push_back(0);
+    if constexpr (sizeof(size_t) == sizeof(int64_t)) {
+        return offsets.data();
+    }
+    else {
+        widened.assign(offsets.begin(), offsets.end());
+        return widened.data();
+    }
+}
+
+template <class T>
+struct Exported {
+    T value;
+    std::vector<int64_t> widenedOffsets;
+    std::vector<int64_t> widenedChildOffsets;
+};
+
+template <class Offset>
+void importViews(const ArrowArray& array, std::vector<std::string_view>& views) {
+    const uint8_t* validity = static_cast<const uint8_t*>(array.buffers[0]);
+    const Offset* offsets = static_cast<const Offset*>(array.buffers[1]);
+    const char* data = static_cast<const char*>(array.buffers[2]);
+
+    views.reserve(static_cast<size_t>(array.length));
+    for (int64_t i = 0; i < array.length; ++i) {
+        int64_t j = array.offset + i;
+        if (array.null_count != 0 && validity && !(validity[j / 8] & (1 << (j % 8)))) {
+            views.emplace_back();
+            continue;
+        }
+        views.emplace_back(data + offsets[j], static_cast<size_t>(offsets[j + 1] - offsets[j]));
+    }
+}
+
+}
+
+std::vector<std::string_view> Arrow::importStrings(const ArrowSchema& schema, const ArrowArray& array) {
+    /*
+    Input:
+        - schema, array: An Arrow string or binary array ("u", "U", "z" or "Z") as exported through the C Data Interface.
+    Output:
+        - One view per element, pointing into the array's data buffer. Null elements become empty views.
+    Functionality:
+        - Nothing is copied: the views are valid until the producer's array is released.
+        - Throws `std::invalid_argument` for other types (e.g. dictionary or string-view arrays).
+    */
+
+    if (!array.release) {
+        throw std::invalid_argument("Arrow: the array was already released.");
+    }
+
+    std::string format = schema.format ? schema.format : "";
+    if (schema.dictionary || array.n_buffers != 3) {
+        throw std::invalid_argument("Arrow: expected a plain string array, got format '" + format + "'.");
+    }
+
+    std::vector<std::string_view> views;
+    if (format == "u" || format == "z") {
+        importViews<int32_t>(array, views);
+    }
+    else if (format == "U" || format == "Z") {
+        importViews<int64_t>(array, views);
+    }
+    else {
+        throw std::invalid_argument("Arrow: expected a utf8 or binary array, got format '" + format + "'.");
+    }
+    return views;
+}
+
+void Arrow::exportStrings(StringBatch&& batch, ArrowSchema* schema, ArrowArray* array) {
+    /*
+    Input:
+        - batch: The strings to export. It is moved into the exported array.
+        - schema, array: Receive a large_utf8 ("U") array. The consumer owns them and must call their release callbacks.
+    Functionality:
+        - The array's offsets and data buffers are the batch's own vectors; nothing is copied.
+    */
+
+    auto exported = std::make_shared<Exported<StringBatch>>();
+    exported->value = std::move(batch);
+    const void* offsets = int64Offsets(exported->value.offsets, exported->widenedOffsets);
+    int64_t length = static_cast<int64_t>(exported->value.size());
+    const void* data = exported->value.data.data();
+
+    fillArray(array, exported, length, { nullptr, offsets, data });
+    fillSchema(schema, "U", "");
+}
+
+void Arrow::exportLists(TokenizedBatch&& batch, ArrowSchema* schema, ArrowArray* array) {
+    /*
+    Input:
+        - batch: Tokenized texts. They are moved into the exported array.
+        - schema, array: Receive a large_list<large_utf8> ("+L" of "U") array with one list of tokens per text.
+    Functionality:
+        - The list offsets, token offsets and token bytes are the batch's own vectors; nothing is copied.
+    */
+
+    auto exported = std::make_shared<Exported<TokenizedBatch>>();
+    exported->value = std::move(batch);
+    const void* listOffsets = int64Offsets(exported->value.textOffsets, exported->widenedOffsets);
+    const void* tokenOffsets = int64Offsets(exported->value.tokens.offsets, exported->widenedChildOffsets);
+    int64_t numTexts = static_cast<int64_t>(exported->value.textOffsets.size() - 1);
+    int64_t numTokens = static_cast<int64_t>(exported->value.tokens.size());
+    const void* data = exported->value.tokens.data.data();
+
+    auto* child = new ArrowArray();
+    fillArray(child, exported, numTokens, { nullptr, tokenOffsets, data });
+    fillArray(array, exported, numTexts, { nullptr, listOffsets }, child);
+
+    auto* childSchema = new ArrowSchema();
+    fillSchema(childSchema, "U", "item");
+    fillSchema(schema, "+L", "", childSchema);
+}
+
+void Arrow::exportLists(EncodedBuffer&& buffer, ArrowSchema* schema, ArrowArray* array) {
+    /*
+    Input:
+        - buffer: Encoded texts. They are moved into the exported array.
+        - schema, array: Receive a large_list<int32> ("+L" of "i") array with one list of IDs per text.
+    Functionality:
+        - The list offsets and IDs are the buffer's own vectors; nothing is copied.
+    */
+
+    auto exported = std::make_shared<Exported<EncodedBuffer>>();
+    exported->value = std::move(buffer);
+    const void* listOffsets = int64Offsets(exported->value.offsets, exported->widenedOffsets);
+    int64_t numTexts = static_cast<int64_t>(exported->value.offsets.size() - 1);
+    int64_t numIds = static_cast<int64_t>(exported->value.ids.size());
+    const void* ids = exported->value.ids.data();
+
+    auto* child = new ArrowArray();
+    fillArray(child, exported, numIds, { nullptr, ids });
+    fillArray(array, exported, numTexts, { nullptr, listOffsets }, child);
+
+    auto* childSchema = new ArrowSchema();
+    fillSchema(childSchema, "i", "item");
+    fillSchema(schema, "+L", "", childSchema);
+}
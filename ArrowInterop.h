@@ -0,0 +1,69 @@
+#pragma once
+#include <cstdint>
+#include <string_view>
+#include <vector>
+#include "Toolkit.h"
+#include "Tokenizer.h"
+
+// Arrow C Data Interface (https://arrow.apache.org/docs/format/CDataInterface.html).
+// The structs are ABI-stable and defined by the spec itself, so no Arrow library is needed.
+#ifndef ARROW_C_DATA_INTERFACE
+#define ARROW_C_DATA_INTERFACE
+
+#define ARROW_FLAG_DICTIONARY_ORDERED 1
+#define ARROW_FLAG_NULLABLE 2
+#define ARROW_FLAG_MAP_KEYS_SORTED 4
+
+struct ArrowSchema {
+    const char* format;
+    const char* name;
+    const char* metadata;
+    int64_t flags;
+    int64_t n_children;
+    struct ArrowSchema** children;
+    struct ArrowSchema* dictionary;
+    void (*release)(struct ArrowSchema*);
+    void* private_data;
+};
+
+struct ArrowArray {
+    int64_t length;
+    int64_t null_count;
+    int64_t offset;
+    int64_t n_buffers;
+    int64_t n_children;
+    const void** buffers;
+    struct ArrowArray** children;
+    struct ArrowArray* dictionary;
+    void (*release)(struct ArrowArray*);
+    void* private_data;
+};
+
+#endif
+
+#ifndef ARROW_C_STREAM_INTERFACE
+#define ARROW_C_STREAM_INTERFACE
+
+struct ArrowArrayStream {
+    int (*get_schema)(struct ArrowArrayStream*, struct ArrowSchema* out);
+    int (*get_next)(struct ArrowArrayStream*, struct ArrowArray* out);
+    const char* (*get_last_error)(struct ArrowArrayStream*);
+    void (*release)(struct ArrowArrayStream*);
+    void* private_data;
+};
+
+#endif
+
+// Moves text columns in and out of the toolkit in Arrow layout without copying them.
+// Imports borrow the producer's buffers; exports hand our buffers to the consumer, which frees
+// them through the release callback.
+class Arrow {
+public:
+    static std::vector<std::string_view> importStrings(const ArrowSchema& schema, const ArrowArray& array);
+
+    static void exportStrings(StringBatch&& batch, ArrowSchema* schema, ArrowArray* array);
+
+    static void exportLists(TokenizedBatch&& batch, ArrowSchema* schema, ArrowArray* array);
+
+    static void exportLists(EncodedBuffer&& buffer, ArrowSchema* schema, ArrowArray* array);
+};
@@ -0,0 +1,73 @@
+#pragma once
+#include <queue>
+#include <mutex>
+#include <condition_variable>
+
+template <class T>
+class BoundedQueue {
+private:
+    std::queue<T> items;
+    std::mutex queueMutex;
+    std::condition_variable notFull;
+    std::condition_variable notEmpty;
+    size_t capacity;
+    bool closed = false;
+
+public:
+    explicit BoundedQueue(size_t capacity) : capacity(capacity == 0 ? 1 : capacity) {}
+
+    bool push(T item) {
+        /*
+        Input:
+            - item: The element to append to the queue.
+        Output:
+            - true if the item was queued, false if the queue has been closed.
+        Functionality:
+            - Blocks while the queue holds `capacity` items, so a fast producer cannot run ahead of its consumers.
+        */
+
+        std::unique_lock<std::mutex> lock(queueMutex);
+        notFull.wait(lock, [this]() { return closed || items.size() < capacity; });
+        if (closed) return false;
+
+        items.push(std::move(item));
+        lock.unlock();
+        notEmpty.notify_one();
+        return true;
+    }
+
+    bool pop(T& item) {
+        /*
+        Input:
+            - item: Receives the front element.
+        Output:
+            - true if an item was taken, false once the queue is closed and drained.
+        Functionality:
+            - Blocks while the queue is empty and still open.
+        */
+
+        std::unique_lock<std::mutex> lock(queueMutex);
+        notEmpty.wait(lock, [this]() { return closed || !items.empty(); });
+        if (items.empty()) return false;
+
+        item = std::move(items.front());
+        items.pop();
+        lock.unlock();
+        notFull.notify_one();
+        return true;
+    }
+
+    void close() {
+        /*
+        Functionality:
+            - Rejects further pushes and wakes every waiting thread. Items already queued can still be popped.
+        */
+
+        {
+            std::unique_lock<std::mutex> lock(queueMutex);
+            closed = true;
+        }
+        notFull.notify_all();
+        notEmpty.notify_all();
+    }
+};
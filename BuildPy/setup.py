@@ -1,17 +1,25 @@
 from setuptools import setup
 from pybind11.setup_helpers import Pybind11Extension, build_ext
+import glob
 import os
+import sys
+
+# The extension is built straight from the library sources at the repository root, so the
+# package always matches the C++ build; main.cpp is the benchmark harness and is left out.
+root = os.path.abspath(os.path.join(os.path.dirname(__file__), ".."))
+sources = sorted(
+    path for path in glob.glob(os.path.join(root, "*.cpp"))
+    if os.path.basename(path) != "main.cpp"
+)
 
 ext_modules = [
     Pybind11Extension(
-        "pynlptoolkit", 
-        [
-            "pynlptoolkit/pybind_Toolkit.cpp",  
-            "pynlptoolkit/Toolkit.cpp",      
-            "pynlptoolkit/Tokenizer.cpp",     
-        ],
-        include_dirs=["pynlptoolkit"],  
-        cxx_std=17, 
+        "pynlptoolkit",
+        sources,
+        include_dirs=[root],
+        # shm_open / shm_unlink live in librt before glibc 2.34.
+        libraries=["rt"] if sys.platform.startswith("linux") else [],
+        cxx_std=17,
     ),
 ]
 
@@ -0,0 +1,53 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <stdexcept>
+#include <algorithm>
+#include <cstring>
+#include <cstdint>
+
+// Helpers for the binary Vocabulary and Tokenizer formats. Values are stored in native byte
+// order and every array starts on an 8-byte boundary, so a mapped image can be read in place.
+namespace ByteIO {
+
+inline size_t padded(size_t bytes) { return (bytes + 7) & ~size_t(7); }
+
+template <class T>
+void append(std::string& out, const T* values, size_t count) {
+    out.append(reinterpret_cast<const char*>(values), count * sizeof(T));
+    out.append(padded(out.size()) - out.size(), '\0');
+}
+
+template <class T>
+void append(std::string& out, T value) { append(out, &value, 1); }
+
+// Reads an image written with append(). Every read is bounds checked and throws
+// std::runtime_error on truncated data.
+class Reader {
+private:
+    std::string_view data;
+    size_t& pos;
+
+public:
+    Reader(std::string_view data, size_t& pos) : data(data), pos(pos) {}
+
+    // Address of the next `count` values, advancing past them and their padding.
+    template <class T>
+    const T* take(size_t count) {
+        if (count > (data.size() - std::min(pos, data.size())) / sizeof(T)) {
+            throw std::runtime_error("Binary data is truncated or corrupt.");
+        }
+        const char* at = data.data() + pos;
+        pos = std::min(padded(pos + count * sizeof(T)), data.size());
+        return reinterpret_cast<const T*>(at);
+    }
+
+    template <class T>
+    T read() {
+        T value;
+        std::memcpy(&value, take<T>(1), sizeof(T));
+        return value;
+    }
+};
+
+}
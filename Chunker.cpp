@@ -0,0 +1,153 @@
+#include "Chunker.h"
+#include "ThreadPool.h"
+#include "Toolkit.h"
+#include <algorithm>
+#include <future>
+#include <stdexcept>
+#include <thread>
+
+namespace {
+
+bool endsSentence(const std::string& text, const std::vector<TokenSpan>& spans, size_t k) {
+    // True if a sentence or paragraph ends between token k - 1 and token k.
+    for (size_t i = spans[k - 1].end; i + 1 < spans[k].begin; ++i) {
+        if (text[i] == '\n' && text[i + 1] == '\n') return true;
+    }
+
+    size_t end = spans[k - 1].end;
+    while (end > spans[k - 1].begin && std::string("\"')]").find(text[end - 1]) != std::string::npos) --end;
+    return end > spans[k - 1].begin && (text[end - 1] == '.' || text[end - 1] == '!' || text[end - 1] == '?');
+}
+
+std::vector<std::string> chunkTexts(const std::string& text, const ChunkedDocument& document) {
+    std::vector<std::string> texts;
+    for (const auto& chunk : document.chunks) {
+        texts.push_back(text.substr(chunk.charBegin, chunk.charEnd - chunk.charBegin));
+    }
+    return texts;
+}
+
+}
+
+Chunker::Chunker(const Tokenizer& tokenizer, const ChunkerOptions& options) : tokenizer(tokenizer), options(options) {
+    /*
+    Input:
+        - tokenizer: The Tokenizer used to encode documents. It must outlive the Chunker.
+        - options: Chunk size, overlap and boundary preference (see ChunkerOptions).
+    Output:
+        - Constructs the chunker. Throws `std::invalid_argument` if maxTokens is 0 or overlapTokens >= maxTokens.
+    */
+
+    if (this->options.maxTokens == 0 || this->options.overlapTokens >= this->options.maxTokens) {
+        throw std::invalid_argument("Chunker: maxTokens must be positive and larger than overlapTokens.");
+    }
+}
+
+ChunkedDocument Chunker::chunkText(const std::string& text) const {
+    ChunkedDocument document;
+    std::vector<TokenSpan> spans;
+    tokenizer.encodeTextInto(text, document.ids, spans);
+
+    size_t numTokens = document.ids.size();
+    size_t start = 0;
+    while (start < numTokens) {
+        size_t end = std::min(start + options.maxTokens, numTokens);
+        if (end < numTokens && options.preferSentenceBoundaries) {
+            // Only in the last half, and late enough that the next chunk still gets at least half the
+            // new tokens a full window would give; a large overlap would otherwise advance by one token.
+            size_t fresh = options.maxTokens - options.overlapTokens;
+            size_t lowest = start + std::max<size_t>({ options.maxTokens / 2, options.overlapTokens + fresh / 2, 1 });
+            for (size_t k = end; k > lowest; --k) {
+                if (endsSentence(text, spans, k)) {
+                    end = k;
+                    break;
+                }
+            }
+        }
+
+        document.chunks.push_back(Chunk{ start, end, spans[start].begin, spans[end - 1].end });
+        if (end == numTokens) break;
+        start = end - options.overlapTokens;
+    }
+    return document;
+}
+
+ChunkedDocument Chunker::chunk(const std::string& text, const std::string& logFile) const {
+    /*
+    Input:
+        - text: The document to split.
+        - logFile: A string specifying the name of the file to write the output to (default is "Outputs.txt", don't write if logFile = "").
+    Output:
+        - The document's IDs and its chunks. A document without tokens has no chunks.
+    Functionality:
+        - Encodes the document once with encodeText, keeping the byte range of every token.
+        - Each chunk takes up to maxTokens tokens. When preferSentenceBoundaries is set and the window
+          does not reach the end of the document, the chunk is cut after the last sentence end (. ! ?,
+          optionally followed by a quote or bracket) or paragraph break within its last half. A break so
+          early that the next chunk would gain fewer than half of maxTokens - overlapTokens new tokens is
+          ignored, so every chunk moves the window forward by at least that much.
+        - The next chunk starts overlapTokens before the end of the previous one.
+    */
+
+    ChunkedDocument document = chunkText(text);
+
+    if (logFile.empty()) {
+        writeToFile("Chunk", std::string(), logFile);
+    }
+    else {
+        writeToFile("Chunk", chunkTexts(text, document), logFile);
+    }
+    return document;
+}
+
+std::vector<ChunkedDocument> Chunker::batchChunk(const std::vector<std::string>& texts, int numThreads, const std::string& logFile) const {
+    /*
+    Input:
+        - texts: A batch of documents.
+        - numThreads: The number of threads to use for processing (default is 2 and -1 is get all).
+        - logFile: A string specifying the name of the file to write the output to (default is "Outputs.txt", don't write if logFile = "").
+    Output:
+        - The chunked documents, in input order.
+    Functionality:
+        - Runs chunk over blocks of documents in parallel.
+    */
+
+    size_t numTexts = texts.size();
+    size_t maxThreads = std::thread::hardware_concurrency();
+
+    if (numThreads <= 0 || numThreads > static_cast<int>(maxThreads)) {
+        numThreads = maxThreads;
+    }
+
+    size_t blockSize = (numTexts + numThreads - 1) / numThreads;
+    std::vector<ChunkedDocument> results(numTexts);
+    ThreadPool pool(numThreads);
+    std::vector<std::future<void>> futures;
+
+    for (int t = 0; t < numThreads; ++t) {
+        size_t start = std::min(t * blockSize, numTexts);
+        size_t end = std::min(start + blockSize, numTexts);
+
+        futures.push_back(pool.enqueue([this, &texts, &results, start, end]() {
+            for (size_t i = start; i < end; ++i) {
+                results[i] = this->chunkText(texts[i]);
+            }
+            }));
+    }
+
+    for (auto& future : futures) {
+        future.get();
+    }
+
+    if (logFile.empty()) {
+        writeToFile("Batch Chunk", std::string(), logFile);
+    }
+    else {
+        std::vector<std::vector<std::string>> chunks;
+        for (size_t i = 0; i < numTexts; ++i) {
+            chunks.push_back(chunkTexts(texts[i], results[i]));
+        }
+        writeToFile("Batch Chunk", chunks, logFile);
+    }
+    return results;
+}
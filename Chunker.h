@@ -0,0 +1,40 @@
+#pragma once
+#include <string>
+#include <vector>
+#include "Tokenizer.h"
+
+struct ChunkerOptions {
+    size_t maxTokens = 512;                 // Upper bound on the tokens of a chunk.
+    size_t overlapTokens = 64;              // Tokens a chunk shares with the previous one; must be below maxTokens.
+    bool preferSentenceBoundaries = true;   // End chunks after a sentence or paragraph when one is in the last half.
+};
+
+struct Chunk {
+    size_t tokenBegin = 0;                  // Chunk IDs are ids[tokenBegin, tokenEnd).
+    size_t tokenEnd = 0;
+    size_t charBegin = 0;                   // Chunk text is text[charBegin, charEnd), in bytes.
+    size_t charEnd = 0;
+};
+
+struct ChunkedDocument {
+    std::vector<int> ids;                   // The whole document, encoded once.
+    std::vector<Chunk> chunks;
+};
+
+// Splits documents into overlapping windows of at most `maxTokens` tokens for retrieval.
+// Each document is encoded once; chunks are offsets into its IDs and its text, so no ID
+// or character is copied per chunk.
+class Chunker {
+private:
+    const Tokenizer& tokenizer;
+    ChunkerOptions options;
+
+    ChunkedDocument chunkText(const std::string& text) const;
+
+public:
+    Chunker(const Tokenizer& tokenizer, const ChunkerOptions& options = ChunkerOptions());
+
+    ChunkedDocument chunk(const std::string& text, const std::string& logFile = "Outputs.txt") const;
+
+    std::vector<ChunkedDocument> batchChunk(const std::vector<std::string>& texts, int numThreads = 2, const std::string& logFile = "Outputs.txt") const;
+};
@@ -0,0 +1,84 @@
+#include "DLPackInterop.h"
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+
+// manager_ctx of every export: keeps the buffer and the shape alive until the consumer calls the deleter.
+struct ExportContext {
+    DLManagedTensor managed{};
+    std::shared_ptr<void> owner;
+    std::vector<int64_t> shape;
+};
+
+void deleteExport(DLManagedTensor* managed) {
+    delete static_cast<ExportContext*>(managed->manager_ctx);
+}
+
+size_t elementCount(const std::vector<int64_t>& shape) {
+    size_t count = 1;
+    for (int64_t extent : shape) {
+        if (extent < 0) throw std::invalid_argument("Tensor extents must not be negative.");
+        count *= static_cast<size_t>(extent);
+    }
+    return count;
+}
+
+template <class T>
+std::shared_ptr<void> adopt(std::vector<T>&& values, const std::vector<int64_t>& shape, void*& data) {
+    if (elementCount(shape) != values.size()) {
+        throw std::invalid_argument("Tensor shape does not match the number of values.");
+    }
+    auto owned = std::make_shared<std::vector<T>>(std::move(values));
+    data = owned->data();
+    return owned;
+}
+
+}
+
+HostTensor::HostTensor(std::vector<int>&& values, std::vector<int64_t> shape) : dtype{ kDLInt, 32, 1 }, shape(std::move(shape)) {
+    owner = adopt(std::move(values), this->shape, data);
+}
+
+HostTensor::HostTensor(std::vector<float>&& values, std::vector<int64_t> shape) : dtype{ kDLFloat, 32, 1 }, shape(std::move(shape)) {
+    owner = adopt(std::move(values), this->shape, data);
+}
+
+size_t HostTensor::numBytes() const {
+    return elementCount(shape) * dtype.bits / 8;
+}
+
+DLManagedTensor* HostTensor::toDLPack(bool copy) const {
+    /*
+    Input:
+        - copy: Export a private copy of the elements instead of sharing them (default is no).
+    Output:
+        - A DLManagedTensor the consumer owns and frees through its deleter. Strides are left null,
+          which DLPack defines as compact row-major.
+    */
+
+    auto* context = new ExportContext();
+    context->shape = shape;
+    void* exported = data;
+    if (copy) {
+        auto bytes = std::make_shared<std::vector<unsigned char>>(numBytes());
+        if (!bytes->empty()) std::memcpy(bytes->data(), data, bytes->size());
+        exported = bytes->data();
+        context->owner = bytes;
+    }
+    else {
+        context->owner = owner;
+    }
+
+    DLTensor& tensor = context->managed.dl_tensor;
+    tensor.data = exported;
+    tensor.device = DLDevice{ kDLCPU, 0 };
+    tensor.ndim = static_cast<int32_t>(context->shape.size());
+    tensor.dtype = dtype;
+    tensor.shape = context->shape.data();
+    tensor.strides = nullptr;
+    tensor.byte_offset = 0;
+    context->managed.manager_ctx = context;
+    context->managed.deleter = deleteExport;
+    return &context->managed;
+}
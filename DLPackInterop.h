@@ -0,0 +1,69 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// DLPack (https://dmlc.github.io/dlpack/latest/c_api.html), the unversioned ABI every framework
+// accepts. Only what host tensors need is declared; the layout matches dlpack.h, which takes
+// precedence when it is included first.
+#ifndef DLPACK_DLPACK_H_
+#define DLPACK_DLPACK_H_
+
+typedef enum {
+    kDLCPU = 1,
+} DLDeviceType;
+
+typedef struct {
+    DLDeviceType device_type;
+    int32_t device_id;
+} DLDevice;
+
+typedef enum {
+    kDLInt = 0U,
+    kDLUInt = 1U,
+    kDLFloat = 2U,
+} DLDataTypeCode;
+
+typedef struct {
+    uint8_t code;
+    uint8_t bits;
+    uint16_t lanes;
+} DLDataType;
+
+typedef struct {
+    void* data;
+    DLDevice device;
+    int32_t ndim;
+    DLDataType dtype;
+    int64_t* shape;
+    int64_t* strides;
+    uint64_t byte_offset;
+} DLTensor;
+
+typedef struct DLManagedTensor {
+    DLTensor dl_tensor;
+    void* manager_ctx;
+    void (*deleter)(struct DLManagedTensor* self);
+} DLManagedTensor;
+
+#endif
+
+// A dense row-major tensor in host memory that ML frameworks adopt through DLPack without a copy.
+// Every export shares the buffer, which is freed once the tensor and all exports are released.
+class HostTensor {
+private:
+    std::shared_ptr<void> owner;            // The vector holding the elements.
+    void* data = nullptr;
+    DLDataType dtype{};
+    std::vector<int64_t> shape;
+
+public:
+    HostTensor(std::vector<int>&& values, std::vector<int64_t> shape);
+    HostTensor(std::vector<float>&& values, std::vector<int64_t> shape);
+
+    const std::vector<int64_t>& getShape() const { return shape; }
+
+    size_t numBytes() const;
+
+    DLManagedTensor* toDLPack(bool copy = false) const;
+};
@@ -0,0 +1,180 @@
+#include "DocumentStream.h"
+#include "JsonLines.h"
+#include "Allocations.h"
+#include <fstream>
+#include <stdexcept>
+
+DocumentStream::DocumentStream(const std::vector<std::string>& inputFiles, const DocumentStreamOptions& options)
+    : tokenizer(nullptr), options(options), rawQueue(options.prefetchBatches), doneQueue(options.prefetchBatches) {
+    /*
+    Input:
+        - inputFiles: Text or JSONL files, read in the given order.
+        - options: Input format, batch size, prefetch depth and threads (see DocumentStreamOptions).
+    Output:
+        - A stream whose batches hold the tokens of each document (same split as Toolkit::tokenize).
+    */
+
+    start(inputFiles);
+}
+
+DocumentStream::DocumentStream(const std::vector<std::string>& inputFiles, const Tokenizer& tokenizer, const DocumentStreamOptions& options)
+    : tokenizer(&tokenizer), options(options), rawQueue(options.prefetchBatches), doneQueue(options.prefetchBatches) {
+    /*
+    Input:
+        - inputFiles: Text or JSONL files, read in the given order.
+        - tokenizer: Encodes each document with encodeTextInto. Must outlive the stream.
+        - options: Input format, batch size, prefetch depth, threads and maxLength (see DocumentStreamOptions).
+    Output:
+        - A stream whose batches hold the IDs of each document.
+    */
+
+    start(inputFiles);
+}
+
+DocumentStream::~DocumentStream() {
+    /*
+    Functionality:
+        - Stops a stream that was not read to the end: the queues are closed, so the reader and the
+          workers finish the batch in hand and exit.
+    */
+
+    rawQueue.close();
+    doneQueue.close();
+    if (reader.joinable()) reader.join();
+    pool.reset();
+}
+
+void DocumentStream::fail(std::exception_ptr e) {
+    {
+        std::lock_guard<std::mutex> lock(errorMutex);
+        if (!error) error = e;
+    }
+    rawQueue.close();
+    doneQueue.close();
+}
+
+void DocumentStream::start(const std::vector<std::string>& inputFiles) {
+    int maxThreads = static_cast<int>(std::thread::hardware_concurrency());
+    if (options.numThreads <= 0 || options.numThreads > maxThreads) {
+        options.numThreads = maxThreads;
+    }
+    if (options.batchDocuments == 0) options.batchDocuments = 1;
+
+    reader = std::thread([this, inputFiles]() {
+        try {
+            RawBatch batch;
+            std::string line;
+            std::string text;
+            for (const auto& file : inputFiles) {
+                std::ifstream in(file, std::ios::binary);
+                if (!in) throw std::runtime_error("DocumentStream: failed to open input file " + file);
+
+                while (std::getline(in, line)) {
+                    if (!line.empty() && line.back() == '\r') line.pop_back();
+                    if (!hasNonSpace(line)) continue;
+                    if (options.format == InputFormat::Text) {
+                        batch.documents.push_back(std::move(line));
+                    }
+                    else if (extractJsonField(line, options.jsonField, text)) {
+                        batch.documents.push_back(std::move(text));
+                    }
+                    else {
+                        ++batch.skippedLines;
+                    }
+
+                    if (batch.documents.size() >= options.batchDocuments) {
+                        uint64_t sequence = batch.sequence;
+                        if (!rawQueue.push(std::move(batch))) return;
+                        batch = RawBatch();
+                        batch.sequence = sequence + 1;
+                    }
+                }
+            }
+
+            if (!batch.documents.empty() || batch.skippedLines > 0) {
+                rawQueue.push(std::move(batch));
+            }
+            rawQueue.close();
+        }
+        catch (...) {
+            // The batches already read are still processed and handed out before the error.
+            {
+                std::lock_guard<std::mutex> lock(errorMutex);
+                if (!error) error = std::current_exception();
+            }
+            rawQueue.close();
+        }
+        });
+
+    activeWorkers = options.numThreads;
+    pool = std::make_unique<ThreadPool>(options.numThreads);
+    // The workers outlive this call, so they must not count into the caller's allocation scope.
+    Allocations::Adopt unscoped(nullptr);
+    for (int t = 0; t < options.numThreads; ++t) {
+        pool->enqueue([this]() {
+            try {
+                RawBatch raw;
+                while (rawQueue.pop(raw)) {
+                    DocumentBatch batch;
+                    process(raw, batch);
+                    if (!doneQueue.push(std::move(batch))) break;
+                }
+            }
+            catch (...) {
+                fail(std::current_exception());
+            }
+            if (--activeWorkers == 0) doneQueue.close();
+            });
+    }
+}
+
+void DocumentStream::process(RawBatch& raw, DocumentBatch& batch) const {
+    batch.sequence = raw.sequence;
+    batch.skippedLines = raw.skippedLines;
+    if (tokenizer) {
+        batch.encoded.offsets.reserve(raw.documents.size() + 1);
+        batch.encoded.offsets.push_back(0);
+        for (const auto& document : raw.documents) {
+            tokenizer->encodeTextInto(document, batch.encoded.ids, options.maxLength);
+            batch.encoded.offsets.push_back(batch.encoded.ids.size());
+        }
+    }
+    else {
+        batch.tokens.textOffsets.reserve(raw.documents.size() + 1);
+        for (const auto& document : raw.documents) {
+            Toolkit::tokenizeInto(document, batch.tokens);
+        }
+        if (batch.tokens.textOffsets.empty()) {
+            batch.tokens.textOffsets.push_back(0);
+            batch.tokens.tokens.offsets.push_back(0);
+        }
+    }
+}
+
+bool DocumentStream::next(DocumentBatch& batch) {
+    /*
+    Input:
+        - batch: Receives the next batch in file order.
+    Output:
+        - false once every file has been processed.
+    Functionality:
+        - Blocks until the next batch is ready. Rethrows the first error of the reader or a worker
+          (e.g. a missing file) after the batches before it have been handed out.
+        - Not thread-safe: one consumer pulls from a stream.
+    */
+
+    while (pending.empty() || pending.begin()->first != nextSequence) {
+        DocumentBatch done;
+        if (!doneQueue.pop(done)) {
+            std::lock_guard<std::mutex> lock(errorMutex);
+            if (error) std::rethrow_exception(error);
+            return false;
+        }
+        pending.emplace(done.sequence, std::move(done));
+    }
+
+    batch = std::move(pending.begin()->second);
+    pending.erase(pending.begin());
+    ++nextSequence;
+    return true;
+}
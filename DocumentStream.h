@@ -0,0 +1,70 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <exception>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "BoundedQueue.h"
+#include "ShardEncoder.h"
+#include "ThreadPool.h"
+#include "Tokenizer.h"
+#include "Toolkit.h"
+
+struct DocumentStreamOptions {
+    InputFormat format = InputFormat::Text;
+    std::string jsonField = "text";
+    size_t batchDocuments = 1024;           // Documents per batch handed out by next().
+    size_t prefetchBatches = 4;             // Batches read and processed ahead of the consumer.
+    int numThreads = 2;                     // Worker threads (-1 is get all).
+    size_t maxLength = SIZE_MAX;            // Maximum IDs per document when encoding.
+};
+
+struct DocumentBatch {
+    uint64_t sequence = 0;
+    uint64_t skippedLines = 0;              // JSONL lines without a string `jsonField`.
+    TokenizedBatch tokens;                  // Filled by a tokenizing stream, one text per document.
+    EncodedBuffer encoded;                  // Filled by an encoding stream, one sentence per document.
+};
+
+// Pull-based pipeline over text or JSONL files for callers that cannot hold a whole corpus in
+// memory. A reader thread splits the files into batches, pool workers tokenize or encode them
+// up to `prefetchBatches` ahead, and next() hands them out in file order.
+class DocumentStream {
+private:
+    struct RawBatch {
+        uint64_t sequence = 0;
+        uint64_t skippedLines = 0;
+        std::vector<std::string> documents;
+    };
+
+    const Tokenizer* tokenizer;             // nullptr for a tokenizing stream.
+    DocumentStreamOptions options;
+    BoundedQueue<RawBatch> rawQueue;
+    BoundedQueue<DocumentBatch> doneQueue;
+    std::map<uint64_t, DocumentBatch> pending;  // Finished out of order, waiting for their turn.
+    uint64_t nextSequence = 0;
+    std::mutex errorMutex;
+    std::exception_ptr error;
+    std::atomic<int> activeWorkers{ 0 };
+    std::unique_ptr<ThreadPool> pool;
+    std::thread reader;
+
+    void start(const std::vector<std::string>& inputFiles);
+    void fail(std::exception_ptr e);
+    void process(RawBatch& raw, DocumentBatch& batch) const;
+
+public:
+    DocumentStream(const std::vector<std::string>& inputFiles, const DocumentStreamOptions& options = DocumentStreamOptions());
+    DocumentStream(const std::vector<std::string>& inputFiles, const Tokenizer& tokenizer, const DocumentStreamOptions& options = DocumentStreamOptions());
+    ~DocumentStream();
+    DocumentStream(const DocumentStream&) = delete;
+    DocumentStream& operator=(const DocumentStream&) = delete;
+
+    bool encodes() const { return tokenizer != nullptr; }
+
+    bool next(DocumentBatch& batch);
+};
@@ -0,0 +1,129 @@
+#include "Epoch.h"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace {
+
+struct ThreadRecord {
+    std::atomic<uint64_t> epoch{ 0 };   // 0 while the thread is outside every ReadGuard.
+    std::atomic<bool> inUse{ false };
+    int depth = 0;                      // Only touched by the owning thread.
+};
+
+struct Retired {
+    uint64_t epoch;
+    std::function<void()> reclaim;
+};
+
+std::atomic<uint64_t> globalEpoch{ 1 };
+
+std::mutex registryMutex;
+std::vector<std::unique_ptr<ThreadRecord>> registry;    // Records are reused by later threads.
+
+std::mutex retiredMutex;
+std::vector<Retired> retired;
+
+ThreadRecord* acquireRecord() {
+    std::lock_guard<std::mutex> lock(registryMutex);
+    for (auto& record : registry) {
+        bool expected = false;
+        if (record->inUse.compare_exchange_strong(expected, true)) return record.get();
+    }
+    registry.push_back(std::make_unique<ThreadRecord>());
+    registry.back()->inUse = true;
+    return registry.back().get();
+}
+
+struct RecordHolder {
+    ThreadRecord* record = acquireRecord();
+    ~RecordHolder() {
+        record->epoch.store(0);
+        record->inUse.store(false);
+    }
+};
+
+ThreadRecord& localRecord() {
+    thread_local RecordHolder holder;
+    return *holder.record;
+}
+
+}
+
+Epoch::ReadGuard::ReadGuard() {
+    /*
+    Functionality:
+        - Announces the current global epoch for this thread, so nothing retired from now on is freed
+          until the guard is destroyed. Nested guards only count depth.
+        - The announcement is a sequentially consistent store, ordered before every pointer load made under the guard.
+    */
+
+    ThreadRecord& record = localRecord();
+    if (record.depth++ == 0) {
+        record.epoch.store(globalEpoch.load());
+    }
+}
+
+Epoch::ReadGuard::~ReadGuard() {
+    ThreadRecord& record = localRecord();
+    if (--record.depth == 0) {
+        record.epoch.store(0, std::memory_order_release);
+    }
+}
+
+void Epoch::retire(std::function<void()> reclaim) {
+    /*
+    Input:
+        - reclaim: Frees an object that has already been unpublished (no new reader can reach it).
+    Functionality:
+        - Tags the object with the current epoch and advances the global epoch. Readers that announced
+          an epoch up to the tag may still hold it; readers that start later cannot.
+        - Runs collect() so objects whose readers have all left are freed right away.
+    */
+
+    {
+        std::lock_guard<std::mutex> lock(retiredMutex);
+        retired.push_back({ globalEpoch.fetch_add(1), std::move(reclaim) });
+    }
+    collect();
+}
+
+size_t Epoch::collect() {
+    /*
+    Output:
+        - The number of retired objects freed by this call.
+    Functionality:
+        - Finds the oldest epoch announced by an active reader and frees every object retired before it.
+        - Called by retire(); call it directly to release memory when no further writes are coming.
+    */
+
+    // Start from the current epoch: objects retired after this point may be held by readers the scan misses.
+    uint64_t oldestActive = globalEpoch.load();
+    {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        for (auto& record : registry) {
+            uint64_t epoch = record->epoch.load();
+            if (epoch != 0 && epoch < oldestActive) oldestActive = epoch;
+        }
+    }
+
+    std::vector<Retired> ready;
+    {
+        std::lock_guard<std::mutex> lock(retiredMutex);
+        auto keep = retired.begin();
+        for (auto it = retired.begin(); it != retired.end(); ++it) {
+            if (it->epoch < oldestActive) {
+                ready.push_back(std::move(*it));
+            }
+            else {
+                *keep++ = std::move(*it);
+            }
+        }
+        retired.erase(keep, retired.end());
+    }
+
+    for (auto& item : ready) item.reclaim();
+    return ready.size();
+}
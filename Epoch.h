@@ -0,0 +1,20 @@
+#pragma once
+#include <functional>
+
+// Epoch-based reclamation for read-mostly data published through an atomic pointer.
+// Readers wrap every access in a ReadGuard; writers publish a new version, then hand the
+// old one to retire(), which frees it once no reader that could still see it is active.
+class Epoch {
+public:
+    class ReadGuard {
+    public:
+        ReadGuard();
+        ~ReadGuard();
+        ReadGuard(const ReadGuard&) = delete;
+        ReadGuard& operator=(const ReadGuard&) = delete;
+    };
+
+    static void retire(std::function<void()> reclaim);
+
+    static size_t collect();
+};
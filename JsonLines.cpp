@@ -0,0 +1,183 @@
+#include "JsonLines.h"
+#include <cctype>
+#include <cstdint>
+
+namespace {
+
+void skipSpace(const std::string& s, size_t& pos) {
+    while (pos < s.size() && std::isspace(static_cast<unsigned char>(s[pos]))) ++pos;
+}
+
+void appendUtf8(std::string& out, uint32_t cp) {
+    if (cp < 0x80) {
+        out += static_cast<char>(cp);
+    }
+    else if (cp < 0x800) {
+        out += static_cast<char>(0xC0 | (cp >> 6));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    }
+    else if (cp < 0x10000) {
+        out += static_cast<char>(0xE0 | (cp >> 12));
+        out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    }
+    else {
+        out += static_cast<char>(0xF0 | (cp >> 18));
+        out += static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+        out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    }
+}
+
+bool parseHex4(const std::string& s, size_t pos, uint32_t& value) {
+    if (pos + 4 > s.size()) return false;
+    value = 0;
+    for (size_t i = pos; i < pos + 4; ++i) {
+        char c = s[i];
+        value <<= 4;
+        if (c >= '0' && c <= '9') value |= c - '0';
+        else if (c >= 'a' && c <= 'f') value |= c - 'a' + 10;
+        else if (c >= 'A' && c <= 'F') value |= c - 'A' + 10;
+        else return false;
+    }
+    return true;
+}
+
+bool parseJsonString(const std::string& s, size_t& pos, std::string* out) {
+    /*
+    Input:
+        - s, pos: The JSON text and the position of an opening quote.
+        - out: Receives the unescaped string, or nullptr to only skip it.
+    Output:
+        - false if the string is malformed or unterminated.
+    */
+
+    ++pos;
+    while (pos < s.size()) {
+        char c = s[pos++];
+        if (c == '"') return true;
+        if (c != '\\') {
+            if (out) *out += c;
+            continue;
+        }
+        if (pos >= s.size()) return false;
+
+        char esc = s[pos++];
+        if (esc == 'u') {
+            uint32_t cp;
+            if (!parseHex4(s, pos, cp)) return false;
+            pos += 4;
+            uint32_t low;
+            if (cp >= 0xD800 && cp < 0xDC00 && pos + 1 < s.size() && s[pos] == '\\' && s[pos + 1] == 'u'
+                && parseHex4(s, pos + 2, low) && low >= 0xDC00 && low < 0xE000) {
+                cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+                pos += 6;
+            }
+            if (out) appendUtf8(*out, cp);
+            continue;
+        }
+
+        char decoded;
+        switch (esc) {
+        case 'b': decoded = '\b'; break;
+        case 'f': decoded = '\f'; break;
+        case 'n': decoded = '\n'; break;
+        case 'r': decoded = '\r'; break;
+        case 't': decoded = '\t'; break;
+        default: decoded = esc; break;
+        }
+        if (out) *out += decoded;
+    }
+    return false;
+}
+
+bool skipJsonValue(const std::string& s, size_t& pos, int depth) {
+    skipSpace(s, pos);
+    if (pos >= s.size() || depth > 256) return false;
+
+    char c = s[pos];
+    if (c == '"') return parseJsonString(s, pos, nullptr);
+
+    if (c == '{' || c == '[') {
+        char close = (c == '{') ? '}' : ']';
+        ++pos;
+        skipSpace(s, pos);
+        if (pos < s.size() && s[pos] == close) {
+            ++pos;
+            return true;
+        }
+        while (pos < s.size()) {
+            if (c == '{') {
+                skipSpace(s, pos);
+                if (pos >= s.size() || s[pos] != '"' || !parseJsonString(s, pos, nullptr)) return false;
+                skipSpace(s, pos);
+                if (pos >= s.size() || s[pos] != ':') return false;
+                ++pos;
+            }
+            if (!skipJsonValue(s, pos, depth + 1)) return false;
+            skipSpace(s, pos);
+            if (pos >= s.size()) return false;
+            if (s[pos] == ',') {
+                ++pos;
+                continue;
+            }
+            if (s[pos] != close) return false;
+            ++pos;
+            return true;
+        }
+        return false;
+    }
+
+    size_t start = pos;
+    while (pos < s.size() && s[pos] != ',' && s[pos] != '}' && s[pos] != ']' && !std::isspace(static_cast<unsigned char>(s[pos]))) ++pos;
+    return pos > start;
+}
+
+}
+
+bool extractJsonField(const std::string& line, const std::string& field, std::string& value) {
+    /*
+    Input:
+        - line: A single JSON object.
+        - field: The top-level key to extract.
+        - value: Receives the unescaped string value.
+    Output:
+        - true if `field` is present and holds a string.
+    Functionality:
+        - Walks the top-level keys of the object and skips every other value without building it.
+    */
+
+    size_t pos = 0;
+    skipSpace(line, pos);
+    if (pos >= line.size() || line[pos] != '{') return false;
+    ++pos;
+
+    std::string key;
+    while (true) {
+        skipSpace(line, pos);
+        if (pos >= line.size() || line[pos] != '"') return false;
+        key.clear();
+        if (!parseJsonString(line, pos, &key)) return false;
+        skipSpace(line, pos);
+        if (pos >= line.size() || line[pos] != ':') return false;
+        ++pos;
+        skipSpace(line, pos);
+
+        if (key == field) {
+            if (pos >= line.size() || line[pos] != '"') return false;
+            value.clear();
+            return parseJsonString(line, pos, &value);
+        }
+        if (!skipJsonValue(line, pos, 0)) return false;
+        skipSpace(line, pos);
+        if (pos >= line.size() || line[pos] != ',') return false;
+        ++pos;
+    }
+}
+
+bool hasNonSpace(const std::string& text) {
+    for (char c : text) {
+        if (!std::isspace(static_cast<unsigned char>(c))) return true;
+    }
+    return false;
+}
@@ -0,0 +1,8 @@
+#pragma once
+#include <string>
+
+// Just enough JSON for JSON Lines corpora: one string field is pulled out of each object
+// without building the rest of it.
+bool extractJsonField(const std::string& line, const std::string& field, std::string& value);
+
+bool hasNonSpace(const std::string& text);
@@ -0,0 +1,319 @@
+#include "Metrics.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <condition_variable>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+namespace {
+
+// One thread's counters. Only the owning thread writes a shard, so an update is a relaxed load and
+// store; a thread that exits hands its shard, counts included, to the next new thread.
+struct Shard {
+    std::array<std::array<std::atomic<uint64_t>, Metrics::numCounters>, Metrics::maxOperations> counters;
+    std::array<std::array<std::atomic<uint64_t>, LatencyHistogram::numBuckets>, Metrics::maxOperations> buckets;
+    std::array<std::atomic<uint64_t>, Metrics::maxOperations> sumNs;
+    std::array<std::atomic<uint64_t>, Metrics::maxOperations> maxNs;
+};
+
+std::mutex registryMutex;
+std::vector<std::string> names;
+std::vector<std::unique_ptr<Shard>> shards;
+std::vector<Shard*> freeShards;
+
+struct LocalShard {
+    Shard* shard = nullptr;
+
+    ~LocalShard() {
+        if (!shard) return;
+        std::lock_guard<std::mutex> lock(registryMutex);
+        freeShards.push_back(shard);
+    }
+
+    Shard& get() {
+        if (shard) return *shard;
+        std::lock_guard<std::mutex> lock(registryMutex);
+        if (!freeShards.empty()) {
+            shard = freeShards.back();
+            freeShards.pop_back();
+        }
+        else {
+            shards.emplace_back(new Shard());   // Value-initialized: every counter starts at 0.
+            shard = shards.back().get();
+        }
+        return *shard;
+    }
+};
+
+thread_local LocalShard localShard;
+
+void bump(std::atomic<uint64_t>& cell, uint64_t value) {
+    cell.store(cell.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+}
+
+// Exports every `interval` from a background thread. Declared after the registry, so it is
+// destroyed, and its thread joined, before the registry goes away at exit.
+struct Exporter {
+    std::mutex controlMutex;        // Serializes start and stop.
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::thread thread;
+    bool stopping = false;
+
+    ~Exporter() { stop(); }
+
+    void stop() {
+        std::lock_guard<std::mutex> control(controlMutex);
+        if (!thread.joinable()) return;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        thread.join();
+        stopping = false;
+    }
+};
+
+Exporter exporter;
+
+void writeSeries(std::ostringstream& out, const std::vector<OperationSnapshot>& operations, const char* name, const char* help,
+    uint64_t OperationSnapshot::* field) {
+    out << "# HELP " << name << " " << help << "\n# TYPE " << name << " counter\n";
+    for (const auto& operation : operations) {
+        out << name << "{operation=\"" << operation.name << "\"} " << operation.*field << "\n";
+    }
+}
+
+}
+
+size_t LatencyHistogram::bucketOf(uint64_t ns) {
+    if (ns < 2 * subBuckets) return static_cast<size_t>(ns);
+    size_t exponent = 4;
+    while (exponent < 36 && (ns >> (exponent + 1)) != 0) ++exponent;
+    if (exponent == 36) return numBuckets - 1;
+    return 2 * subBuckets + (exponent - 4) * subBuckets + static_cast<size_t>((ns >> (exponent - 3)) & (subBuckets - 1));
+}
+
+uint64_t LatencyHistogram::bucketLowerNs(size_t bucket) {
+    if (bucket < 2 * subBuckets) return bucket;
+    size_t exponent = (bucket - 2 * subBuckets) / subBuckets + 4;
+    return (subBuckets + (bucket - 2 * subBuckets) % subBuckets) << (exponent - 3);
+}
+
+uint64_t LatencyHistogram::bucketUpperNs(size_t bucket) {
+    if (bucket < 2 * subBuckets) return bucket + 1;
+    size_t exponent = (bucket - 2 * subBuckets) / subBuckets + 4;
+    return bucketLowerNs(bucket) + (uint64_t(1) << (exponent - 3));
+}
+
+uint64_t LatencyHistogram::percentileNs(double percentile) const {
+    /*
+    Input:
+        - percentile: Between 0 and 100.
+    Output:
+        - The upper bound of the bucket holding that percentile, capped at the largest value recorded
+          (0 when the histogram is empty).
+    */
+
+    if (count == 0) return 0;
+    uint64_t target = static_cast<uint64_t>(std::ceil(percentile / 100.0 * count));
+    if (target == 0) target = 1;
+    uint64_t seen = 0;
+    for (size_t bucket = 0; bucket < numBuckets; ++bucket) {
+        seen += counts[bucket];
+        if (seen >= target) return std::min(bucketUpperNs(bucket), maxNs);
+    }
+    return maxNs;
+}
+
+Metrics::Operation::Operation(const char* name) {
+    // Overloads of one operation register the same name and share its counters.
+    std::lock_guard<std::mutex> lock(registryMutex);
+    auto existing = std::find(names.begin(), names.end(), name);
+    if (existing != names.end()) {
+        id = static_cast<size_t>(existing - names.begin());
+        return;
+    }
+    if (names.size() == maxOperations) {
+        throw std::length_error("Metrics: more than " + std::to_string(maxOperations) + " operations registered");
+    }
+    id = names.size();
+    names.push_back(name);
+}
+
+void Metrics::Operation::add(Counter counter, uint64_t value) const {
+    bump(localShard.get().counters[id][counter], value);
+}
+
+void Metrics::Operation::recordLatency(uint64_t ns) const {
+    Shard& shard = localShard.get();
+    bump(shard.buckets[id][LatencyHistogram::bucketOf(ns)], 1);
+    bump(shard.sumNs[id], ns);
+    if (ns > shard.maxNs[id].load(std::memory_order_relaxed)) shard.maxNs[id].store(ns, std::memory_order_relaxed);
+}
+
+Metrics::Timer::~Timer() {
+    auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - begin);
+#ifdef NLP_COUNT_ALLOCATIONS
+    AllocationStats allocated = allocationScope.stats();
+    operation.add(AllocationCount, allocated.allocations);
+    operation.add(AllocatedBytes, allocated.bytes);
+#endif
+    operation.add(Calls, 1);
+    operation.recordLatency(static_cast<uint64_t>(elapsed.count()));
+}
+
+std::vector<OperationSnapshot> Metrics::snapshot() {
+    /*
+    Output:
+        - The counters and latency histogram of every operation called so far, in the order they were
+          first called.
+    Functionality:
+        - Sums the shards of all threads, including threads that have exited. Operations running
+          meanwhile may be partly included.
+    */
+
+    std::lock_guard<std::mutex> lock(registryMutex);
+    std::vector<OperationSnapshot> operations(names.size());
+    for (size_t id = 0; id < names.size(); ++id) {
+        OperationSnapshot& operation = operations[id];
+        operation.name = names[id];
+        LatencyHistogram& latency = operation.latency;
+        for (const auto& shard : shards) {
+            const auto& counters = shard->counters[id];
+            operation.calls += counters[Calls].load(std::memory_order_relaxed);
+            operation.items += counters[Items].load(std::memory_order_relaxed);
+            operation.bytes += counters[Bytes].load(std::memory_order_relaxed);
+            operation.unknownTokens += counters[UnknownTokens].load(std::memory_order_relaxed);
+            operation.stopWordsRemoved += counters[StopWordsRemoved].load(std::memory_order_relaxed);
+            operation.allocations += counters[AllocationCount].load(std::memory_order_relaxed);
+            operation.allocatedBytes += counters[AllocatedBytes].load(std::memory_order_relaxed);
+            for (size_t bucket = 0; bucket < LatencyHistogram::numBuckets; ++bucket) {
+                latency.counts[bucket] += shard->buckets[id][bucket].load(std::memory_order_relaxed);
+            }
+            latency.sumNs += shard->sumNs[id].load(std::memory_order_relaxed);
+            latency.maxNs = std::max(latency.maxNs, shard->maxNs[id].load(std::memory_order_relaxed));
+        }
+        for (uint64_t count : latency.counts) latency.count += count;
+    }
+    return operations;
+}
+
+void Metrics::reset() {
+    /*
+    Functionality:
+        - Sets every counter and histogram back to 0. Updates made by operations running meanwhile
+          may survive the reset.
+    */
+
+    std::lock_guard<std::mutex> lock(registryMutex);
+    for (auto& shard : shards) {
+        for (auto& counters : shard->counters) {
+            for (auto& cell : counters) cell.store(0, std::memory_order_relaxed);
+        }
+        for (auto& buckets : shard->buckets) {
+            for (auto& cell : buckets) cell.store(0, std::memory_order_relaxed);
+        }
+        for (auto& cell : shard->sumNs) cell.store(0, std::memory_order_relaxed);
+        for (auto& cell : shard->maxNs) cell.store(0, std::memory_order_relaxed);
+    }
+}
+
+std::string Metrics::toPrometheus() {
+    /*
+    Output:
+        - A snapshot in the Prometheus text exposition format, one series per operation (label
+          `operation`). Latency is a histogram in seconds with buckets at powers of 4 from ~1 us to ~17 s.
+    */
+
+    std::vector<OperationSnapshot> operations = snapshot();
+    std::ostringstream out;
+    out.precision(12);
+
+    writeSeries(out, operations, "nlp_operation_calls_total", "Calls of each Toolkit and Tokenizer operation.", &OperationSnapshot::calls);
+    writeSeries(out, operations, "nlp_operation_items_total", "Tokens or IDs processed.", &OperationSnapshot::items);
+    writeSeries(out, operations, "nlp_operation_bytes_total", "Input text bytes processed.", &OperationSnapshot::bytes);
+    writeSeries(out, operations, "nlp_unknown_tokens_total", "Encoded IDs that are the unknown token.", &OperationSnapshot::unknownTokens);
+    writeSeries(out, operations, "nlp_stop_words_removed_total", "Tokens dropped by stop-word removal.", &OperationSnapshot::stopWordsRemoved);
+    if (Allocations::enabled) {
+        writeSeries(out, operations, "nlp_operation_allocations_total", "Heap allocations.", &OperationSnapshot::allocations);
+        writeSeries(out, operations, "nlp_operation_allocated_bytes_total", "Heap bytes allocated.", &OperationSnapshot::allocatedBytes);
+    }
+
+    out << "# HELP nlp_operation_latency_seconds Latency of each call.\n# TYPE nlp_operation_latency_seconds histogram\n";
+    for (const auto& operation : operations) {
+        const LatencyHistogram& latency = operation.latency;
+        uint64_t cumulative = 0;
+        size_t bucket = 0;
+        for (int exponent = 10; exponent <= 34; exponent += 2) {
+            uint64_t bound = uint64_t(1) << exponent;
+            while (bucket < LatencyHistogram::numBuckets && LatencyHistogram::bucketUpperNs(bucket) <= bound) {
+                cumulative += latency.counts[bucket++];
+            }
+            out << "nlp_operation_latency_seconds_bucket{operation=\"" << operation.name << "\",le=\"" << bound * 1e-9 << "\"} " << cumulative << "\n";
+        }
+        out << "nlp_operation_latency_seconds_bucket{operation=\"" << operation.name << "\",le=\"+Inf\"} " << latency.count << "\n";
+        out << "nlp_operation_latency_seconds_sum{operation=\"" << operation.name << "\"} " << latency.sumNs * 1e-9 << "\n";
+        out << "nlp_operation_latency_seconds_count{operation=\"" << operation.name << "\"} " << latency.count << "\n";
+    }
+    return out.str();
+}
+
+void Metrics::writePrometheus(const std::string& path) {
+    /*
+    Input:
+        - path: File to write, e.g. a `.prom` file in the node_exporter textfile collector directory.
+    Functionality:
+        - Writes to `path + ".tmp"`, then renames it over `path`, so readers never see a partial file.
+    */
+
+    std::string temporary = path + ".tmp";
+    {
+        std::ofstream file(temporary, std::ios::trunc);
+        if (!file) throw std::runtime_error("Failed to open metrics file: " + temporary);
+        file << toPrometheus();
+    }
+    std::filesystem::rename(temporary, path);
+}
+
+void Metrics::startExporter(const std::string& path, std::chrono::milliseconds interval) {
+    /*
+    Input:
+        - path: File rewritten with writePrometheus.
+        - interval: Time between two writes.
+    Functionality:
+        - Writes the file now and then every `interval` from a background thread, until stopExporter()
+          (which writes it one last time) or exit. Replaces an exporter already running.
+    */
+
+    stopExporter();
+    std::lock_guard<std::mutex> control(exporter.controlMutex);
+    exporter.thread = std::thread([path, interval]() {
+        auto write = [&path]() {
+            try {
+                writePrometheus(path);
+            }
+            catch (const std::exception& e) {
+                std::cout << "\033[31m" << e.what() << "\033[0m\n";
+            }
+        };
+        while (true) {
+            write();
+            std::unique_lock<std::mutex> lock(exporter.mutex);
+            if (exporter.wake.wait_for(lock, interval, []() { return exporter.stopping; })) break;
+        }
+        write();
+        });
+}
+
+void Metrics::stopExporter() {
+    exporter.stop();
+}
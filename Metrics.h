@@ -0,0 +1,101 @@
+#pragma once
+#include "Allocations.h"
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Latency distribution with HDR-style log-linear buckets: exact below 16 ns, then 8 buckets per
+// power of two (at most 12.5% relative error) up to 2^36 ns (~69 s); longer values land in the
+// last bucket.
+struct LatencyHistogram {
+    static constexpr size_t subBuckets = 8;
+    static constexpr size_t numBuckets = 2 * subBuckets + (36 - 4) * subBuckets;
+
+    std::array<uint64_t, numBuckets> counts{};
+    uint64_t count = 0;
+    uint64_t sumNs = 0;
+    uint64_t maxNs = 0;
+
+    static size_t bucketOf(uint64_t ns);
+    static uint64_t bucketLowerNs(size_t bucket);
+    static uint64_t bucketUpperNs(size_t bucket);
+
+    double meanNs() const { return count ? static_cast<double>(sumNs) / count : 0.0; }
+    uint64_t percentileNs(double percentile) const;
+};
+
+// Counters and latency of one operation, summed over every thread.
+struct OperationSnapshot {
+    std::string name;
+    uint64_t calls = 0;
+    uint64_t items = 0;             // Tokens or IDs processed (texts for batchNormalize, 0 for single-string transforms).
+    uint64_t bytes = 0;             // Input text bytes; 0 for operations on token lists or IDs.
+    uint64_t unknownTokens = 0;     // Encoding operations: IDs that are the unknown token.
+    uint64_t stopWordsRemoved = 0;  // Stop-word removal: tokens dropped.
+    uint64_t allocations = 0;       // Heap allocations, including the pool workers'; 0 unless built with NLP_COUNT_ALLOCATIONS.
+    uint64_t allocatedBytes = 0;
+    LatencyHistogram latency;
+};
+
+// Always-on counters and latency histograms of every Toolkit and Tokenizer operation. Each thread
+// updates its own shard with relaxed atomic loads and stores, so recording never takes a lock or
+// contends with other threads; snapshot() sums the shards.
+//
+//     static const Metrics::Operation metrics("Tokenizer::encode");
+//     Metrics::Timer timer(metrics);                 // Counts the call and its latency.
+//     metrics.add(Metrics::Items, ids.size());
+class Metrics {
+public:
+    enum Counter { Calls, Items, Bytes, UnknownTokens, StopWordsRemoved, AllocationCount, AllocatedBytes, numCounters };
+
+    static constexpr size_t maxOperations = 64;
+
+    class Operation {
+    private:
+        size_t id;
+
+    public:
+        explicit Operation(const char* name);
+
+        void add(Counter counter, uint64_t value) const;
+        void recordLatency(uint64_t ns) const;
+    };
+
+    class Timer {
+    private:
+        const Operation& operation;
+        std::chrono::steady_clock::time_point begin;
+#ifdef NLP_COUNT_ALLOCATIONS
+        Allocations::Scope allocationScope;
+#endif
+
+    public:
+        explicit Timer(const Operation& operation) : operation(operation), begin(std::chrono::steady_clock::now()) {}
+        ~Timer();
+        Timer(const Timer&) = delete;
+        Timer& operator=(const Timer&) = delete;
+    };
+
+    // Total size of a batch of strings or string views, for the Bytes counter.
+    template <typename Texts>
+    static uint64_t bytesOf(const Texts& texts) {
+        uint64_t bytes = 0;
+        for (const auto& text : texts) bytes += text.size();
+        return bytes;
+    }
+
+    static std::vector<OperationSnapshot> snapshot();
+
+    static void reset();
+
+    static std::string toPrometheus();
+
+    static void writePrometheus(const std::string& path);
+
+    static void startExporter(const std::string& path, std::chrono::milliseconds interval = std::chrono::seconds(15));
+
+    static void stopExporter();
+};
@@ -0,0 +1,452 @@
+#include "ShardEncoder.h"
+#include "JsonLines.h"
+#include "BoundedQueue.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <condition_variable>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+struct TextBatch {
+    uint64_t sequence = 0;
+    std::vector<std::string> documents;
+    uint64_t skippedLines = 0;
+    uint64_t bytes = 0;
+    size_t fileIndex = 0;       // Input position just past the last line of the batch.
+    uint64_t fileOffset = 0;
+};
+
+struct EncodedBatch {
+    uint64_t sequence = 0;
+    std::vector<int> ids;
+    std::vector<uint64_t> lengths;
+    uint64_t skippedLines = 0;
+    uint64_t bytes = 0;
+    size_t fileIndex = 0;
+    uint64_t fileOffset = 0;
+};
+
+struct Progress {
+    size_t fileIndex = 0;
+    uint64_t fileOffset = 0;
+    uint64_t documents = 0;
+    uint64_t tokens = 0;
+};
+
+const char* progressFileName = "progress.txt";
+const char* indexFileName = "index.bin";
+
+fs::path shardPath(const fs::path& dir, uint64_t shard) {
+    std::ostringstream name;
+    name << "shard_" << std::setw(5) << std::setfill('0') << shard << ".bin";
+    return dir / name.str();
+}
+
+bool parseShardNumber(const fs::path& file, uint64_t& shard) {
+    std::string name = file.filename().string();
+    if (name.size() <= 10 || name.compare(0, 6, "shard_") != 0 || name.compare(name.size() - 4, 4, ".bin") != 0) return false;
+    try {
+        shard = std::stoull(name.substr(6, name.size() - 10));
+    }
+    catch (const std::exception&) {
+        return false;
+    }
+    return true;
+}
+
+bool readProgress(const fs::path& dir, const ShardEncoderOptions& options, size_t numInputs, Progress& progress) {
+    std::ifstream in(dir / progressFileName);
+    if (!in) return false;
+
+    std::map<std::string, std::string> values;
+    std::string line;
+    while (std::getline(in, line)) {
+        size_t eq = line.find('=');
+        if (eq != std::string::npos) values[line.substr(0, eq)] = line.substr(eq + 1);
+    }
+
+    try {
+        if (std::stoull(values.at("token_bytes")) != options.tokenBytes
+            || std::stoull(values.at("shard_tokens")) != options.shardTokens
+            || std::stoull(values.at("inputs")) != numInputs) {
+            throw std::runtime_error("ShardEncoder: " + (dir / progressFileName).string() + " was written with different options or inputs.");
+        }
+        progress.fileIndex = static_cast<size_t>(std::stoull(values.at("file_index")));
+        progress.fileOffset = std::stoull(values.at("file_offset"));
+        progress.documents = std::stoull(values.at("documents"));
+        progress.tokens = std::stoull(values.at("tokens"));
+    }
+    catch (const std::out_of_range&) {
+        throw std::runtime_error("ShardEncoder: incomplete progress file " + (dir / progressFileName).string());
+    }
+    catch (const std::invalid_argument&) {
+        throw std::runtime_error("ShardEncoder: malformed progress file " + (dir / progressFileName).string());
+    }
+    return true;
+}
+
+void writeProgress(const fs::path& dir, const ShardEncoderOptions& options, size_t numInputs, const Progress& progress) {
+    // Write then rename, so an interrupted run always leaves the previous checkpoint intact.
+    fs::path tmp = dir / (std::string(progressFileName) + ".tmp");
+    {
+        std::ofstream out(tmp, std::ios::trunc);
+        out << "token_bytes=" << options.tokenBytes << "\n"
+            << "shard_tokens=" << options.shardTokens << "\n"
+            << "inputs=" << numInputs << "\n"
+            << "file_index=" << progress.fileIndex << "\n"
+            << "file_offset=" << progress.fileOffset << "\n"
+            << "documents=" << progress.documents << "\n"
+            << "tokens=" << progress.tokens << "\n";
+        if (!out) throw std::runtime_error("ShardEncoder: failed to write " + tmp.string());
+    }
+    fs::rename(tmp, dir / progressFileName);
+}
+
+class ShardWriter {
+private:
+    fs::path dir;
+    size_t tokenBytes;
+    uint64_t shardTokens;
+    uint64_t tokens;
+    uint64_t openShard = UINT64_MAX;
+    std::ofstream shard;
+    std::ofstream index;
+    std::vector<char> buffer;
+
+    void appendIds(const int* ids, size_t count) {
+        buffer.resize(count * tokenBytes);
+        for (size_t i = 0; i < count; ++i) {
+            uint32_t id = static_cast<uint32_t>(ids[i]);
+            for (size_t b = 0; b < tokenBytes; ++b) {
+                buffer[i * tokenBytes + b] = static_cast<char>((id >> (8 * b)) & 0xFF);
+            }
+        }
+        shard.write(buffer.data(), buffer.size());
+    }
+
+public:
+    ShardWriter(const fs::path& dir, size_t tokenBytes, uint64_t shardTokens, const Progress& progress)
+        : dir(dir), tokenBytes(tokenBytes), shardTokens(shardTokens), tokens(progress.tokens) {
+        // Drop anything written after the checkpoint, so resumed output is byte-identical to an uninterrupted run.
+        uint64_t current = tokens / shardTokens;
+        uint64_t keepBytes = (tokens % shardTokens) * tokenBytes;
+        for (const auto& entry : fs::directory_iterator(dir)) {
+            uint64_t number;
+            if (!parseShardNumber(entry.path(), number) || number < current) continue;
+            if (number == current && keepBytes > 0) {
+                fs::resize_file(entry.path(), keepBytes);
+            }
+            else {
+                fs::remove(entry.path());
+            }
+        }
+
+        fs::path indexPath = dir / indexFileName;
+        if (fs::exists(indexPath)) {
+            fs::resize_file(indexPath, progress.documents * 2 * sizeof(uint64_t));
+        }
+        index.open(indexPath, std::ios::binary | std::ios::app);
+        if (!index) throw std::runtime_error("ShardEncoder: failed to open " + indexPath.string());
+    }
+
+    uint64_t totalTokens() const { return tokens; }
+
+    void write(const EncodedBatch& batch) {
+        uint64_t start = tokens;
+        for (uint64_t length : batch.lengths) {
+            uint64_t entry[2] = { start, length };
+            index.write(reinterpret_cast<const char*>(entry), sizeof(entry));
+            start += length;
+        }
+
+        size_t done = 0;
+        while (done < batch.ids.size()) {
+            uint64_t number = tokens / shardTokens;
+            if (number != openShard) {
+                if (shard.is_open()) shard.close();
+                shard.open(shardPath(dir, number), std::ios::binary | std::ios::app);
+                if (!shard) throw std::runtime_error("ShardEncoder: failed to open " + shardPath(dir, number).string());
+                openShard = number;
+            }
+            size_t room = static_cast<size_t>(shardTokens - tokens % shardTokens);
+            size_t count = std::min(room, batch.ids.size() - done);
+            appendIds(batch.ids.data() + done, count);
+            done += count;
+            tokens += count;
+        }
+    }
+
+    void flush() {
+        if (shard.is_open()) shard.flush();
+        index.flush();
+        if (!index || (shard.is_open() && !shard)) throw std::runtime_error("ShardEncoder: failed to write output in " + dir.string());
+    }
+};
+
+}
+
+ShardEncoder::ShardEncoder(const Tokenizer& tokenizer, const ShardEncoderOptions& options) : tokenizer(tokenizer), options(options) {
+    /*
+    Input:
+        - tokenizer: The Tokenizer used to map tokens to IDs. It must outlive the ShardEncoder.
+        - options: Input format, shard layout and pipeline sizes (see ShardEncoderOptions).
+    Output:
+        - Constructs the encoder. Throws `std::invalid_argument` if the options cannot hold the vocabulary.
+    */
+
+    if (this->options.tokenBytes != 2 && this->options.tokenBytes != 4) {
+        throw std::invalid_argument("ShardEncoder: tokenBytes must be 2 or 4.");
+    }
+    if (this->options.tokenBytes == 2 && tokenizer.vocabSize() > 65536) {
+        throw std::invalid_argument("ShardEncoder: vocabulary has more than 65536 IDs and does not fit in uint16 shards.");
+    }
+    if (this->options.shardTokens == 0 || this->options.batchDocuments == 0) {
+        throw std::invalid_argument("ShardEncoder: shardTokens and batchDocuments must be positive.");
+    }
+
+    size_t maxThreads = std::thread::hardware_concurrency();
+    if (this->options.numThreads <= 0 || this->options.numThreads > static_cast<int>(maxThreads)) {
+        this->options.numThreads = maxThreads;
+    }
+}
+
+ShardEncoderStats ShardEncoder::encode(const std::vector<std::string>& inputFiles, const std::string& outputDir) {
+    /*
+    Input:
+        - inputFiles: Text or JSONL files, encoded in the given order.
+        - outputDir: Directory receiving the shards, created if missing.
+    Output:
+        - Throughput statistics of this run (work restored from a checkpoint is not counted).
+          Throws `std::runtime_error` if an ID does not fit in `tokenBytes` bytes, e.g. after addTokens grew the vocabulary.
+    Functionality:
+        - Runs a three-stage pipeline connected by bounded queues:
+            - A reader thread splits the inputs into batches of `batchDocuments` documents.
+            - `numThreads` pool workers encode each batch with Tokenizer::encodeTextInto (special tokens, then whitespace words).
+            - The calling thread reorders finished batches by sequence number and appends them to the shards,
+              so the output keeps document order regardless of which worker finished first.
+            - A worker holds a finished batch until it is within `queueCapacity` batches of the next one to write,
+              so one slow batch stalls the pipeline instead of letting reordered batches pile up in memory.
+        - Output layout:
+            - shard_NNNNN.bin: `shardTokens` little-endian token IDs of `tokenBytes` bytes each.
+            - index.bin: one (start token, token count) pair of uint64 per document; start / shardTokens is its shard.
+            - progress.txt: the last checkpoint (input file, byte offset, documents and tokens written).
+        - A checkpoint is written after every batch. With `resume` enabled, a later run truncates the output back to
+          the checkpoint and continues reading from the recorded input offset.
+    */
+
+    fs::path dir(outputDir);
+    fs::create_directories(dir);
+
+    Progress start;
+    bool resumed = options.resume && readProgress(dir, options, inputFiles.size(), start);
+    if (!resumed) {
+        fs::remove(dir / progressFileName);
+        fs::remove(dir / indexFileName);
+    }
+    ShardWriter writer(dir, options.tokenBytes, options.shardTokens, start);
+    if (resumed) {
+        std::cout << "\033[36mShardEncoder: resuming at document " << start.documents << " (" << start.tokens << " tokens)\033[0m\n";
+    }
+
+    BoundedQueue<TextBatch> textQueue(options.queueCapacity);
+    BoundedQueue<EncodedBatch> encodedQueue(options.queueCapacity);
+    std::mutex errorMutex;
+    std::exception_ptr error;
+
+    // Reorder window: a worker holds its finished batch until it is fewer than `window` batches ahead of
+    // the next one to write, so a slow batch stalls the other workers instead of filling `pending`.
+    const uint64_t window = std::max<size_t>(options.queueCapacity, 1);
+    std::mutex windowMutex;
+    std::condition_variable windowMoved;
+    uint64_t windowStart = 0;
+    bool stopped = false;
+
+    auto fail = [&](std::exception_ptr e) {
+        {
+            std::lock_guard<std::mutex> lock(errorMutex);
+            if (!error) error = e;
+        }
+        {
+            std::lock_guard<std::mutex> lock(windowMutex);
+            stopped = true;
+        }
+        windowMoved.notify_all();
+        textQueue.close();
+        encodedQueue.close();
+    };
+
+    auto begin = std::chrono::steady_clock::now();
+
+    std::thread reader([&]() {
+        try {
+            uint64_t sequence = 0;
+            TextBatch batch;
+            batch.fileIndex = start.fileIndex;
+            batch.fileOffset = start.fileOffset;
+            std::string line;
+            std::string text;
+
+            for (size_t f = start.fileIndex; f < inputFiles.size(); ++f) {
+                std::ifstream in(inputFiles[f], std::ios::binary);
+                if (!in) throw std::runtime_error("ShardEncoder: failed to open input file " + inputFiles[f]);
+
+                uint64_t offset = (f == start.fileIndex) ? start.fileOffset : 0;
+                if (offset > 0) in.seekg(static_cast<std::streamoff>(offset));
+
+                while (std::getline(in, line)) {
+                    uint64_t consumed = line.size() + (in.eof() ? 0 : 1);
+                    offset += consumed;
+                    batch.bytes += consumed;
+                    batch.fileIndex = f;
+                    batch.fileOffset = offset;
+
+                    if (!line.empty() && line.back() == '\r') line.pop_back();
+                    if (options.format == InputFormat::Text) {
+                        if (hasNonSpace(line)) batch.documents.push_back(std::move(line));
+                    }
+                    else if (hasNonSpace(line)) {
+                        if (extractJsonField(line, options.jsonField, text)) {
+                            batch.documents.push_back(std::move(text));
+                        }
+                        else {
+                            ++batch.skippedLines;
+                        }
+                    }
+
+                    if (batch.documents.size() >= options.batchDocuments) {
+                        batch.sequence = sequence++;
+                        if (!textQueue.push(std::move(batch))) return;
+                        batch = TextBatch();
+                    }
+                }
+                batch.fileIndex = f + 1;
+                batch.fileOffset = 0;
+            }
+
+            if (!batch.documents.empty() || batch.bytes > 0 || batch.skippedLines > 0) {
+                batch.sequence = sequence++;
+                textQueue.push(std::move(batch));
+            }
+            textQueue.close();
+        }
+        catch (...) {
+            fail(std::current_exception());
+        }
+        });
+
+    ShardEncoderStats stats;
+    {
+        std::atomic<int> activeWorkers(options.numThreads);
+        // Joined before encode() returns, so the workers may count into the caller's allocation scope.
+        ThreadPool pool(options.numThreads);
+
+        for (int t = 0; t < options.numThreads; ++t) {
+            pool.enqueue([&]() {
+                try {
+                    TextBatch batch;
+                    while (textQueue.pop(batch)) {
+                        EncodedBatch encoded;
+                        encoded.sequence = batch.sequence;
+                        encoded.skippedLines = batch.skippedLines;
+                        encoded.bytes = batch.bytes;
+                        encoded.fileIndex = batch.fileIndex;
+                        encoded.fileOffset = batch.fileOffset;
+                        encoded.lengths.reserve(batch.documents.size());
+
+                        for (const auto& document : batch.documents) {
+                            size_t before = encoded.ids.size();
+                            tokenizer.encodeTextInto(document, encoded.ids);
+                            encoded.lengths.push_back(encoded.ids.size() - before);
+                        }
+                        // addTokens may grow the vocabulary during the run, so the constructor's check is not enough.
+                        auto maxId = std::max_element(encoded.ids.begin(), encoded.ids.end());
+                        if (maxId != encoded.ids.end() && static_cast<uint64_t>(*maxId) >> (8 * options.tokenBytes) != 0) {
+                            throw std::runtime_error("ShardEncoder: token ID " + std::to_string(*maxId) + " does not fit in "
+                                + std::to_string(options.tokenBytes) + "-byte shards; the vocabulary grew during the run.");
+                        }
+
+                        std::unique_lock<std::mutex> lock(windowMutex);
+                        windowMoved.wait(lock, [&]() { return stopped || encoded.sequence < windowStart + window; });
+                        if (stopped) break;
+                        lock.unlock();
+                        if (!encodedQueue.push(std::move(encoded))) break;
+                    }
+                }
+                catch (...) {
+                    fail(std::current_exception());
+                }
+                if (--activeWorkers == 0) encodedQueue.close();
+                });
+        }
+
+        try {
+            std::map<uint64_t, EncodedBatch> pending;
+            uint64_t nextSequence = 0;
+            Progress progress = start;
+            auto lastReport = begin;
+            EncodedBatch batch;
+
+            while (encodedQueue.pop(batch)) {
+                pending.emplace(batch.sequence, std::move(batch));
+
+                while (!pending.empty() && pending.begin()->first == nextSequence) {
+                    const EncodedBatch& ready = pending.begin()->second;
+                    writer.write(ready);
+                    writer.flush();
+
+                    progress.fileIndex = ready.fileIndex;
+                    progress.fileOffset = ready.fileOffset;
+                    progress.documents += ready.lengths.size();
+                    progress.tokens = writer.totalTokens();
+                    writeProgress(dir, options, inputFiles.size(), progress);
+
+                    stats.documents += ready.lengths.size();
+                    stats.skippedLines += ready.skippedLines;
+                    stats.tokens += ready.ids.size();
+                    stats.bytesRead += ready.bytes;
+                    pending.erase(pending.begin());
+                    ++nextSequence;
+                }
+                {
+                    std::lock_guard<std::mutex> lock(windowMutex);
+                    windowStart = nextSequence;
+                }
+                windowMoved.notify_all();
+
+                auto now = std::chrono::steady_clock::now();
+                if (options.reportSeconds > 0 && std::chrono::duration<double>(now - lastReport).count() >= options.reportSeconds) {
+                    stats.seconds = std::chrono::duration<double>(now - begin).count();
+                    std::cout << "\033[36mShardEncoder: " << stats.documents << " docs, " << stats.tokens << " tokens, "
+                        << std::fixed << std::setprecision(1) << stats.megabytesPerSecond() << " MB/s, "
+                        << stats.tokensPerSecond() << " tokens/s\033[0m\n";
+                    lastReport = now;
+                }
+            }
+        }
+        catch (...) {
+            fail(std::current_exception());
+        }
+
+        reader.join();
+    }
+
+    if (error) std::rethrow_exception(error);
+
+    stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    stats.shards = (writer.totalTokens() + options.shardTokens - 1) / options.shardTokens;
+    return stats;
+}
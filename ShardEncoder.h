@@ -0,0 +1,46 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <cstdint>
+#include "Tokenizer.h"
+
+enum class InputFormat {
+    Text,   // One document per non-empty line.
+    JSONL   // One JSON object per line, the document is a string field.
+};
+
+struct ShardEncoderOptions {
+    InputFormat format = InputFormat::Text;
+    std::string jsonField = "text";
+    size_t tokenBytes = 4;                  // 2 (uint16) or 4 (uint32) bytes per token ID.
+    size_t shardTokens = size_t(1) << 26;   // Tokens per shard file; the last shard may be shorter.
+    size_t batchDocuments = 1024;           // Documents read and encoded as one unit of work.
+    size_t queueCapacity = 8;               // Batches buffered between pipeline stages, and held for reordering.
+    int numThreads = 2;                     // Encoding threads (-1 is get all).
+    bool resume = true;                     // Continue from progress.txt when it exists.
+    double reportSeconds = 10.0;            // Interval of throughput reports (0 to disable).
+};
+
+struct ShardEncoderStats {
+    uint64_t documents = 0;
+    uint64_t skippedLines = 0;
+    uint64_t tokens = 0;
+    uint64_t bytesRead = 0;
+    uint64_t shards = 0;
+    double seconds = 0.0;
+
+    double documentsPerSecond() const { return seconds > 0 ? documents / seconds : 0.0; }
+    double tokensPerSecond() const { return seconds > 0 ? tokens / seconds : 0.0; }
+    double megabytesPerSecond() const { return seconds > 0 ? bytesRead / seconds / (1024.0 * 1024.0) : 0.0; }
+};
+
+class ShardEncoder {
+private:
+    const Tokenizer& tokenizer;
+    ShardEncoderOptions options;
+
+public:
+    ShardEncoder(const Tokenizer& tokenizer, const ShardEncoderOptions& options = ShardEncoderOptions());
+
+    ShardEncoderStats encode(const std::vector<std::string>& inputFiles, const std::string& outputDir);
+};
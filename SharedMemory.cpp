@@ -0,0 +1,133 @@
+#include "SharedMemory.h"
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <system_error>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+std::string segmentName(const std::string& name) {
+    // POSIX wants exactly one leading slash and no others.
+    if (name.empty() || name.find('/', 1) != std::string::npos) {
+        throw std::invalid_argument("Shared memory name must be non-empty and contain no '/': " + name);
+    }
+    return name[0] == '/' ? name : "/" + name;
+}
+
+[[noreturn]] void fail(const std::string& what, const std::string& name) {
+    throw std::system_error(errno, std::generic_category(), what + " " + name);
+}
+
+}
+
+#if defined(_WIN32)
+
+SharedMemory::~SharedMemory() {}
+
+void SharedMemory::create(const std::string&, std::string_view) {
+    throw std::runtime_error("Shared memory segments need POSIX shm_open.");
+}
+
+std::shared_ptr<const SharedMemory> SharedMemory::open(const std::string&) {
+    throw std::runtime_error("Shared memory segments need POSIX shm_open.");
+}
+
+bool SharedMemory::unlink(const std::string&) {
+    throw std::runtime_error("Shared memory segments need POSIX shm_open.");
+}
+
+#else
+
+SharedMemory::~SharedMemory() {
+    if (address != nullptr) munmap(address, length);
+}
+
+void SharedMemory::create(const std::string& name, std::string_view contents) {
+    /*
+    Input:
+        - name: Segment name, e.g. "/nlp_vocab". A leading '/' is added if missing.
+        - contents: Bytes to place in the segment.
+    Output:
+        - None (void). Throws `std::system_error` if the segment exists already or cannot be written.
+    Functionality:
+        - The segment outlives the process until unlink() is called, so other processes can open it later.
+    */
+
+    std::string path = segmentName(name);
+    int fd = shm_open(path.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd < 0) fail("shm_open", path);
+
+    // An empty mapping is invalid, so empty contents still get one byte.
+    size_t size = contents.empty() ? 1 : contents.size();
+    void* target = MAP_FAILED;
+    if (ftruncate(fd, static_cast<off_t>(size)) == 0) {
+        target = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    if (target == MAP_FAILED) {
+        int error = errno;
+        close(fd);
+        shm_unlink(path.c_str());
+        errno = error;
+        fail("Cannot size or map shared memory", path);
+    }
+    close(fd);
+
+    std::memcpy(target, contents.data(), contents.size());
+    munmap(target, size);
+}
+
+std::shared_ptr<const SharedMemory> SharedMemory::open(const std::string& name) {
+    /*
+    Input:
+        - name: Name the segment was created with.
+    Output:
+        - A read-only mapping of the whole segment, page aligned. It stays valid after unlink()
+          until the last reference is dropped.
+    */
+
+    std::string path = segmentName(name);
+    int fd = shm_open(path.c_str(), O_RDONLY, 0);
+    if (fd < 0) fail("shm_open", path);
+
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        int error = errno;
+        close(fd);
+        errno = error;
+        fail("fstat", path);
+    }
+
+    size_t size = static_cast<size_t>(info.st_size);
+    void* address = size > 0 ? mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0) : MAP_FAILED;
+    int error = errno;
+    close(fd);
+    if (address == MAP_FAILED) {
+        errno = size > 0 ? error : EINVAL;
+        fail("mmap", path);
+    }
+    return std::shared_ptr<const SharedMemory>(new SharedMemory(address, size));
+}
+
+bool SharedMemory::unlink(const std::string& name) {
+    /*
+    Input:
+        - name: Name the segment was created with.
+    Output:
+        - false if no such segment exists. Mappings that are open stay valid; the memory is
+          freed when the last one is closed.
+    */
+
+    std::string path = segmentName(name);
+    if (shm_unlink(path.c_str()) == 0) return true;
+    if (errno == ENOENT) return false;
+    fail("shm_unlink", path);
+}
+
+#endif
@@ -0,0 +1,30 @@
+#pragma once
+#include <memory>
+#include <string>
+#include <string_view>
+
+// Read-only mapping of a named POSIX shared-memory segment. Processes that open the same name
+// share the physical pages, so data placed there once is not copied per process.
+// Not available on Windows: every call throws std::runtime_error there.
+class SharedMemory {
+private:
+    void* address = nullptr;
+    size_t length = 0;
+
+    SharedMemory(void* address, size_t length) : address(address), length(length) {}
+
+public:
+    ~SharedMemory();
+    SharedMemory(const SharedMemory&) = delete;
+    SharedMemory& operator=(const SharedMemory&) = delete;
+
+    static void create(const std::string& name, std::string_view contents);
+
+    static std::shared_ptr<const SharedMemory> open(const std::string& name);
+
+    static bool unlink(const std::string& name);
+
+    const char* data() const { return static_cast<const char*>(address); }
+
+    size_t size() const { return length; }
+};
@@ -0,0 +1,121 @@
+#include "SpecialTokenMatcher.h"
+#include <algorithm>
+#include <queue>
+
+SpecialTokenMatcher::SpecialTokenMatcher(const std::vector<std::string>& patternList) {
+    /*
+    Input:
+        - patternList: The special tokens to match. Empty strings are ignored.
+    Output:
+        - Constructs the automaton.
+    Functionality:
+        - Builds a byte trie of the patterns, then fills in failure transitions breadth-first so every
+          state has all 256 transitions and matching needs one table lookup per byte.
+        - Memory is 1 KB per trie state, which is small for the tens to hundreds of special tokens a
+          tokenizer normally reserves.
+    */
+
+    const uint32_t none = UINT32_MAX;
+    transitions.assign(256, none);
+    output.push_back(-1);
+    depth.push_back(0);
+
+    for (const auto& pattern : patternList) {
+        if (pattern.empty()) continue;
+        size_t index = patterns.size();
+        patterns.push_back(pattern);
+        longest = std::max(longest, pattern.size());
+        firstByte[static_cast<unsigned char>(pattern[0])] = true;
+
+        uint32_t state = 0;
+        for (unsigned char c : pattern) {
+            if (transitions[state * 256 + c] == none) {
+                uint32_t child = static_cast<uint32_t>(output.size());
+                transitions[state * 256 + c] = child;
+                transitions.resize(transitions.size() + 256, none);
+                output.push_back(-1);
+                depth.push_back(depth[state] + 1);
+            }
+            state = transitions[state * 256 + c];
+        }
+        if (output[state] < 0) output[state] = static_cast<int32_t>(index);
+    }
+
+    std::vector<uint32_t> fail(output.size(), 0);
+    std::queue<uint32_t> pending;
+    for (int c = 0; c < 256; ++c) {
+        uint32_t child = transitions[c];
+        if (child == none) {
+            transitions[c] = 0;
+        }
+        else {
+            pending.push(child);
+        }
+    }
+
+    while (!pending.empty()) {
+        uint32_t state = pending.front();
+        pending.pop();
+        // A state without its own pattern reports the longest pattern that is a proper suffix of it.
+        if (output[state] < 0) output[state] = output[fail[state]];
+
+        for (int c = 0; c < 256; ++c) {
+            uint32_t& next = transitions[state * 256 + c];
+            uint32_t viaFail = transitions[fail[state] * 256 + c];
+            if (next == none) {
+                next = viaFail;
+            }
+            else {
+                fail[next] = viaFail;
+                pending.push(next);
+            }
+        }
+    }
+}
+
+bool SpecialTokenMatcher::next(std::string_view text, size_t from, SpecialTokenMatch& match) const {
+    /*
+    Input:
+        - text: The raw text to search.
+        - from: Position to start searching at.
+        - match: Receives the match.
+    Output:
+        - true if a special token occurs at or after `from`.
+    Functionality:
+        - Returns the match that starts first, and the longest one among those starting there.
+        - While the automaton is at the root it skips bytes that cannot start a special token,
+          so text without special tokens costs a table test per byte.
+    */
+
+    if (patterns.empty()) return false;
+
+    uint32_t state = 0;
+    bool found = false;
+    SpecialTokenMatch best;
+
+    for (size_t i = from; i < text.size(); ++i) {
+        if (state == 0 && !found) {
+            while (i < text.size() && !firstByte[static_cast<unsigned char>(text[i])]) ++i;
+            if (i == text.size()) break;
+        }
+
+        state = transitions[state * 256 + static_cast<unsigned char>(text[i])];
+        // Every later match starts at or after the current prefix, so none can beat the one found.
+        if (found && i + 1 - depth[state] > best.begin) break;
+
+        int32_t pattern = output[state];
+        if (pattern >= 0) {
+            size_t end = i + 1;
+            size_t begin = end - patterns[pattern].size();
+            if (!found || begin < best.begin || (begin == best.begin && end > best.end)) {
+                best.begin = begin;
+                best.end = end;
+                best.pattern = static_cast<size_t>(pattern);
+                found = true;
+            }
+        }
+    }
+
+    if (found) match = best;
+    return found;
+}
@@ -0,0 +1,35 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+
+struct SpecialTokenMatch {
+    size_t begin = 0;
+    size_t end = 0;
+    size_t pattern = 0;     // Index into the pattern list the matcher was built from.
+};
+
+// Aho-Corasick automaton over raw bytes, finding special tokens (e.g. "<s>", "[CLS]") in text
+// before it is split into words. Matches are leftmost-longest and never overlap.
+class SpecialTokenMatcher {
+private:
+    std::vector<std::string> patterns;
+    std::vector<uint32_t> transitions;      // Dense DFA: 256 entries per state, state 0 is the root.
+    std::vector<int32_t> output;            // Longest pattern ending in each state, -1 if none.
+    std::vector<uint32_t> depth;            // Length of the prefix each state stands for.
+    bool firstByte[256] = {};               // Bytes that can start a match, used to skip text at the root.
+    size_t longest = 0;                     // Length of the longest pattern.
+
+public:
+    SpecialTokenMatcher() = default;
+    explicit SpecialTokenMatcher(const std::vector<std::string>& patterns);
+
+    bool empty() const { return patterns.empty(); }
+
+    const std::vector<std::string>& getPatterns() const { return patterns; }
+
+    size_t longestPattern() const { return longest; }
+
+    bool next(std::string_view text, size_t from, SpecialTokenMatch& match) const;
+};
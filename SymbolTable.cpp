@@ -0,0 +1,152 @@
+#include "SymbolTable.h"
+#include <algorithm>
+#include <cstring>
+#include <shared_mutex>
+#include <stdexcept>
+#include <vector>
+
+// One open-addressing table, same slot layout as Vocabulary: (hash tag << 32) | (symbol + 1), 0 when
+// empty. The text of its symbols is copied into blocks owned by the shard.
+struct SymbolTable::Shard {
+    mutable std::shared_mutex mutex;
+    std::vector<uint64_t> slots;
+    size_t used = 0;
+    std::vector<std::unique_ptr<char[]>> blocks;
+    size_t blockUsed = 0;
+    size_t blockSize = 0;
+
+    static constexpr size_t minBlockSize = 16 * 1024;
+
+    const char* store(std::string_view text) {
+        if (blocks.empty() || text.size() > blockSize - blockUsed) {
+            blockSize = std::max(minBlockSize, text.size());
+            blocks.emplace_back(new char[blockSize]);
+            blockUsed = 0;
+        }
+        char* data = blocks.back().get() + blockUsed;
+        if (!text.empty()) std::memcpy(data, text.data(), text.size());
+        blockUsed += text.size();
+        return data;
+    }
+};
+
+namespace {
+
+constexpr uint64_t emptySlot = 0;
+
+size_t shardOf(uint64_t hash) {
+    return static_cast<size_t>(hash >> 58) & (SymbolTable::numShards - 1);
+}
+
+}
+
+SymbolTable::SymbolTable() : shards(new Shard[numShards]) {
+    for (auto& segment : segments) segment.store(nullptr, std::memory_order_relaxed);
+}
+
+SymbolTable::~SymbolTable() {
+    for (auto& segment : segments) delete[] segment.load(std::memory_order_relaxed);
+}
+
+SymbolTable& SymbolTable::global() {
+    // Leaked on purpose, so static destructors and detached threads can still resolve symbols.
+    static SymbolTable* table = new SymbolTable();
+    return *table;
+}
+
+SymbolTable::Entry& SymbolTable::slotFor(uint32_t symbol) {
+    size_t index;
+    size_t k = segmentOf(symbol, index);
+    Entry* segment = segments[k].load(std::memory_order_acquire);
+    if (!segment) {
+        std::lock_guard<std::mutex> lock(segmentMutex);
+        segment = segments[k].load(std::memory_order_relaxed);
+        if (!segment) {
+            segment = new Entry[firstSegment << k];
+            segments[k].store(segment, std::memory_order_release);
+        }
+    }
+    return segment[index];
+}
+
+uint32_t SymbolTable::find(std::string_view text, uint64_t h) const {
+    /*
+    Input:
+        - text: The string to look up.
+        - h: Vocabulary::hash(text), for callers that already computed it.
+    Output:
+        - Its symbol, or npos if it was never interned.
+    */
+
+    uint64_t tag = h >> 32;
+    const Shard& shard = shards[shardOf(h)];
+    std::shared_lock<std::shared_mutex> lock(shard.mutex);
+    if (shard.slots.empty()) return npos;
+
+    uint64_t mask = shard.slots.size() - 1;
+    for (uint64_t i = h & mask;; i = (i + 1) & mask) {
+        uint64_t slot = shard.slots[i];
+        if (slot == emptySlot) return npos;
+        if ((slot >> 32) == tag) {
+            uint32_t symbol = static_cast<uint32_t>(slot) - 1;
+            if (str(symbol) == text) return symbol;
+        }
+    }
+}
+
+uint32_t SymbolTable::intern(std::string_view text) {
+    /*
+    Input:
+        - text: The string to intern.
+    Output:
+        - Its symbol: the existing one if the string was interned before, else the next free one.
+    Functionality:
+        - Safe to call from any number of threads. A string seen before only takes its shard's lock
+          in shared mode; a new one takes it exclusively while its text and slot are stored.
+    */
+
+    uint64_t h = Vocabulary::hash(text);
+    uint32_t symbol = find(text, h);
+    if (symbol != npos) return symbol;
+
+    uint64_t tag = h >> 32;
+    Shard& shard = shards[shardOf(h)];
+    std::unique_lock<std::shared_mutex> lock(shard.mutex);
+
+    if ((shard.used + 1) * 2 > shard.slots.size()) {
+        // Keeps the load at most 1/2; entries carry their hash, so no string is hashed again.
+        std::vector<uint64_t> grown(std::max<size_t>(16, shard.slots.size() * 2), emptySlot);
+        uint64_t mask = grown.size() - 1;
+        for (uint64_t slot : shard.slots) {
+            if (slot == emptySlot) continue;
+            uint64_t i = hash(static_cast<uint32_t>(slot) - 1) & mask;
+            while (grown[i] != emptySlot) i = (i + 1) & mask;
+            grown[i] = slot;
+        }
+        shard.slots.swap(grown);
+    }
+
+    uint64_t mask = shard.slots.size() - 1;
+    uint64_t i = h & mask;
+    for (;; i = (i + 1) & mask) {
+        uint64_t slot = shard.slots[i];
+        if (slot == emptySlot) break;
+        // Another thread may have interned the string between find() and taking the lock.
+        if ((slot >> 32) == tag && str(static_cast<uint32_t>(slot) - 1) == text) {
+            return static_cast<uint32_t>(slot) - 1;
+        }
+    }
+
+    if (text.size() >= UINT32_MAX) {
+        throw std::length_error("SymbolTable: string longer than 2^32 characters.");
+    }
+    symbol = count.load(std::memory_order_relaxed);
+    do {
+        if (symbol == npos) throw std::length_error("SymbolTable: more than 2^32 - 1 symbols.");
+    } while (!count.compare_exchange_weak(symbol, symbol + 1, std::memory_order_relaxed));
+
+    slotFor(symbol) = Entry{ shard.store(text), static_cast<uint32_t>(text.size()), h };
+    shard.slots[i] = (tag << 32) | (uint64_t(symbol) + 1);
+    ++shard.used;
+    return symbol;
+}
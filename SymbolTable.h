@@ -0,0 +1,81 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include "Vocabulary.h"
+
+// Concurrent string interning pool: maps each distinct string to a stable 32-bit symbol, assigned
+// densely from 0 in first-seen order. Strings are hashed into 64 shards, each an open-addressing table
+// under its own reader-writer lock, so threads interning different words rarely contend; the text of
+// every symbol is stored once and never moves, so str() takes no lock.
+//
+//     uint32_t symbol = SymbolTable::global().intern("hello");
+//     std::string_view text = SymbolTable::global().str(symbol);   // Valid for the table's lifetime.
+class SymbolTable {
+public:
+    static constexpr uint32_t npos = UINT32_MAX;
+    static constexpr size_t numShards = 64;
+
+    SymbolTable();
+    ~SymbolTable();
+    SymbolTable(const SymbolTable&) = delete;
+    SymbolTable& operator=(const SymbolTable&) = delete;
+
+    uint32_t intern(std::string_view text);
+
+    uint32_t find(std::string_view text) const { return find(text, Vocabulary::hash(text)); }
+
+    uint32_t find(std::string_view text, uint64_t h) const;
+
+    // A symbol must have been returned to this thread, or handed over with the usual synchronization.
+    std::string_view str(uint32_t symbol) const {
+        const Entry& entry = entryOf(symbol);
+        return std::string_view(entry.data, entry.length);
+    }
+
+    // Vocabulary::hash of the symbol's text, computed once when it was interned.
+    uint64_t hash(uint32_t symbol) const { return entryOf(symbol).hash; }
+
+    size_t size() const { return count.load(std::memory_order_relaxed); }
+
+    // The pool shared by Toolkit and Tokenizer, never destroyed.
+    static SymbolTable& global();
+
+private:
+    struct Entry {
+        const char* data;
+        uint32_t length;
+        uint64_t hash;
+    };
+
+    struct Shard;
+
+    // Entries live in segments of doubling size (segment k holds firstSegment << k), so a published
+    // entry never moves and the segment table is fixed.
+    static constexpr size_t firstSegment = 1024;
+    static constexpr size_t numSegments = 23;
+
+    std::unique_ptr<Shard[]> shards;
+    std::atomic<Entry*> segments[numSegments];
+    std::atomic<uint32_t> count{ 0 };
+    std::mutex segmentMutex;
+
+    static size_t segmentOf(uint32_t symbol, size_t& index) {
+        size_t block = symbol / firstSegment + 1;
+        size_t k = 0;
+        while (block >> (k + 1)) ++k;
+        index = symbol - firstSegment * ((size_t(1) << k) - 1);
+        return k;
+    }
+
+    const Entry& entryOf(uint32_t symbol) const {
+        size_t index;
+        size_t k = segmentOf(symbol, index);
+        return segments[k].load(std::memory_order_acquire)[index];
+    }
+
+    Entry& slotFor(uint32_t symbol);
+};
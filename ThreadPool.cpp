@@ -1,4 +1,5 @@
 #include "ThreadPool.h"
+#include "Trace.h"
 
 ThreadPool::ThreadPool(size_t threads) : stop(false) {
     /*
@@ -20,6 +21,7 @@ ThreadPool::ThreadPool(size_t threads) : stop(false) {
         - The pool remains operational until explicitly stopped or destroyed.
     */
 
+    NLP_TRACE_SCOPE("ThreadPool::spawn");
     for (size_t i = 0; i < threads; ++i) {
         workers.emplace_back([this]() {
             while (true) {
@@ -39,6 +41,7 @@ ThreadPool::ThreadPool(size_t threads) : stop(false) {
                     this->tasks.pop();
                 }
 
+                NLP_TRACE_SCOPE("ThreadPool::task");
                 task();
             }
             });
@@ -46,6 +49,7 @@ ThreadPool::ThreadPool(size_t threads) : stop(false) {
 }
 
 ThreadPool::~ThreadPool() {
+    NLP_TRACE_SCOPE("ThreadPool::join");
     {
         std::unique_lock<std::mutex> lock(queueMutex);
         stop = true;
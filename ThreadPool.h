@@ -1,4 +1,5 @@
 #pragma once
+#include "Allocations.h"
 #include <thread>
 #include <queue>
 #include <functional>
@@ -38,6 +39,12 @@ public:
 
         Exceptions:
             - Throws `std::runtime_error` if the thread pool has been stopped (`stop` is true), indicating tasks can no longer be enqueued.
+
+        Allocation accounting (NLP_COUNT_ALLOCATIONS):
+            - The task runs under the enqueuing thread's current Allocations::Scope, so that scope must
+              outlive the task: only enqueue under a scope tasks that are waited for before it ends.
+              Tasks that outlive the call enqueuing them (e.g. DocumentStream's workers) are enqueued
+              under `Allocations::Adopt unscoped(nullptr)` and are not counted.
         */
 
         using return_type = typename std::invoke_result<F, Args...>::type;
@@ -50,7 +57,15 @@ public:
         {
             std::unique_lock<std::mutex> lock(queueMutex);
             if (stop) throw std::runtime_error("enqueue on stopped ThreadPool");
+#ifdef NLP_COUNT_ALLOCATIONS
+            // The task's allocations are charged to the enqueuing thread's scope, which must outlive it.
+            tasks.emplace([task, scope = Allocations::current()]() {
+                Allocations::Adopt adopt(scope);
+                (*task)();
+                });
+#else
             tasks.emplace([task]() { (*task)(); });
+#endif
         }
         condition.notify_one();
         return res;
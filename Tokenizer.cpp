@@ -1,34 +1,379 @@
 ﻿#include "Tokenizer.h"
 #include "ThreadPool.h"
 #include "Toolkit.h"
+#include "Epoch.h"
+#include "Trace.h"
+#include "Metrics.h"
+#include "SymbolTable.h"
+#include "SharedMemory.h"
+#include "ByteIO.h"
 #include <thread>
 #include <future>
+#include <cctype>
+#include <algorithm>
+#include <numeric>
+#include <cstring>
 
-Tokenizer::Tokenizer(const std::vector<std::string>& vocabList) : vocab(vocabList), idToToken(vocabList) {
+namespace {
+
+// Start of a serialized Tokenizer. The byte order mark rejects images written on a machine of the other endianness.
+const char imageMagic[8] = { 'N', 'L', 'P', 'T', 'O', 'K', '0', '1' };
+const uint32_t byteOrderMark = 0x01020304;
+
+// Maps words to IDs for one snapshot.
+struct WordEncoder {
+    const Vocabulary& vocab;
+    int unknownId;
+
+    void append(std::string_view word, std::vector<int>& ids) const {
+        int id = vocab.find(word);
+        ids.push_back(id >= 0 ? id : unknownId);
+    }
+};
+
+// Collects tokens into groups of Vocabulary::lookupGroup and resolves each group with findBatch,
+// writing the IDs straight to their destinations.
+class GroupLookup {
+private:
+    const WordEncoder& encoder;
+    std::string_view tokens[Vocabulary::lookupGroup];
+    int* targets[Vocabulary::lookupGroup];
+    size_t filled = 0;
+
+public:
+    explicit GroupLookup(const WordEncoder& encoder) : encoder(encoder) {}
+
+    void add(std::string_view token, int* target) {
+        tokens[filled] = token;
+        targets[filled] = target;
+        if (++filled == Vocabulary::lookupGroup) flush();
+    }
+
+    void flush() {
+        int found[Vocabulary::lookupGroup];
+        encoder.vocab.findBatch(tokens, filled, found);
+        for (size_t i = 0; i < filled; ++i) {
+            *targets[i] = found[i] >= 0 ? found[i] : encoder.unknownId;
+        }
+        filled = 0;
+    }
+};
+
+std::vector<int> encodeWith(const WordEncoder& encoder, const std::vector<std::string>& tokens, size_t maxLength) {
+    size_t count = std::min(tokens.size(), maxLength);
+    std::vector<int> encodedTokens(count);
+    GroupLookup lookup(encoder);
+    for (size_t i = 0; i < count; ++i) {
+        lookup.add(tokens[i], &encodedTokens[i]);
+    }
+    lookup.flush();
+    return encodedTokens;
+}
+
+std::vector<std::vector<int>> encodeBlock(const WordEncoder& encoder, const std::vector<std::vector<std::string>>& sentences, size_t start, size_t end, size_t maxLength) {
+    // Groups run across sentence boundaries, so short sentences still fill whole groups.
+    std::vector<std::vector<int>> blockResult;
+    blockResult.reserve(end > start ? end - start : 0);
+
+    GroupLookup lookup(encoder);
+    for (size_t i = start; i < end; ++i) {
+        blockResult.emplace_back(std::min(sentences[i].size(), maxLength));
+        auto& ids = blockResult.back();
+        for (size_t j = 0; j < ids.size(); ++j) {
+            lookup.add(sentences[i][j], &ids[j]);
+        }
+    }
+    lookup.flush();
+    return blockResult;
+}
+
+void logBuffer(const std::string& taskName, const EncodedBuffer& buffer, const std::string& logFile) {
+    if (logFile.empty()) {
+        writeToFile(taskName, std::string(), logFile);
+        return;
+    }
+    std::vector<std::vector<int>> sentences;
+    for (size_t i = 0; i < buffer.size(); ++i) {
+        sentences.emplace_back(buffer.ids.begin() + buffer.offsets[i], buffer.ids.begin() + buffer.offsets[i + 1]);
+    }
+    writeToFile(taskName, sentences, logFile);
+}
+
+// Items and UnknownTokens counters of an encoding operation.
+void countEncoded(const Metrics::Operation& metrics, const std::vector<int>& ids, int unknownId) {
+    metrics.add(Metrics::Items, ids.size());
+    metrics.add(Metrics::UnknownTokens, static_cast<uint64_t>(std::count(ids.begin(), ids.end(), unknownId)));
+}
+
+template <typename Sentences>
+void countEncoded(const Metrics::Operation& metrics, const Sentences& sentences, int unknownId) {
+    uint64_t items = 0, unknown = 0;
+    for (const auto& ids : sentences) {
+        items += ids.size();
+        unknown += static_cast<uint64_t>(std::count(ids.begin(), ids.end(), unknownId));
+    }
+    metrics.add(Metrics::Items, items);
+    metrics.add(Metrics::UnknownTokens, unknown);
+}
+
+uint64_t idCount(const std::vector<std::vector<int>>& sentences) {
+    uint64_t count = 0;
+    for (const auto& ids : sentences) count += ids.size();
+    return count;
+}
+
+std::vector<std::string> decodeWith(const Vocabulary& vocab, const std::vector<int>& ids) {
+    std::vector<std::string> decodedTokens;
+    decodedTokens.reserve(ids.size());
+    for (const auto& id : ids) {
+        if (id >= 0 && id < static_cast<int>(vocab.size())) {
+            decodedTokens.emplace_back(vocab.token(id));
+        }
+        else {
+            throw std::out_of_range("Invalid token ID in decode.");
+        }
+    }
+    return decodedTokens;
+}
+
+// Joins decoded tokens into text. walk() decides every byte of the output once, and both
+// measure() and write() go through it, so the size computed up front is always exact.
+class Detokenizer {
+private:
+    const Vocabulary& vocab;
+    const DetokenizeOptions& options;
+
+    static bool isClosingPunctuation(std::string_view token) {
+        if (token.empty()) return false;
+        for (char c : token) {
+            if (std::string_view(",.!?;:%)]}").find(c) == std::string_view::npos) return false;
+        }
+        return true;
+    }
+
+    static bool isOpeningBracket(std::string_view token) {
+        return token.size() == 1 && std::string_view("([{").find(token[0]) != std::string_view::npos;
+    }
+
+    template <class Emit>
+    void walk(const std::vector<int>& ids, Emit&& emit) const {
+        const std::string_view prefix = options.continuationPrefix;
+        const std::string_view marker = options.spaceMarker;
+        bool first = true;
+        bool afterOpening = false;
+
+        for (int id : ids) {
+            if (id < 0 || id >= static_cast<int>(vocab.size())) {
+                throw std::out_of_range("Invalid token ID in decode.");
+            }
+            std::string_view token = vocab.token(id);
+
+            if (!marker.empty()) {
+                // Spacing is explicit in the tokens: only the markers turn into spaces.
+                size_t pos;
+                while ((pos = token.find(marker)) != std::string_view::npos) {
+                    emit(token.substr(0, pos));
+                    emit(std::string_view(" "));
+                    token.remove_prefix(pos + marker.size());
+                }
+                emit(token);
+                continue;
+            }
+
+            bool joined = first;
+            if (!prefix.empty() && token.size() > prefix.size() && token.compare(0, prefix.size(), prefix) == 0) {
+                token.remove_prefix(prefix.size());
+                joined = true;
+            }
+            else if (options.attachPunctuation && (afterOpening || isClosingPunctuation(token))) {
+                joined = true;
+            }
+
+            if (!joined) emit(std::string_view(" "));
+            emit(token);
+            first = false;
+            afterOpening = options.attachPunctuation && isOpeningBracket(token);
+        }
+    }
+
+public:
+    Detokenizer(const Vocabulary& vocab, const DetokenizeOptions& options) : vocab(vocab), options(options) {}
+
+    size_t measure(const std::vector<int>& ids) const {
+        size_t size = 0;
+        walk(ids, [&size](std::string_view piece) { size += piece.size(); });
+        return size;
+    }
+
+    char* write(const std::vector<int>& ids, char* out) const {
+        walk(ids, [&out](std::string_view piece) {
+            std::memcpy(out, piece.data(), piece.size());
+            out += piece.size();
+            });
+        return out;
+    }
+
+    std::string join(const std::vector<int>& ids) const {
+        std::string text(measure(ids), '\0');
+        write(ids, &text[0]);
+        return text;
+    }
+};
+
+bool isSpace(char c) {
+    return std::isspace(static_cast<unsigned char>(c)) != 0;
+}
+
+// Splits raw text the way encodeText does: special tokens are found first and the text between them
+// is split on whitespace (same as Toolkit::tokenize). Each piece goes to the sink in text order.
+// A bounded sink stops the walk as soon as it is full, so a truncated encode reads only about as much
+// text as it needs instead of the whole document.
+template <class Sink>
+void walkText(const SpecialTokenMatcher& special, std::string_view text, Sink& sink) {
+    size_t pos = 0;
+    size_t window = 4096;
+    SpecialTokenMatch match;
+    while (pos < text.size() && !sink.full()) {
+        // A bounded walk searches for special tokens in growing windows that end on whitespace, so
+        // no word crosses a window edge. The search reads longestPattern() bytes past the edge: a
+        // special token starting inside the window is then found whole, and it is the same match a
+        // search over the whole text would return.
+        size_t end = text.size();
+        std::string_view searched = text;
+        if (sink.bounded() && text.size() - pos > window) {
+            end = pos + window;
+            while (end < text.size() && !isSpace(text[end])) ++end;
+            searched = text.substr(0, std::min(text.size(), end + special.longestPattern()));
+            window *= 2;
+        }
+
+        bool found = special.next(searched, pos, match) && match.begin < end;
+        size_t wordsEnd = found ? match.begin : end;
+        forEachWord(text.substr(pos, wordsEnd - pos), [&](std::string_view word) {
+            sink.word(word);
+            return !sink.full();
+            });
+
+        if (!found) {
+            pos = end;
+        }
+        else if (!sink.full()) {
+            sink.special(match);
+            pos = match.end;
+        }
+    }
+}
+
+struct IdSink {
+    const WordEncoder& encoder;
+    const std::vector<int>& specialIds;
+    std::vector<int>& ids;
+    size_t limit;
+
+    bool bounded() const { return limit != SIZE_MAX; }
+    bool full() const { return ids.size() >= limit; }
+    void word(std::string_view word) { encoder.append(word, ids); }
+    void special(const SpecialTokenMatch& match) { ids.push_back(specialIds[match.pattern]); }
+};
+
+// IdSink that also records where in the text each ID came from.
+struct SpanSink {
+    IdSink idSink;
+    std::vector<TokenSpan>& spans;
+    const char* base;
+
+    bool bounded() const { return idSink.bounded(); }
+    bool full() const { return idSink.full(); }
+
+    void word(std::string_view word) {
+        idSink.word(word);
+        size_t begin = word.data() - base;
+        spans.resize(idSink.ids.size(), TokenSpan{ begin, begin + word.size() });
+    }
+
+    void special(const SpecialTokenMatch& match) {
+        idSink.special(match);
+        spans.push_back(TokenSpan{ match.begin, match.end });
+    }
+};
+
+// Every word and special token is exactly one ID, so counting needs no lookups at all.
+struct CountSink {
+    size_t count = 0;
+
+    bool bounded() const { return false; }
+    bool full() const { return false; }
+    void word(std::string_view) { ++count; }
+    void special(const SpecialTokenMatch&) { ++count; }
+};
+
+}
+
+Tokenizer::Tokenizer(const std::vector<std::string>& vocabList, const std::vector<std::string>& specialTokens) {
     /*
     Input:
         - vocabList: A list of vocabulary strings.
+        - specialTokens: Tokens such as "<s>" or "[CLS]" that encodeText must never split (default is none).
+          Missing ones are appended to the vocabulary.
     Output:
         - Constructs the Tokenizer object, mapping tokens to IDs and vice versa.
     Functionality:
         - Adds an "<UNK>" token if not present for handling unknown tokens.
     */
 
-    for (size_t i = 0; i < vocab.size(); ++i) {
-        tokenToId[vocab[i]] = static_cast<int>(i);
+    Vocabulary initial(vocabList);
+    unknownId = initial.find("<UNK>");
+    if (unknownId < 0) {
+        initial = initial.withTokens({ "<UNK>" });
+        unknownId = initial.find("<UNK>");
     }
-    if (tokenToId.find("<UNK>") == tokenToId.end()) {
-        vocab.push_back("<UNK>");
-        idToToken.push_back("<UNK>");
-        unknownId = static_cast<int>(vocab.size() - 1);
-        tokenToId["<UNK>"] = unknownId;
-    }
-    else {
-        unknownId = tokenToId["<UNK>"];
+    initial = initial.withTokens(specialTokens);
+
+    auto special = std::make_shared<const SpecialTokenMatcher>(specialTokens);
+    std::vector<int> specialIds;
+    for (const auto& pattern : special->getPatterns()) {
+        specialIds.push_back(initial.find(pattern));
     }
+    snapshot.store(new Snapshot{ std::move(initial), std::move(special), std::move(specialIds) });
+}
+
+Tokenizer::~Tokenizer() {
+    /*
+    Functionality:
+        - Frees the current snapshot. The Tokenizer must not be in use by other threads while it is destroyed;
+          snapshots replaced earlier are freed by the epoch reclaimer once their last reader leaves.
+    */
+
+    delete snapshot.load();
+    Epoch::collect();
+}
+
+void Tokenizer::publish(const Snapshot* next) {
+    // Caller holds writeMutex.
+    const Snapshot* previous = snapshot.load();
+    snapshot.store(next);
+    Epoch::retire([previous]() { delete previous; });
+}
+
+void Tokenizer::encodeTextWith(const Snapshot& state, std::string_view text, std::vector<int>& ids, size_t maxLength) const {
+    WordEncoder encoder{ state.vocab, unknownId };
+    size_t limit = maxLength > SIZE_MAX - ids.size() ? SIZE_MAX : ids.size() + maxLength;
+    IdSink sink{ encoder, state.specialIds, ids, limit };
+    walkText(*state.special, text, sink);
+    if (ids.size() > limit) ids.resize(limit);
+}
+
+void Tokenizer::encodeTextWith(const Snapshot& state, std::string_view text, std::vector<int>& ids, std::vector<TokenSpan>& spans, size_t maxLength) const {
+    WordEncoder encoder{ state.vocab, unknownId };
+    spans.resize(ids.size());
+    size_t limit = maxLength > SIZE_MAX - ids.size() ? SIZE_MAX : ids.size() + maxLength;
+    SpanSink sink{ IdSink{ encoder, state.specialIds, ids, limit }, spans, text.data() };
+    walkText(*state.special, text, sink);
+    if (ids.size() > limit) ids.resize(limit);
+    spans.resize(ids.size());
 }
 
-std::vector<int> Tokenizer::encode(const std::vector<std::string>& tokens, const std::string& logFile) {
+std::vector<int> Tokenizer::encode(const std::vector<std::string>& tokens, const std::string& logFile) const {
     /*
     Input:
         - tokens: A vector of strings to encode.
@@ -37,23 +382,71 @@ std::vector<int> Tokenizer::encode(const std::vector<std::string>& tokens, const
         - A vector of integers representing the IDs of the tokens.
     Functionality:
         - Maps each token to its corresponding ID. Unknown tokens are mapped to "<UNK>".
+        - Safe to call from any number of threads, also while another thread runs addTokens.
+    */
+
+    return encode(tokens, SIZE_MAX, logFile);
+}
+
+std::vector<int> Tokenizer::encode(const std::vector<std::string>& tokens, size_t maxLength, const std::string& logFile) const {
+    /*
+    Input:
+        - tokens: A vector of strings to encode.
+        - maxLength: The maximum number of IDs to return.
+        - logFile: A string specifying the name of the file to write the output to (default is "Outputs.txt", don't write if logFile = "").
+    Output:
+        - The IDs of the first `maxLength` tokens.
+    Functionality:
+        - Same as encode, but tokens past `maxLength` are never looked up.
     */
 
+    NLP_TRACE_SCOPE("Tokenizer::encode");
+    static const Metrics::Operation metrics("Tokenizer::encode");
+    Metrics::Timer timer(metrics);
     std::vector<int> encodedTokens;
-    for (const auto& token : tokens) {
-        if (tokenToId.find(token) != tokenToId.end()) {
-            encodedTokens.push_back(tokenToId[token]);
-        }
-        else {
-            encodedTokens.push_back(unknownId);
-        }
+    {
+        Epoch::ReadGuard guard;
+        const Snapshot* state = snapshot.load();
+        encodedTokens = encodeWith(WordEncoder{ state->vocab, unknownId }, tokens, maxLength);
     }
 
+    countEncoded(metrics, encodedTokens, unknownId);
     writeToFile("Encode", encodedTokens, logFile);
     return encodedTokens;
 }
 
-std::vector<std::string> Tokenizer::decode(const std::vector<int>& ids, const std::string& logFile) {
+std::vector<int> Tokenizer::encodeSymbols(const std::vector<uint32_t>& symbols, const std::string& logFile) const {
+    /*
+    Input:
+        - symbols: Symbols of SymbolTable::global(), e.g. from Toolkit::tokenizeToSymbols.
+        - logFile: A string specifying the name of the file to write the output to (default is "Outputs.txt", don't write if logFile = "").
+    Output:
+        - The same IDs as encode on the symbols' text.
+    Functionality:
+        - Looks each symbol up with the hash stored when it was interned, so no token is hashed again.
+    */
+
+    NLP_TRACE_SCOPE("Tokenizer::encodeSymbols");
+    static const Metrics::Operation metrics("Tokenizer::encodeSymbols");
+    Metrics::Timer timer(metrics);
+    const SymbolTable& table = SymbolTable::global();
+    std::vector<int> encodedTokens;
+    encodedTokens.reserve(symbols.size());
+    {
+        Epoch::ReadGuard guard;
+        const Vocabulary& vocab = snapshot.load()->vocab;
+        for (uint32_t symbol : symbols) {
+            int id = vocab.find(table.str(symbol), table.hash(symbol));
+            encodedTokens.push_back(id >= 0 ? id : unknownId);
+        }
+    }
+
+    countEncoded(metrics, encodedTokens, unknownId);
+    writeToFile("Encode Symbols", encodedTokens, logFile);
+    return encodedTokens;
+}
+
+std::vector<std::string> Tokenizer::decode(const std::vector<int>& ids, const std::string& logFile) const {
     /*
     Input:
         - ids: A vector of token IDs to decode.
@@ -64,21 +457,21 @@ std::vector<std::string> Tokenizer::decode(const std::vector<int>& ids, const st
         - Maps each ID to its corresponding token. Throws an exception for invalid IDs.
     */
 
+    NLP_TRACE_SCOPE("Tokenizer::decode");
+    static const Metrics::Operation metrics("Tokenizer::decode");
+    Metrics::Timer timer(metrics);
+    metrics.add(Metrics::Items, ids.size());
     std::vector<std::string> decodedTokens;
-    for (const auto& id : ids) {
-        if (id >= 0 && id < static_cast<int>(idToToken.size())) {
-            decodedTokens.push_back(idToToken[id]);
-        }
-        else {
-            throw std::out_of_range("Invalid token ID in decode.");
-        }
+    {
+        Epoch::ReadGuard guard;
+        decodedTokens = decodeWith(snapshot.load()->vocab, ids);
     }
 
     writeToFile("Decode", decodedTokens, logFile);
     return decodedTokens;
 }
 
-std::vector<std::vector<int>> Tokenizer::batchEncode(const std::vector<std::vector<std::string>>& sentences, int numThreads, const std::string& logFile) {
+std::vector<std::vector<int>> Tokenizer::batchEncode(const std::vector<std::vector<std::string>>& sentences, int numThreads, const std::string& logFile) const {
     /*
     Input:
         - sentences: A batch of token sequences.
@@ -88,8 +481,30 @@ std::vector<std::vector<int>> Tokenizer::batchEncode(const std::vector<std::vect
         - A vector of vectors, where each inner vector contains encoded token IDs for a sentence.
     Functionality:
         - Parallelizes the encoding process using multiple threads.
+        - The whole batch is encoded against one vocabulary snapshot, even if addTokens runs meanwhile.
+        - Each worker resolves its tokens in prefetched groups (Vocabulary::findBatch), so the cache misses
+          of a large vocabulary overlap.
+    */
+
+    return batchEncode(sentences, numThreads, SIZE_MAX, logFile);
+}
+
+std::vector<std::vector<int>> Tokenizer::batchEncode(const std::vector<std::vector<std::string>>& sentences, int numThreads, size_t maxLength, const std::string& logFile) const {
+    /*
+    Input:
+        - sentences: A batch of token sequences.
+        - numThreads: The number of threads to use for processing (-1 is get all).
+        - maxLength: The maximum number of IDs to return per sentence.
+        - logFile: A string specifying the name of the file to write the output to (default is "Outputs.txt", don't write if logFile = "").
+    Output:
+        - A vector of vectors, where each inner vector contains the IDs of the first `maxLength` tokens of a sentence.
+    Functionality:
+        - Same as batchEncode, but tokens past `maxLength` are never looked up.
     */
 
+    NLP_TRACE_SCOPE("Tokenizer::batchEncode");
+    static const Metrics::Operation metrics("Tokenizer::batchEncode");
+    Metrics::Timer timer(metrics);
     size_t numSentences = sentences.size();
     size_t maxThreads = std::thread::hardware_concurrency();
 
@@ -98,35 +513,171 @@ std::vector<std::vector<int>> Tokenizer::batchEncode(const std::vector<std::vect
     }
 
     size_t blockSize = (numSentences + numThreads - 1) / numThreads;
+    // Declared before the pool, so the guard outlives every worker using the snapshot.
+    Epoch::ReadGuard guard;
+    const Snapshot* state = snapshot.load();
     ThreadPool pool(numThreads);
 
     std::vector<std::future<std::vector<std::vector<int>>>> futures;
 
     for (int t = 0; t < numThreads; ++t) {
-        size_t start = t * blockSize;
+        size_t start = std::min(t * blockSize, numSentences);
         size_t end = std::min(start + blockSize, numSentences);
 
         // Use the ThreadPool to enqueue tasks
-        futures.push_back(pool.enqueue([this, &sentences, start, end]() {
-            std::vector<std::vector<int>> blockResult;
-            for (size_t i = start; i < end; ++i) {
-                blockResult.push_back(this->encode(sentences[i],""));
-            }
-            return blockResult;
+        futures.push_back(pool.enqueue([this, state, &sentences, start, end, maxLength]() {
+            WordEncoder encoder{ state->vocab, this->unknownId };
+            return encodeBlock(encoder, sentences, start, end, maxLength);
             }));
     }
 
+    NLP_TRACE_SCOPE("Tokenizer::batchEncode/merge");
     std::vector<std::vector<int>> results;
     for (auto& future : futures) {
         auto blockResult = future.get();
         results.insert(results.end(), blockResult.begin(), blockResult.end());
     }
 
+    countEncoded(metrics, results, unknownId);
     writeToFile("Batch Encode", results, logFile);
     return results;
 }
 
-std::vector<std::vector<std::string>> Tokenizer::batchDecode(const std::vector<std::vector<int>>& encodedSentences, int numThreads, const std::string& logFile) {
+std::pmr::vector<std::pmr::vector<int>> Tokenizer::batchEncode(const std::vector<std::vector<std::string>>& sentences, int numThreads, std::pmr::memory_resource* resource, const std::string& logFile) const {
+    /*
+    Input:
+        - sentences: A batch of token sequences.
+        - numThreads: The number of threads to use for processing (-1 is get all).
+        - resource: The memory resource that the result and every row are allocated from.
+        - logFile: A string specifying the name of the file to write the output to (default is "Outputs.txt", don't write if logFile = "").
+    Output:
+        - The same IDs as batchEncode, allocated from `resource`.
+    Functionality:
+        - The rows are sized on the calling thread and the workers only fill them in, so a resource that
+          is not thread-safe (std::pmr::monotonic_buffer_resource) is fine.
+    */
+
+    NLP_TRACE_SCOPE("Tokenizer::batchEncode");
+    static const Metrics::Operation metrics("Tokenizer::batchEncode");
+    Metrics::Timer timer(metrics);
+    size_t numSentences = sentences.size();
+    size_t maxThreads = std::thread::hardware_concurrency();
+
+    if (numThreads <= 0 || numThreads > static_cast<int>(maxThreads)) {
+        numThreads = maxThreads;
+    }
+
+    std::pmr::vector<std::pmr::vector<int>> results(resource);
+    results.reserve(numSentences);
+    for (const auto& sentence : sentences) {
+        results.emplace_back(sentence.size());
+    }
+
+    size_t blockSize = (numSentences + numThreads - 1) / numThreads;
+    Epoch::ReadGuard guard;
+    const Snapshot* state = snapshot.load();
+    ThreadPool pool(numThreads);
+
+    std::vector<std::future<void>> futures;
+
+    for (int t = 0; t < numThreads; ++t) {
+        size_t start = std::min(t * blockSize, numSentences);
+        size_t end = std::min(start + blockSize, numSentences);
+
+        futures.push_back(pool.enqueue([this, state, &sentences, &results, start, end]() {
+            WordEncoder encoder{ state->vocab, this->unknownId };
+            GroupLookup lookup(encoder);
+            for (size_t i = start; i < end; ++i) {
+                for (size_t j = 0; j < results[i].size(); ++j) {
+                    lookup.add(sentences[i][j], &results[i][j]);
+                }
+            }
+            lookup.flush();
+            }));
+    }
+
+    for (auto& future : futures) {
+        future.get();
+    }
+
+    countEncoded(metrics, results, unknownId);
+    if (logFile.empty()) {
+        writeToFile("Batch Encode", std::string(), logFile);
+    }
+    else {
+        std::vector<std::vector<int>> ids;
+        for (const auto& row : results) ids.emplace_back(row.begin(), row.end());
+        writeToFile("Batch Encode", ids, logFile);
+    }
+    return results;
+}
+
+EncodedBuffer Tokenizer::batchEncodeToBuffer(const std::vector<std::vector<std::string>>& sentences, int numThreads, size_t maxLength, const std::string& logFile) const {
+    /*
+    Input:
+        - sentences: A batch of token sequences.
+        - numThreads: The number of threads to use for processing (default is 2 and -1 is get all).
+        - maxLength: The maximum number of IDs per sentence (default is no limit).
+        - logFile: A string specifying the name of the file to write the output to (default is "Outputs.txt", don't write if logFile = "").
+    Output:
+        - An EncodedBuffer holding the IDs of every sentence in one vector, with the offset of each sentence.
+    Functionality:
+        - Same IDs as batchEncode. Every sentence's length is known up front, so the offsets are computed
+          first and the workers write their IDs straight into disjoint ranges of one allocation.
+        - Meant for handing the batch to other runtimes (e.g. NumPy) without copying it again.
+    */
+
+    NLP_TRACE_SCOPE("Tokenizer::batchEncodeToBuffer");
+    static const Metrics::Operation metrics("Tokenizer::batchEncodeToBuffer");
+    Metrics::Timer timer(metrics);
+    size_t numSentences = sentences.size();
+    size_t maxThreads = std::thread::hardware_concurrency();
+
+    if (numThreads <= 0 || numThreads > static_cast<int>(maxThreads)) {
+        numThreads = maxThreads;
+    }
+
+    EncodedBuffer buffer;
+    buffer.offsets.assign(numSentences + 1, 0);
+    for (size_t i = 0; i < numSentences; ++i) {
+        buffer.offsets[i + 1] = buffer.offsets[i] + std::min(sentences[i].size(), maxLength);
+    }
+    buffer.ids.resize(buffer.offsets[numSentences]);
+
+    size_t blockSize = (numSentences + numThreads - 1) / numThreads;
+    Epoch::ReadGuard guard;
+    const Snapshot* state = snapshot.load();
+    ThreadPool pool(numThreads);
+
+    std::vector<std::future<void>> futures;
+
+    for (int t = 0; t < numThreads; ++t) {
+        size_t start = std::min(t * blockSize, numSentences);
+        size_t end = std::min(start + blockSize, numSentences);
+
+        futures.push_back(pool.enqueue([this, state, &sentences, &buffer, start, end]() {
+            WordEncoder encoder{ state->vocab, this->unknownId };
+            GroupLookup lookup(encoder);
+            for (size_t i = start; i < end; ++i) {
+                int* out = buffer.ids.data() + buffer.offsets[i];
+                for (size_t j = 0; j < buffer.offsets[i + 1] - buffer.offsets[i]; ++j) {
+                    lookup.add(sentences[i][j], out + j);
+                }
+            }
+            lookup.flush();
+            }));
+    }
+
+    for (auto& future : futures) {
+        future.get();
+    }
+
+    countEncoded(metrics, buffer.ids, unknownId);
+    logBuffer("Batch Encode To Buffer", buffer, logFile);
+    return buffer;
+}
+
+std::vector<std::vector<std::string>> Tokenizer::batchDecode(const std::vector<std::vector<int>>& encodedSentences, int numThreads, const std::string& logFile) const {
     /*
     Input:
         - encodedSentences: A batch of token ID sequences.
@@ -138,6 +689,10 @@ std::vector<std::vector<std::string>> Tokenizer::batchDecode(const std::vector<s
         - Parallelizes the decoding process using multiple threads.
     */
 
+    NLP_TRACE_SCOPE("Tokenizer::batchDecode");
+    static const Metrics::Operation metrics("Tokenizer::batchDecode");
+    Metrics::Timer timer(metrics);
+    metrics.add(Metrics::Items, idCount(encodedSentences));
     size_t numSentences = encodedSentences.size();
     size_t maxThreads = std::thread::hardware_concurrency();
 
@@ -146,24 +701,27 @@ std::vector<std::vector<std::string>> Tokenizer::batchDecode(const std::vector<s
     }
 
     size_t blockSize = (numSentences + numThreads - 1) / numThreads;
+    Epoch::ReadGuard guard;
+    const Vocabulary* vocab = &snapshot.load()->vocab;
     ThreadPool pool(numThreads);
 
     std::vector<std::future<std::vector<std::vector<std::string>>>> futures;
 
     for (int t = 0; t < numThreads; ++t) {
-        size_t start = t * blockSize;
+        size_t start = std::min(t * blockSize, numSentences);
         size_t end = std::min(start + blockSize, numSentences);
 
         // Use the ThreadPool to enqueue tasks
-        futures.push_back(pool.enqueue([this, &encodedSentences, start, end]() {
+        futures.push_back(pool.enqueue([vocab, &encodedSentences, start, end]() {
             std::vector<std::vector<std::string>> blockResult;
             for (size_t i = start; i < end; ++i) {
-                blockResult.push_back(this->decode(encodedSentences[i],""));
+                blockResult.push_back(decodeWith(*vocab, encodedSentences[i]));
             }
             return blockResult;
             }));
     }
 
+    NLP_TRACE_SCOPE("Tokenizer::batchDecode/merge");
     std::vector<std::vector<std::string>> results;
     for (auto& future : futures) {
         auto blockResult = future.get();
@@ -173,3 +731,807 @@ std::vector<std::vector<std::string>> Tokenizer::batchDecode(const std::vector<s
     writeToFile("Batch Decode", results, logFile);
     return results;
 }
+
+std::string Tokenizer::decodeToString(const std::vector<int>& ids, const DetokenizeOptions& options, const std::string& logFile) const {
+    /*
+    Input:
+        - ids: A vector of token IDs to decode.
+        - options: Joining rules (see DetokenizeOptions; default joins with spaces, attaches punctuation and "##" pieces).
+        - logFile: A string specifying the name of the file to write the output to (default is "Outputs.txt", don't write if logFile = "").
+    Output:
+        - The decoded text as one string.
+    Functionality:
+        - Computes the exact output size first, then writes every token straight into one preallocated string,
+          applying the joining rules in the same pass. No per-token strings are created.
+        - Throws `std::out_of_range` for invalid IDs, like decode.
+    */
+
+    NLP_TRACE_SCOPE("Tokenizer::decodeToString");
+    static const Metrics::Operation metrics("Tokenizer::decodeToString");
+    Metrics::Timer timer(metrics);
+    metrics.add(Metrics::Items, ids.size());
+    std::string text;
+    {
+        Epoch::ReadGuard guard;
+        text = Detokenizer(snapshot.load()->vocab, options).join(ids);
+    }
+
+    writeToFile("Decode To String", text, logFile);
+    return text;
+}
+
+std::vector<std::string> Tokenizer::batchDecodeToString(const std::vector<std::vector<int>>& encodedSentences, int numThreads, const DetokenizeOptions& options, const std::string& logFile) const {
+    /*
+    Input:
+        - encodedSentences: A batch of token ID sequences.
+        - numThreads: The number of threads to use for processing (default is 2 and -1 is get all).
+        - options: Joining rules (see DetokenizeOptions).
+        - logFile: A string specifying the name of the file to write the output to (default is "Outputs.txt", don't write if logFile = "").
+    Output:
+        - One decoded string per sentence.
+    Functionality:
+        - Parallel decodeToString: each sentence gets exactly one allocation of its final size.
+    */
+
+    NLP_TRACE_SCOPE("Tokenizer::batchDecodeToString");
+    static const Metrics::Operation metrics("Tokenizer::batchDecodeToString");
+    Metrics::Timer timer(metrics);
+    metrics.add(Metrics::Items, idCount(encodedSentences));
+    size_t numSentences = encodedSentences.size();
+    size_t maxThreads = std::thread::hardware_concurrency();
+
+    if (numThreads <= 0 || numThreads > static_cast<int>(maxThreads)) {
+        numThreads = maxThreads;
+    }
+
+    size_t blockSize = (numSentences + numThreads - 1) / numThreads;
+    Epoch::ReadGuard guard;
+    Detokenizer detokenizer(snapshot.load()->vocab, options);
+    ThreadPool pool(numThreads);
+
+    std::vector<std::future<std::vector<std::string>>> futures;
+
+    for (int t = 0; t < numThreads; ++t) {
+        size_t start = std::min(t * blockSize, numSentences);
+        size_t end = std::min(start + blockSize, numSentences);
+
+        futures.push_back(pool.enqueue([&detokenizer, &encodedSentences, start, end]() {
+            std::vector<std::string> blockResult;
+            blockResult.reserve(end > start ? end - start : 0);
+            for (size_t i = start; i < end; ++i) {
+                blockResult.push_back(detokenizer.join(encodedSentences[i]));
+            }
+            return blockResult;
+            }));
+    }
+
+    NLP_TRACE_SCOPE("Tokenizer::batchDecodeToString/merge");
+    std::vector<std::string> results;
+    results.reserve(numSentences);
+    for (auto& future : futures) {
+        auto blockResult = future.get();
+        results.insert(results.end(), std::make_move_iterator(blockResult.begin()), std::make_move_iterator(blockResult.end()));
+    }
+
+    writeToFile("Batch Decode To String", results, logFile);
+    return results;
+}
+
+DecodedBatch Tokenizer::batchDecodeToBuffer(const std::vector<std::vector<int>>& encodedSentences, int numThreads, const DetokenizeOptions& options, const std::string& logFile) const {
+    /*
+    Input:
+        - encodedSentences: A batch of token ID sequences.
+        - numThreads: The number of threads to use for processing (default is 2 and -1 is get all).
+        - options: Joining rules (see DetokenizeOptions).
+        - logFile: A string specifying the name of the file to write the output to (default is "Outputs.txt", don't write if logFile = "").
+    Output:
+        - A DecodedBatch holding every sentence in one buffer, with the offset of each sentence.
+    Functionality:
+        - Workers first measure their sentences in parallel; a prefix sum then places every sentence,
+          and the workers write into disjoint ranges of the single buffer. The whole batch costs one allocation.
+    */
+
+    NLP_TRACE_SCOPE("Tokenizer::batchDecodeToBuffer");
+    static const Metrics::Operation metrics("Tokenizer::batchDecodeToBuffer");
+    Metrics::Timer timer(metrics);
+    metrics.add(Metrics::Items, idCount(encodedSentences));
+    size_t numSentences = encodedSentences.size();
+    size_t maxThreads = std::thread::hardware_concurrency();
+
+    if (numThreads <= 0 || numThreads > static_cast<int>(maxThreads)) {
+        numThreads = maxThreads;
+    }
+
+    size_t blockSize = (numSentences + numThreads - 1) / numThreads;
+    Epoch::ReadGuard guard;
+    Detokenizer detokenizer(snapshot.load()->vocab, options);
+    ThreadPool pool(numThreads);
+
+    DecodedBatch batch;
+    batch.offsets.assign(numSentences + 1, 0);
+
+    std::vector<std::future<void>> futures;
+    for (int t = 0; t < numThreads; ++t) {
+        size_t start = std::min(t * blockSize, numSentences);
+        size_t end = std::min(start + blockSize, numSentences);
+        futures.push_back(pool.enqueue([&detokenizer, &encodedSentences, &batch, start, end]() {
+            for (size_t i = start; i < end; ++i) {
+                batch.offsets[i + 1] = detokenizer.measure(encodedSentences[i]);
+            }
+            }));
+    }
+    for (auto& future : futures) future.get();
+
+    for (size_t i = 0; i < numSentences; ++i) {
+        batch.offsets[i + 1] += batch.offsets[i];
+    }
+    batch.data.resize(batch.offsets[numSentences]);
+
+    futures.clear();
+    for (int t = 0; t < numThreads; ++t) {
+        size_t start = std::min(t * blockSize, numSentences);
+        size_t end = std::min(start + blockSize, numSentences);
+        futures.push_back(pool.enqueue([&detokenizer, &encodedSentences, &batch, start, end]() {
+            for (size_t i = start; i < end; ++i) {
+                detokenizer.write(encodedSentences[i], &batch.data[0] + batch.offsets[i]);
+            }
+            }));
+    }
+    for (auto& future : futures) future.get();
+
+    if (logFile.empty()) {
+        writeToFile("Batch Decode To Buffer", std::string(), logFile);
+    }
+    else {
+        std::vector<std::string> sentences;
+        for (size_t i = 0; i < batch.size(); ++i) sentences.emplace_back(batch.sentence(i));
+        writeToFile("Batch Decode To Buffer", sentences, logFile);
+    }
+    return batch;
+}
+
+std::vector<int> Tokenizer::encodeText(const std::string& text, const std::string& logFile) const {
+    /*
+    Input:
+        - text: Raw text to encode.
+        - logFile: A string specifying the name of the file to write the output to (default is "Outputs.txt", don't write if logFile = "").
+    Output:
+        - A vector of integers representing the IDs of the tokens.
+    Functionality:
+        - Finds special tokens in the raw text first and emits their reserved IDs, then splits the text
+          between them on whitespace (as Toolkit::tokenize does) and maps each word to its ID.
+        - "a<s>b" encodes to the IDs of "a", "<s>", "b" when "<s>" is a special token.
+    */
+
+    return encodeText(text, SIZE_MAX, logFile);
+}
+
+std::vector<int> Tokenizer::encodeText(const std::string& text, size_t maxLength, const std::string& logFile) const {
+    /*
+    Input:
+        - text: Raw text to encode.
+        - maxLength: The maximum number of IDs to return.
+        - logFile: A string specifying the name of the file to write the output to (default is "Outputs.txt", don't write if logFile = "").
+    Output:
+        - The first `maxLength` IDs of encodeText(text).
+    Functionality:
+        - Stops scanning the text once `maxLength` IDs were produced, so taking the first 512 IDs of a long
+          document costs about the same as encoding a short one.
+    */
+
+    NLP_TRACE_SCOPE("Tokenizer::encodeText");
+    static const Metrics::Operation metrics("Tokenizer::encodeText");
+    Metrics::Timer timer(metrics);
+    std::vector<int> ids;
+    encodeTextInto(text, ids, maxLength);
+
+    countEncoded(metrics, ids, unknownId);
+    metrics.add(Metrics::Bytes, text.size());
+    writeToFile("Encode Text", ids, logFile);
+    return ids;
+}
+
+std::vector<std::vector<int>> Tokenizer::batchEncodeText(const std::vector<std::string>& texts, int numThreads, const std::string& logFile) const {
+    /*
+    Input:
+        - texts: A batch of raw texts.
+        - numThreads: The number of threads to use for processing (default is 2 and -1 is get all).
+        - logFile: A string specifying the name of the file to write the output to (default is "Outputs.txt", don't write if logFile = "").
+    Output:
+        - A vector of vectors, where each inner vector contains the encoded token IDs of a text.
+    Functionality:
+        - Runs encodeText over blocks of texts in parallel, all against one snapshot.
+    */
+
+    return batchEncodeText(texts, numThreads, SIZE_MAX, logFile);
+}
+
+std::vector<std::vector<int>> Tokenizer::batchEncodeText(const std::vector<std::string>& texts, int numThreads, size_t maxLength, const std::string& logFile) const {
+    /*
+    Input:
+        - texts: A batch of raw texts.
+        - numThreads: The number of threads to use for processing (-1 is get all).
+        - maxLength: The maximum number of IDs to return per text.
+        - logFile: A string specifying the name of the file to write the output to (default is "Outputs.txt", don't write if logFile = "").
+    Output:
+        - A vector of vectors, where each inner vector contains the first `maxLength` IDs of a text.
+    Functionality:
+        - Runs the truncated encodeText over blocks of texts in parallel, all against one snapshot.
+    */
+
+    NLP_TRACE_SCOPE("Tokenizer::batchEncodeText");
+    static const Metrics::Operation metrics("Tokenizer::batchEncodeText");
+    Metrics::Timer timer(metrics);
+    size_t numTexts = texts.size();
+    size_t maxThreads = std::thread::hardware_concurrency();
+
+    if (numThreads <= 0 || numThreads > static_cast<int>(maxThreads)) {
+        numThreads = maxThreads;
+    }
+
+    size_t blockSize = (numTexts + numThreads - 1) / numThreads;
+    Epoch::ReadGuard guard;
+    const Snapshot* state = snapshot.load();
+    ThreadPool pool(numThreads);
+
+    std::vector<std::future<std::vector<std::vector<int>>>> futures;
+
+    for (int t = 0; t < numThreads; ++t) {
+        size_t start = std::min(t * blockSize, numTexts);
+        size_t end = std::min(start + blockSize, numTexts);
+
+        futures.push_back(pool.enqueue([this, state, &texts, start, end, maxLength]() {
+            std::vector<std::vector<int>> blockResult;
+            for (size_t i = start; i < end; ++i) {
+                blockResult.emplace_back();
+                this->encodeTextWith(*state, texts[i], blockResult.back(), maxLength);
+            }
+            return blockResult;
+            }));
+    }
+
+    NLP_TRACE_SCOPE("Tokenizer::batchEncodeText/merge");
+    std::vector<std::vector<int>> results;
+    for (auto& future : futures) {
+        auto blockResult = future.get();
+        results.insert(results.end(), blockResult.begin(), blockResult.end());
+    }
+
+    countEncoded(metrics, results, unknownId);
+    metrics.add(Metrics::Bytes, Metrics::bytesOf(texts));
+    writeToFile("Batch Encode Text", results, logFile);
+    return results;
+}
+
+EncodedBuffer Tokenizer::batchEncodeTextToBuffer(const std::vector<std::string>& texts, int numThreads, size_t maxLength, const std::string& logFile) const {
+    /*
+    Input:
+        - texts: A batch of raw texts.
+        - numThreads: The number of threads to use for processing (default is 2 and -1 is get all).
+        - maxLength: The maximum number of IDs per text (default is no limit).
+        - logFile: A string specifying the name of the file to write the output to (default is "Outputs.txt", don't write if logFile = "").
+    Output:
+        - An EncodedBuffer holding the IDs of every text in one vector, with the offset of each text.
+    Functionality:
+        - Same IDs as batchEncodeText. Each worker encodes its block into one vector of its own, and the
+          blocks are then joined with one copy each, instead of one vector per text.
+    */
+
+    return batchEncodeTextToBuffer(std::vector<std::string_view>(texts.begin(), texts.end()), numThreads, maxLength, logFile);
+}
+
+EncodedBuffer Tokenizer::batchEncodeTextToBuffer(const std::vector<std::string_view>& texts, int numThreads, size_t maxLength, const std::string& logFile) const {
+    /*
+    Input:
+        - texts: A batch of raw texts, borrowed (e.g. straight from Python or Arrow buffers).
+        - numThreads, maxLength, logFile: As in the std::string overload.
+    Output:
+        - An EncodedBuffer holding the IDs of every text in one vector, with the offset of each text.
+    */
+
+    NLP_TRACE_SCOPE("Tokenizer::batchEncodeTextToBuffer");
+    static const Metrics::Operation metrics("Tokenizer::batchEncodeTextToBuffer");
+    Metrics::Timer timer(metrics);
+    size_t numTexts = texts.size();
+    size_t maxThreads = std::thread::hardware_concurrency();
+
+    if (numThreads <= 0 || numThreads > static_cast<int>(maxThreads)) {
+        numThreads = maxThreads;
+    }
+
+    size_t blockSize = (numTexts + numThreads - 1) / numThreads;
+    EncodedBuffer buffer;
+    buffer.offsets.assign(numTexts + 1, 0);
+    Epoch::ReadGuard guard;
+    const Snapshot* state = snapshot.load();
+    ThreadPool pool(numThreads);
+
+    std::vector<std::future<std::vector<int>>> futures;
+
+    for (int t = 0; t < numThreads; ++t) {
+        size_t start = std::min(t * blockSize, numTexts);
+        size_t end = std::min(start + blockSize, numTexts);
+
+        // Each worker records the end of each of its texts relative to its block.
+        futures.push_back(pool.enqueue([this, state, &texts, &buffer, start, end, maxLength]() {
+            std::vector<int> blockIds;
+            for (size_t i = start; i < end; ++i) {
+                this->encodeTextWith(*state, texts[i], blockIds, maxLength);
+                buffer.offsets[i + 1] = blockIds.size();
+            }
+            return blockIds;
+            }));
+    }
+
+    std::vector<std::vector<int>> blocks;
+    size_t total = 0;
+    for (auto& future : futures) {
+        blocks.push_back(future.get());
+        total += blocks.back().size();
+    }
+
+    NLP_TRACE_SCOPE("Tokenizer::batchEncodeTextToBuffer/merge");
+    buffer.ids.reserve(total);
+    for (int t = 0; t < numThreads; ++t) {
+        size_t start = std::min(t * blockSize, numTexts);
+        size_t end = std::min(start + blockSize, numTexts);
+        size_t base = buffer.ids.size();
+        for (size_t i = start; i < end; ++i) {
+            buffer.offsets[i + 1] += base;
+        }
+        buffer.ids.insert(buffer.ids.end(), blocks[t].begin(), blocks[t].end());
+    }
+
+    countEncoded(metrics, buffer.ids, unknownId);
+    metrics.add(Metrics::Bytes, Metrics::bytesOf(texts));
+    logBuffer("Batch Encode Text To Buffer", buffer, logFile);
+    return buffer;
+}
+
+PaddedBatch Tokenizer::batchEncodeTextPadded(const std::vector<std::string>& texts, int numThreads, size_t maxLength, int padId, const std::string& logFile) const {
+    /*
+    Input:
+        - texts: A batch of raw texts.
+        - numThreads: The number of threads to use for processing (default is 2 and -1 is get all).
+        - maxLength: The maximum number of IDs per text (default is no limit).
+        - padId: ID written after the end of shorter texts (default is 0).
+        - logFile: A string specifying the name of the file to write the output to (default is "Outputs.txt", don't write if logFile = "").
+    Output:
+        - A PaddedBatch: one row per text, as wide as the longest encoded text, plus its attention mask.
+    */
+
+    return batchEncodeTextPadded(std::vector<std::string_view>(texts.begin(), texts.end()), numThreads, maxLength, padId, logFile);
+}
+
+PaddedBatch Tokenizer::batchEncodeTextPadded(const std::vector<std::string_view>& texts, int numThreads, size_t maxLength, int padId, const std::string& logFile) const {
+    /*
+    Input:
+        - texts: A batch of raw texts, borrowed (e.g. straight from Python or Arrow buffers).
+        - numThreads, maxLength, padId, logFile: As in the std::string overload.
+    Output:
+        - A PaddedBatch: one row per text, as wide as the longest encoded text, plus its attention mask.
+    Functionality:
+        - Encodes with batchEncodeTextToBuffer, then lays the rows out in the rectangular shape model inputs expect.
+    */
+
+    NLP_TRACE_SCOPE("Tokenizer::batchEncodeTextPadded");
+    static const Metrics::Operation metrics("Tokenizer::batchEncodeTextPadded");
+    Metrics::Timer timer(metrics);
+    EncodedBuffer buffer = batchEncodeTextToBuffer(texts, numThreads, maxLength, "");
+
+    PaddedBatch batch;
+    batch.rows = buffer.size();
+    for (size_t i = 0; i < batch.rows; ++i) {
+        batch.columns = std::max(batch.columns, buffer.offsets[i + 1] - buffer.offsets[i]);
+    }
+
+    batch.ids.assign(batch.rows * batch.columns, padId);
+    batch.attentionMask.assign(batch.rows * batch.columns, 0);
+    for (size_t i = 0; i < batch.rows; ++i) {
+        size_t length = buffer.offsets[i + 1] - buffer.offsets[i];
+        std::copy_n(buffer.ids.begin() + buffer.offsets[i], length, batch.ids.begin() + i * batch.columns);
+        std::fill_n(batch.attentionMask.begin() + i * batch.columns, length, 1);
+    }
+
+    countEncoded(metrics, buffer.ids, unknownId);
+    metrics.add(Metrics::Bytes, Metrics::bytesOf(texts));
+
+    if (logFile.empty()) {
+        writeToFile("Batch Encode Text Padded", std::string(), logFile);
+    }
+    else {
+        std::vector<std::vector<int>> rows;
+        for (size_t i = 0; i < batch.rows; ++i) {
+            rows.emplace_back(batch.ids.begin() + i * batch.columns, batch.ids.begin() + (i + 1) * batch.columns);
+        }
+        writeToFile("Batch Encode Text Padded", rows, logFile);
+    }
+    return batch;
+}
+
+void Tokenizer::encodeTextInto(std::string_view text, std::vector<int>& ids, size_t maxLength) const {
+    /*
+    Input:
+        - text: Raw text to encode.
+        - ids: Receives the IDs, appended after its current contents.
+        - maxLength: The maximum number of IDs to append (default is no limit).
+    Functionality:
+        - Same as encodeText without the log file, for pipelines that reuse one output buffer.
+    */
+
+    Epoch::ReadGuard guard;
+    encodeTextWith(*snapshot.load(), text, ids, maxLength);
+}
+
+void Tokenizer::encodeTextInto(std::string_view text, std::vector<int>& ids, std::vector<TokenSpan>& spans, size_t maxLength) const {
+    /*
+    Input:
+        - text: Raw text to encode.
+        - ids: Receives the IDs, appended after its current contents.
+        - spans: Receives the byte range of each appended ID in `text`; it is resized to match `ids`.
+        - maxLength: The maximum number of IDs to append (default is no limit).
+    Functionality:
+        - Same as encodeTextInto, for callers that need to map IDs back to the source text (e.g. Chunker).
+    */
+
+    Epoch::ReadGuard guard;
+    encodeTextWith(*snapshot.load(), text, ids, spans, maxLength);
+}
+
+size_t Tokenizer::countTokens(const std::string& text, const std::string& logFile) const {
+    /*
+    Input:
+        - text: Raw text.
+        - logFile: A string specifying the name of the file to write the output to (default is "Outputs.txt", don't write if logFile = "").
+    Output:
+        - encodeText(text).size(), e.g. for a token budget check.
+    Functionality:
+        - Walks the text like encodeText but only counts: no vocabulary lookups, no IDs and no strings.
+    */
+
+    NLP_TRACE_SCOPE("Tokenizer::countTokens");
+    static const Metrics::Operation metrics("Tokenizer::countTokens");
+    Metrics::Timer timer(metrics);
+    CountSink sink;
+    {
+        Epoch::ReadGuard guard;
+        walkText(*snapshot.load()->special, text, sink);
+    }
+
+    metrics.add(Metrics::Items, sink.count);
+    metrics.add(Metrics::Bytes, text.size());
+    writeToFile("Count Tokens", std::to_string(sink.count), logFile);
+    return sink.count;
+}
+
+std::vector<size_t> Tokenizer::batchCountTokens(const std::vector<std::string>& texts, int numThreads, const std::string& logFile) const {
+    /*
+    Input:
+        - texts: A batch of raw texts.
+        - numThreads: The number of threads to use for processing (default is 2 and -1 is get all).
+        - logFile: A string specifying the name of the file to write the output to (default is "Outputs.txt", don't write if logFile = "").
+    Output:
+        - The token count of each text.
+    Functionality:
+        - Runs countTokens over blocks of texts in parallel, all against one snapshot.
+    */
+
+    NLP_TRACE_SCOPE("Tokenizer::batchCountTokens");
+    static const Metrics::Operation metrics("Tokenizer::batchCountTokens");
+    Metrics::Timer timer(metrics);
+    size_t numTexts = texts.size();
+    size_t maxThreads = std::thread::hardware_concurrency();
+
+    if (numThreads <= 0 || numThreads > static_cast<int>(maxThreads)) {
+        numThreads = maxThreads;
+    }
+
+    size_t blockSize = (numTexts + numThreads - 1) / numThreads;
+    std::vector<size_t> counts(numTexts);
+    Epoch::ReadGuard guard;
+    const SpecialTokenMatcher* special = snapshot.load()->special.get();
+    ThreadPool pool(numThreads);
+
+    std::vector<std::future<void>> futures;
+
+    for (int t = 0; t < numThreads; ++t) {
+        size_t start = std::min(t * blockSize, numTexts);
+        size_t end = std::min(start + blockSize, numTexts);
+
+        futures.push_back(pool.enqueue([special, &texts, &counts, start, end]() {
+            for (size_t i = start; i < end; ++i) {
+                CountSink sink;
+                walkText(*special, texts[i], sink);
+                counts[i] = sink.count;
+            }
+            }));
+    }
+
+    for (auto& future : futures) {
+        future.get();
+    }
+
+    metrics.add(Metrics::Items, std::accumulate(counts.begin(), counts.end(), size_t(0)));
+    metrics.add(Metrics::Bytes, Metrics::bytesOf(texts));
+    writeToFile("Batch Count Tokens", counts, logFile);
+    return counts;
+}
+
+std::vector<int> Tokenizer::addTokens(const std::vector<std::string>& tokens) {
+    /*
+    Input:
+        - tokens: Tokens to add to the vocabulary. Tokens that already exist keep their ID.
+    Output:
+        - The ID of every input token, in input order.
+    Functionality:
+        - Builds a new vocabulary snapshot with the extra tokens and publishes it with one atomic store.
+          Encoders running meanwhile keep the snapshot they started with and never block.
+        - The replaced snapshot is freed once no reader can still hold it (see Epoch).
+        - Each call copies the table, so add tokens in batches rather than one by one.
+    */
+
+    NLP_TRACE_SCOPE("Tokenizer::addTokens");
+    static const Metrics::Operation metrics("Tokenizer::addTokens");
+    Metrics::Timer timer(metrics);
+    metrics.add(Metrics::Items, tokens.size());
+    std::lock_guard<std::mutex> lock(writeMutex);
+    const Snapshot* current = snapshot.load();
+    auto* next = new Snapshot{ current->vocab.withTokens(tokens), current->special, current->specialIds };
+
+    std::vector<int> ids;
+    ids.reserve(tokens.size());
+    for (const auto& token : tokens) {
+        ids.push_back(next->vocab.find(token));
+    }
+
+    publish(next);
+    return ids;
+}
+
+std::vector<int> Tokenizer::addSpecialTokens(const std::vector<std::string>& tokens) {
+    /*
+    Input:
+        - tokens: Special tokens to add. They are appended to the vocabulary if missing.
+    Output:
+        - The ID of every input token, in input order.
+    Functionality:
+        - Rebuilds the special-token automaton and publishes it together with the vocabulary, like addTokens.
+    */
+
+    NLP_TRACE_SCOPE("Tokenizer::addSpecialTokens");
+    static const Metrics::Operation metrics("Tokenizer::addSpecialTokens");
+    Metrics::Timer timer(metrics);
+    metrics.add(Metrics::Items, tokens.size());
+    std::lock_guard<std::mutex> lock(writeMutex);
+    const Snapshot* current = snapshot.load();
+
+    std::vector<std::string> patterns = current->special->getPatterns();
+    for (const auto& token : tokens) {
+        if (!token.empty() && std::find(patterns.begin(), patterns.end(), token) == patterns.end()) {
+            patterns.push_back(token);
+        }
+    }
+
+    auto* next = new Snapshot{ current->vocab.withTokens(tokens), std::make_shared<const SpecialTokenMatcher>(patterns), {} };
+    for (const auto& pattern : next->special->getPatterns()) {
+        next->specialIds.push_back(next->vocab.find(pattern));
+    }
+
+    std::vector<int> ids;
+    ids.reserve(tokens.size());
+    for (const auto& token : tokens) {
+        ids.push_back(next->vocab.find(token));
+    }
+
+    publish(next);
+    return ids;
+}
+
+std::vector<std::string> Tokenizer::getSpecialTokens() const {
+    /*
+    Output:
+        - The special tokens recognized by encodeText, in the order they were added.
+    */
+
+    Epoch::ReadGuard guard;
+    return snapshot.load()->special->getPatterns();
+}
+
+int Tokenizer::tokenId(const std::string& token) const {
+    /*
+    Input:
+        - token: A single token to look up.
+    Output:
+        - The ID of the token, or the "<UNK>" ID if it is not in the vocabulary.
+    Functionality:
+        - Read-only lookup that never writes to a log file, for callers that encode token by token.
+    */
+
+    Epoch::ReadGuard guard;
+    int id = snapshot.load()->vocab.find(token);
+    return id >= 0 ? id : unknownId;
+}
+
+size_t Tokenizer::vocabSize() const {
+    /*
+    Output:
+        - The number of IDs in the vocabulary, including "<UNK>".
+    */
+
+    Epoch::ReadGuard guard;
+    return snapshot.load()->vocab.size();
+}
+
+std::string Tokenizer::imageOf(const Snapshot& state, bool withTable) const {
+    /*
+    Functionality:
+        - Layout: magic, byte order mark, "<UNK>" ID, the special tokens (count, then length and bytes
+          of each), then the vocabulary (see Vocabulary::serialize). Every field is 8-byte aligned.
+    */
+
+    std::string image;
+    ByteIO::append(image, imageMagic, sizeof(imageMagic));
+    ByteIO::append<uint32_t>(image, byteOrderMark);
+    ByteIO::append<int64_t>(image, unknownId);
+
+    const auto& patterns = state.special->getPatterns();
+    ByteIO::append<uint64_t>(image, patterns.size());
+    for (const auto& pattern : patterns) {
+        ByteIO::append<uint64_t>(image, pattern.size());
+        ByteIO::append(image, pattern.data(), pattern.size());
+    }
+
+    state.vocab.serialize(image, withTable);
+    return image;
+}
+
+Tokenizer::Snapshot* Tokenizer::readImage(std::string_view data, std::shared_ptr<const void> region, int& unknownId) {
+    /*
+    Input:
+        - data: An image written by imageOf.
+        - region: Owner of `data` if the vocabulary should be a view of it, null to copy it.
+        - unknownId: Receives the "<UNK>" ID.
+    Output:
+        - A new snapshot. Throws `std::runtime_error` if the data is not a valid image.
+    */
+
+    size_t pos = 0;
+    ByteIO::Reader reader(data, pos);
+    if (std::memcmp(reader.take<char>(sizeof(imageMagic)), imageMagic, sizeof(imageMagic)) != 0) {
+        throw std::runtime_error("Not a serialized Tokenizer.");
+    }
+    if (reader.read<uint32_t>() != byteOrderMark) {
+        throw std::runtime_error("Serialized Tokenizer has the wrong byte order.");
+    }
+    int64_t unknown = reader.read<int64_t>();
+
+    uint64_t numPatterns = reader.read<uint64_t>();
+    std::vector<std::string> patterns;
+    for (uint64_t i = 0; i < numPatterns; ++i) {
+        uint64_t length = reader.read<uint64_t>();
+        patterns.emplace_back(reader.take<char>(length), length);
+    }
+
+    Vocabulary vocab = region ? Vocabulary::view(data, pos, std::move(region)) : Vocabulary::deserialize(data, pos);
+    if (unknown < 0 || static_cast<uint64_t>(unknown) >= vocab.size()) {
+        throw std::runtime_error("Serialized Tokenizer is corrupt.");
+    }
+    unknownId = static_cast<int>(unknown);
+
+    auto special = std::make_shared<const SpecialTokenMatcher>(patterns);
+    std::vector<int> specialIds;
+    for (const auto& pattern : special->getPatterns()) {
+        specialIds.push_back(vocab.find(pattern));
+    }
+    return new Snapshot{ std::move(vocab), std::move(special), std::move(specialIds) };
+}
+
+std::string Tokenizer::serialize(bool withTable) const {
+    /*
+    Input:
+        - withTable: Also store the vocabulary's hash slots (default is no). Roughly doubles the size
+          and saves rebuilding them on load; shareMemory uses it so readers can look up in place.
+    Output:
+        - The Tokenizer as a compact binary image: the vocabulary text, its offsets and the special tokens.
+          deserialize() turns it back into an identical Tokenizer.
+    Functionality:
+        - Images are portable between builds but not between machines of different byte order.
+    */
+
+    Epoch::ReadGuard guard;
+    return imageOf(*snapshot.load(), withTable);
+}
+
+std::unique_ptr<Tokenizer> Tokenizer::deserialize(std::string_view data) {
+    /*
+    Input:
+        - data: An image written by serialize().
+    Output:
+        - A new Tokenizer with the same IDs and special tokens. Throws `std::runtime_error` for invalid data.
+    */
+
+    int id = 0;
+    std::unique_ptr<Snapshot> state(readImage(data, nullptr, id));
+    std::unique_ptr<Tokenizer> tokenizer(new Tokenizer());
+    tokenizer->unknownId = id;
+    tokenizer->snapshot.store(state.release());
+    return tokenizer;
+}
+
+void Tokenizer::shareMemory(const std::string& name) {
+    /*
+    Input:
+        - name: POSIX shared-memory segment to create (e.g. "/nlp_vocab"). It must not exist yet.
+    Output:
+        - None (void).
+    Functionality:
+        - Writes the current vocabulary, hash table included, to the segment, then switches this Tokenizer
+          to a view of it and frees its own copy. Other processes call attachSharedMemory(name) and look
+          tokens up in the same physical pages, so N processes hold the table once.
+        - The segment stays until unlinkSharedMemory(name), even after every process has exited.
+        - Later addTokens calls copy the table back into private memory; the segment keeps the old state.
+        - Throws `std::system_error` if the segment cannot be created; on Windows always throws `std::runtime_error`.
+    */
+
+    std::lock_guard<std::mutex> lock(writeMutex);
+    const Snapshot* current = snapshot.load();
+    SharedMemory::create(name, imageOf(*current, true));
+
+    Snapshot* next;
+    try {
+        auto memory = SharedMemory::open(name);
+        std::string_view data(memory->data(), memory->size());
+        int id = 0;
+        next = readImage(data, std::move(memory), id);
+    }
+    catch (...) {
+        SharedMemory::unlink(name);
+        throw;
+    }
+    next->sharedName = name;
+    publish(next);
+}
+
+std::string Tokenizer::sharedMemoryName() const {
+    /*
+    Output:
+        - The segment the vocabulary is currently read from, or "" if this Tokenizer owns its table.
+    */
+
+    Epoch::ReadGuard guard;
+    return snapshot.load()->sharedName;
+}
+
+std::unique_ptr<Tokenizer> Tokenizer::attachSharedMemory(const std::string& name) {
+    /*
+    Input:
+        - name: A segment created by shareMemory, possibly in another process.
+    Output:
+        - A Tokenizer reading the vocabulary straight from the segment. Only the special-token automaton is built
+          locally; the vocabulary pages are shared with every other process attached to it.
+    Functionality:
+        - The mapping stays valid after the segment is unlinked, until this Tokenizer and its snapshots are gone.
+    */
+
+    auto memory = SharedMemory::open(name);
+    std::string_view data(memory->data(), memory->size());
+    int id = 0;
+    std::unique_ptr<Snapshot> state(readImage(data, std::move(memory), id));
+    state->sharedName = name;
+    std::unique_ptr<Tokenizer> tokenizer(new Tokenizer());
+    tokenizer->unknownId = id;
+    tokenizer->snapshot.store(state.release());
+    return tokenizer;
+}
+
+bool Tokenizer::unlinkSharedMemory(const std::string& name) {
+    /*
+    Input:
+        - name: A segment created by shareMemory.
+    Output:
+        - false if the segment does not exist. Tokenizers attached to it keep working; the memory is
+          returned once the last of them is destroyed.
+    */
+
+    return SharedMemory::unlink(name);
+}
@@ -1,23 +1,143 @@
 #pragma once
 #include <vector>
 #include <string>
-#include <unordered_map>
+#include <string_view>
+#include <atomic>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include "Vocabulary.h"
+#include "SpecialTokenMatcher.h"
+
+struct DetokenizeOptions {
+    std::string continuationPrefix = "##";  // WordPiece: a token starting with it joins the previous one ("" to disable).
+    std::string spaceMarker = "";           // Byte-level BPE (e.g. "\xC4\xA0" for U+0120): tokens are concatenated and the marker becomes a space.
+    bool attachPunctuation = true;          // No space before , . ! ? ; : % ) ] } or after ( [ {.
+};
+
+struct DecodedBatch {
+    std::string data;                       // All sentences back to back in one buffer.
+    std::vector<size_t> offsets;            // Sentence i is data[offsets[i], offsets[i + 1]).
+
+    size_t size() const { return offsets.empty() ? 0 : offsets.size() - 1; }
+    std::string_view sentence(size_t i) const { return std::string_view(data).substr(offsets[i], offsets[i + 1] - offsets[i]); }
+};
+
+struct EncodedBuffer {
+    std::vector<int> ids;                   // All sentences back to back in one buffer.
+    std::vector<size_t> offsets;            // Sentence i is ids[offsets[i], offsets[i + 1]).
+
+    size_t size() const { return offsets.empty() ? 0 : offsets.size() - 1; }
+};
+
+struct PaddedBatch {
+    std::vector<int> ids;                   // Row-major rows x columns, short rows filled with the pad ID.
+    std::vector<int> attentionMask;         // 1 where ids holds a real token, 0 for padding.
+    size_t rows = 0;
+    size_t columns = 0;                     // Length of the longest row.
+};
+
+struct TokenSpan {
+    size_t begin = 0;                       // Byte range of the token in the encoded text.
+    size_t end = 0;
+};
 
 class Tokenizer {
 private:
-    std::vector<std::string> vocab;                     
-    std::unordered_map<std::string, int> tokenToId;        
-    std::vector<std::string> idToToken;                   
-    int unknownId = -1;              
+    struct Snapshot {
+        Vocabulary vocab;
+        std::shared_ptr<const SpecialTokenMatcher> special;   // Shared by snapshots until the special tokens change.
+        std::vector<int> specialIds;                          // ID of each matcher pattern.
+        std::string sharedName = "";                          // Shared-memory segment `vocab` is a view of, "" if it owns its table.
+    };
+
+    std::atomic<const Snapshot*> snapshot{ nullptr };   // Current state, replaced as a whole by writers.
+    std::mutex writeMutex;                              // Serializes writers only; readers never lock.
+    int unknownId = -1;
+
+    Tokenizer() = default;
+
+    std::string imageOf(const Snapshot& state, bool withTable) const;
+
+    static Snapshot* readImage(std::string_view data, std::shared_ptr<const void> region, int& unknownId);
+
+    void publish(const Snapshot* next);
+
+    void encodeTextWith(const Snapshot& state, std::string_view text, std::vector<int>& ids, size_t maxLength = SIZE_MAX) const;
+
+    void encodeTextWith(const Snapshot& state, std::string_view text, std::vector<int>& ids, std::vector<TokenSpan>& spans, size_t maxLength) const;
 
 public:
-    Tokenizer(const std::vector<std::string>& vocabList);
+    Tokenizer(const std::vector<std::string>& vocabList, const std::vector<std::string>& specialTokens = {});
+    ~Tokenizer();
+
+    std::vector<int> encode(const std::vector<std::string>& tokens, const std::string& logFile = "Outputs.txt") const;
+
+    std::vector<int> encode(const std::vector<std::string>& tokens, size_t maxLength, const std::string& logFile = "Outputs.txt") const;
+
+    std::vector<int> encodeSymbols(const std::vector<uint32_t>& symbols, const std::string& logFile = "Outputs.txt") const;
+
+    std::vector<std::string> decode(const std::vector<int>& ids, const std::string& logFile = "Outputs.txt") const;
+
+    std::vector<std::vector<int>> batchEncode(const std::vector<std::vector<std::string>>& sentences, int numThreads = 2, const std::string& logFile = "Outputs.txt") const;
+
+    std::vector<std::vector<int>> batchEncode(const std::vector<std::vector<std::string>>& sentences, int numThreads, size_t maxLength, const std::string& logFile = "Outputs.txt") const;
+
+    std::pmr::vector<std::pmr::vector<int>> batchEncode(const std::vector<std::vector<std::string>>& sentences, int numThreads, std::pmr::memory_resource* resource, const std::string& logFile = "Outputs.txt") const;
+
+    EncodedBuffer batchEncodeToBuffer(const std::vector<std::vector<std::string>>& sentences, int numThreads = 2, size_t maxLength = SIZE_MAX, const std::string& logFile = "Outputs.txt") const;
+
+    std::vector<std::vector<std::string>> batchDecode(const std::vector<std::vector<int>>& encodedSentences, int numThreads = 2, const std::string& logFile = "Outputs.txt") const;
+
+    std::string decodeToString(const std::vector<int>& ids, const DetokenizeOptions& options = DetokenizeOptions(), const std::string& logFile = "Outputs.txt") const;
+
+    std::vector<std::string> batchDecodeToString(const std::vector<std::vector<int>>& encodedSentences, int numThreads = 2, const DetokenizeOptions& options = DetokenizeOptions(), const std::string& logFile = "Outputs.txt") const;
+
+    DecodedBatch batchDecodeToBuffer(const std::vector<std::vector<int>>& encodedSentences, int numThreads = 2, const DetokenizeOptions& options = DetokenizeOptions(), const std::string& logFile = "Outputs.txt") const;
+
+    std::vector<int> encodeText(const std::string& text, const std::string& logFile = "Outputs.txt") const;
+
+    std::vector<int> encodeText(const std::string& text, size_t maxLength, const std::string& logFile = "Outputs.txt") const;
+
+    std::vector<std::vector<int>> batchEncodeText(const std::vector<std::string>& texts, int numThreads = 2, const std::string& logFile = "Outputs.txt") const;
+
+    std::vector<std::vector<int>> batchEncodeText(const std::vector<std::string>& texts, int numThreads, size_t maxLength, const std::string& logFile = "Outputs.txt") const;
+
+    EncodedBuffer batchEncodeTextToBuffer(const std::vector<std::string>& texts, int numThreads = 2, size_t maxLength = SIZE_MAX, const std::string& logFile = "Outputs.txt") const;
+
+    EncodedBuffer batchEncodeTextToBuffer(const std::vector<std::string_view>& texts, int numThreads = 2, size_t maxLength = SIZE_MAX, const std::string& logFile = "Outputs.txt") const;
+
+    PaddedBatch batchEncodeTextPadded(const std::vector<std::string>& texts, int numThreads = 2, size_t maxLength = SIZE_MAX, int padId = 0, const std::string& logFile = "Outputs.txt") const;
+
+    PaddedBatch batchEncodeTextPadded(const std::vector<std::string_view>& texts, int numThreads = 2, size_t maxLength = SIZE_MAX, int padId = 0, const std::string& logFile = "Outputs.txt") const;
+
+    void encodeTextInto(std::string_view text, std::vector<int>& ids, size_t maxLength = SIZE_MAX) const;
+
+    void encodeTextInto(std::string_view text, std::vector<int>& ids, std::vector<TokenSpan>& spans, size_t maxLength = SIZE_MAX) const;
+
+    size_t countTokens(const std::string& text, const std::string& logFile = "Outputs.txt") const;
+
+    std::vector<size_t> batchCountTokens(const std::vector<std::string>& texts, int numThreads = 2, const std::string& logFile = "Outputs.txt") const;
+
+    std::vector<int> addTokens(const std::vector<std::string>& tokens);
+
+    std::vector<int> addSpecialTokens(const std::vector<std::string>& tokens);
+
+    std::vector<std::string> getSpecialTokens() const;
+
+    int tokenId(const std::string& token) const;
+
+    size_t vocabSize() const;
+
+    std::string serialize(bool withTable = false) const;
+
+    static std::unique_ptr<Tokenizer> deserialize(std::string_view data);
 
-    std::vector<int> encode(const std::vector<std::string>& tokens, const std::string& logFile = "Outputs.txt");
+    void shareMemory(const std::string& name);
 
-    std::vector<std::string> decode(const std::vector<int>& ids, const std::string& logFile = "Outputs.txt");
+    std::string sharedMemoryName() const;
 
-    std::vector<std::vector<int>> batchEncode(const std::vector<std::vector<std::string>>& sentences, int numThreads = 2, const std::string& logFile = "Outputs.txt");
+    static std::unique_ptr<Tokenizer> attachSharedMemory(const std::string& name);
 
-    std::vector<std::vector<std::string>> batchDecode(const std::vector<std::vector<int>>& encodedSentences, int numThreads = 2, const std::string& logFile = "Outputs.txt");
+    static bool unlinkSharedMemory(const std::string& name);
 };
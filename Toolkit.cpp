@@ -1,7 +1,14 @@
 ﻿#include "Toolkit.h"
 #include "ThreadPool.h"
+#include "Metrics.h"
+#include "Trace.h"
+#include "SymbolTable.h"
 #include <sstream>
 #include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <functional>
+#include <numeric>
 #include <random>
 #include <thread>
 #include <future>
@@ -15,6 +22,7 @@ void writeToFile(const std::string& taskName, const OutputType& output, const st
         - taskName: A string representing the name of the task.
         - output: A variant (std::variant) containing various possible data types:
             - std::vector<int>
+            - std::vector<size_t>
             - std::vector<std::vector<int>>
             - std::vector<std::string>
             - std::vector<std::vector<std::string>>
@@ -34,6 +42,8 @@ void writeToFile(const std::string& taskName, const OutputType& output, const st
             - For strings: Writes the string directly.
         - Ensures the file is properly closed after writing.
     */
+
+    NLP_TRACE_SCOPE("writeToFile");
     if (fileName == "") {
         std::cout << "\033[33mSkip write task: " << taskName << "\033[0m\n";
         return;
@@ -50,7 +60,7 @@ void writeToFile(const std::string& taskName, const OutputType& output, const st
     std::visit([&outFile](auto&& value) {
         using T = std::decay_t<decltype(value)>;
 
-        if constexpr (std::is_same_v<T, std::vector<int>>) {
+        if constexpr (std::is_same_v<T, std::vector<int>> || std::is_same_v<T, std::vector<size_t>>) {
             for (const auto& item : value) {
                 outFile << item << " ";
             }
@@ -143,6 +153,13 @@ std::unordered_set<std::string> readFromFileTXT(const std::string& filename) {
     return items;
 }
 
+std::vector<std::string> splitWords(const std::string& text) {
+    // The whitespace split behind tokenize, without logging, for operations that tokenize internally.
+    std::vector<std::string> tokens;
+    forEachWord(text, [&](std::string_view word) { tokens.emplace_back(word); });
+    return tokens;
+}
+
 std::vector<std::string> Toolkit::tokenize(const std::string& text, const std::string& logFile) {
     /*
     Input:
@@ -154,18 +171,367 @@ std::vector<std::string> Toolkit::tokenize(const std::string& text, const std::s
         - Splits the input string into words using whitespace as the delimiter.
     */
 
-    std::vector<std::string> tokens;
-    std::istringstream stream(text);
-    std::string word;
+    NLP_TRACE_SCOPE("Toolkit::tokenize");
+    static const Metrics::Operation metrics("Toolkit::tokenize");
+    Metrics::Timer timer(metrics);
+    std::vector<std::string> tokens = splitWords(text);
+    metrics.add(Metrics::Items, tokens.size());
+    metrics.add(Metrics::Bytes, text.size());
+    writeToFile("Tokenize", tokens, logFile);
+    return tokens;
+}
 
-    while (stream >> word) {
-        tokens.push_back(word);
+std::vector<std::string> Toolkit::tokenize(const std::string& text, size_t maxTokens, const std::string& logFile) {
+    /*
+    Input:
+        - text: A string to be tokenized.
+        - maxTokens: The maximum number of tokens to return.
+        - logFile: A string specifying the name of the file to write the output to (default is "Outputs.txt", don't write if logFile = "").
+    Output:
+        - The first `maxTokens` tokens (words) of the text.
+    Functionality:
+        - Same split as tokenize, but stops reading the text once `maxTokens` words were found.
+    */
+
+    NLP_TRACE_SCOPE("Toolkit::tokenize");
+    static const Metrics::Operation metrics("Toolkit::tokenize");
+    Metrics::Timer timer(metrics);
+    std::vector<std::string> tokens;
+    if (maxTokens > 0) {
+        forEachWord(text, [&](std::string_view word) {
+            tokens.emplace_back(word);
+            return tokens.size() < maxTokens;
+            });
     }
 
+    metrics.add(Metrics::Items, tokens.size());
+    metrics.add(Metrics::Bytes, text.size());
     writeToFile("Tokenize", tokens, logFile);
     return tokens;
 }
 
+std::pmr::vector<std::pmr::string> Toolkit::tokenize(const std::string& text, std::pmr::memory_resource* resource, const std::string& logFile) {
+    /*
+    Input:
+        - text: A string to be tokenized.
+        - resource: The memory resource that the vector and every token are allocated from, e.g. a
+          std::pmr::monotonic_buffer_resource owned by the request.
+        - logFile: A string specifying the name of the file to write the output to (default is "Outputs.txt", don't write if logFile = "").
+    Output:
+        - A vector of tokens (words), all allocated from `resource`.
+    Functionality:
+        - Same split as tokenize. Dropping the arena frees the tokens at once instead of one by one.
+    */
+
+    NLP_TRACE_SCOPE("Toolkit::tokenize");
+    static const Metrics::Operation metrics("Toolkit::tokenize");
+    Metrics::Timer timer(metrics);
+    std::pmr::vector<std::pmr::string> tokens(resource);
+    forEachWord(text, [&](std::string_view word) { tokens.emplace_back(word); });
+
+    metrics.add(Metrics::Items, tokens.size());
+    metrics.add(Metrics::Bytes, text.size());
+    if (logFile.empty()) {
+        writeToFile("Tokenize", std::string(), logFile);
+    }
+    else {
+        writeToFile("Tokenize", std::vector<std::string>(tokens.begin(), tokens.end()), logFile);
+    }
+    return tokens;
+}
+
+void runBlocks(size_t numItems, int numThreads, const std::function<void(size_t, size_t)>& work) {
+    // Runs work(start, end) over numThreads contiguous blocks of [0, numItems) and waits for all of them.
+    size_t blockSize = (numItems + numThreads - 1) / numThreads;
+    ThreadPool pool(numThreads);
+    std::vector<std::future<void>> futures;
+    for (int t = 0; t < numThreads; ++t) {
+        size_t start = std::min(t * blockSize, numItems);
+        size_t end = std::min(start + blockSize, numItems);
+        futures.push_back(pool.enqueue([&work, start, end]() { work(start, end); }));
+    }
+    for (auto& future : futures) {
+        future.get();
+    }
+}
+
+void Toolkit::tokenizeInto(std::string_view text, TokenizedBatch& batch) {
+    /*
+    Input:
+        - text: The string to tokenize.
+        - batch: Receives the tokens of `text` as its next text.
+    Functionality:
+        - Same split as tokenize, without the log file, for pipelines that fill one batch text by text.
+    */
+
+    if (batch.tokens.offsets.empty()) batch.tokens.offsets.push_back(batch.tokens.data.size());
+    if (batch.textOffsets.empty()) batch.textOffsets.push_back(batch.tokens.size());
+
+    forEachWord(text, [&](std::string_view word) {
+        batch.tokens.data.append(word);
+        batch.tokens.offsets.push_back(batch.tokens.data.size());
+        });
+    batch.textOffsets.push_back(batch.tokens.size());
+}
+
+// The text of each symbol, for logging.
+std::vector<std::string> symbolTexts(const std::vector<uint32_t>& symbols) {
+    const SymbolTable& table = SymbolTable::global();
+    std::vector<std::string> texts;
+    texts.reserve(symbols.size());
+    for (uint32_t symbol : symbols) texts.emplace_back(table.str(symbol));
+    return texts;
+}
+
+std::vector<uint32_t> Toolkit::tokenizeToSymbols(const std::string& text, const std::string& logFile) {
+    /*
+    Input:
+        - text: A string to be tokenized.
+        - logFile: A string specifying the name of the file to write the output to (default is "Outputs.txt", don't write if logFile = "").
+    Output:
+        - The symbol of each token in SymbolTable::global(), in order.
+    Functionality:
+        - Same split as tokenize, but each word is interned instead of copied, so a word that occurs
+          many times (or in many texts) is stored once. Feed the result to getBagOfSymbols,
+          getSymbolNGrams or Tokenizer::encodeSymbols.
+    */
+
+    NLP_TRACE_SCOPE("Toolkit::tokenizeToSymbols");
+    static const Metrics::Operation metrics("Toolkit::tokenizeToSymbols");
+    Metrics::Timer timer(metrics);
+    SymbolTable& table = SymbolTable::global();
+    std::vector<uint32_t> symbols;
+    forEachWord(text, [&](std::string_view word) { symbols.push_back(table.intern(word)); });
+
+    metrics.add(Metrics::Items, symbols.size());
+    metrics.add(Metrics::Bytes, text.size());
+    if (logFile.empty()) {
+        writeToFile("Tokenize To Symbols", std::string(), logFile);
+    }
+    else {
+        writeToFile("Tokenize To Symbols", symbolTexts(symbols), logFile);
+    }
+    return symbols;
+}
+
+TokenizedBatch Toolkit::batchTokenize(const std::vector<std::string_view>& texts, int numThreads, const std::string& logFile) {
+    /*
+    Input:
+        - texts: A batch of strings, borrowed (e.g. straight from Python or Arrow buffers).
+        - numThreads: The number of threads to use for processing (default is 2 and -1 is get all).
+        - logFile: A string specifying the name of the file to write the output to (default is "Outputs.txt", don't write if logFile = "").
+    Output:
+        - The tokens of all texts in one flat TokenizedBatch.
+    Functionality:
+        - Same split as tokenize. A first parallel pass counts the tokens and bytes of each text, the counts
+          are turned into offsets, and a second parallel pass copies every token into its place, so the whole
+          batch takes two allocations however many tokens it has.
+    */
+
+    NLP_TRACE_SCOPE("Toolkit::batchTokenize");
+    static const Metrics::Operation metrics("Toolkit::batchTokenize");
+    Metrics::Timer timer(metrics);
+    size_t maxThreads = std::thread::hardware_concurrency();
+    if (numThreads <= 0 || numThreads > static_cast<int>(maxThreads)) {
+        numThreads = maxThreads;
+    }
+
+    size_t numTexts = texts.size();
+    std::vector<size_t> tokenCounts(numTexts), byteCounts(numTexts);
+    runBlocks(numTexts, numThreads, [&](size_t start, size_t end) {
+        for (size_t i = start; i < end; ++i) {
+            size_t tokens = 0, bytes = 0;
+            forEachWord(texts[i], [&](std::string_view word) {
+                ++tokens;
+                bytes += word.size();
+                });
+            tokenCounts[i] = tokens;
+            byteCounts[i] = bytes;
+        }
+        });
+
+    TokenizedBatch batch;
+    std::vector<size_t> byteStarts(numTexts + 1, 0);
+    batch.textOffsets.assign(numTexts + 1, 0);
+    for (size_t i = 0; i < numTexts; ++i) {
+        batch.textOffsets[i + 1] = batch.textOffsets[i] + tokenCounts[i];
+        byteStarts[i + 1] = byteStarts[i] + byteCounts[i];
+    }
+    batch.tokens.data.resize(byteStarts[numTexts]);
+    batch.tokens.offsets.resize(batch.textOffsets[numTexts] + 1);
+    batch.tokens.offsets[batch.textOffsets[numTexts]] = byteStarts[numTexts];
+
+    runBlocks(numTexts, numThreads, [&](size_t start, size_t end) {
+        for (size_t i = start; i < end; ++i) {
+            size_t token = batch.textOffsets[i];
+            size_t out = byteStarts[i];
+            forEachWord(texts[i], [&](std::string_view word) {
+                batch.tokens.offsets[token++] = out;
+                std::memcpy(&batch.tokens.data[out], word.data(), word.size());
+                out += word.size();
+                });
+        }
+        });
+
+    metrics.add(Metrics::Items, batch.tokens.size());
+    metrics.add(Metrics::Bytes, Metrics::bytesOf(texts));
+
+    if (logFile.empty()) {
+        writeToFile("Batch Tokenize", std::string(), logFile);
+    }
+    else {
+        std::vector<std::vector<std::string>> tokens(numTexts);
+        for (size_t i = 0; i < numTexts; ++i) {
+            for (size_t j = batch.textOffsets[i]; j < batch.textOffsets[i + 1]; ++j) {
+                tokens[i].emplace_back(batch.tokens.at(j));
+            }
+        }
+        writeToFile("Batch Tokenize", tokens, logFile);
+    }
+    return batch;
+}
+
+StringBatch Toolkit::batchNormalize(const std::vector<std::string_view>& texts, bool lower, bool removePunctuation, int numThreads, const std::string& logFile) {
+    /*
+    Input:
+        - texts: A batch of strings, borrowed (e.g. straight from Python or Arrow buffers).
+        - lower: Convert ASCII letters to lowercase, like toLower (default is true).
+        - removePunctuation: Drop ASCII punctuation, like removePunctuation (default is true).
+        - numThreads: The number of threads to use for processing (default is 2 and -1 is get all).
+        - logFile: A string specifying the name of the file to write the output to (default is "Outputs.txt", don't write if logFile = "").
+    Output:
+        - The normalized texts in one StringBatch.
+    Functionality:
+        - Measures each output in a first parallel pass and writes all of them into one buffer in a second.
+        - Only ASCII bytes are changed, so multi-byte UTF-8 characters pass through intact.
+    */
+
+    NLP_TRACE_SCOPE("Toolkit::batchNormalize");
+    static const Metrics::Operation metrics("Toolkit::batchNormalize");
+    Metrics::Timer timer(metrics);
+    size_t maxThreads = std::thread::hardware_concurrency();
+    if (numThreads <= 0 || numThreads > static_cast<int>(maxThreads)) {
+        numThreads = maxThreads;
+    }
+
+    auto dropped = [removePunctuation](char c) {
+        unsigned char byte = static_cast<unsigned char>(c);
+        return removePunctuation && byte < 128 && std::ispunct(byte);
+    };
+
+    size_t numTexts = texts.size();
+    StringBatch batch;
+    batch.offsets.assign(numTexts + 1, 0);
+    runBlocks(numTexts, numThreads, [&](size_t start, size_t end) {
+        for (size_t i = start; i < end; ++i) {
+            batch.offsets[i + 1] = static_cast<size_t>(std::count_if(texts[i].begin(), texts[i].end(), [&](char c) { return !dropped(c); }));
+        }
+        });
+
+    for (size_t i = 0; i < numTexts; ++i) {
+        batch.offsets[i + 1] += batch.offsets[i];
+    }
+    batch.data.resize(batch.offsets[numTexts]);
+
+    runBlocks(numTexts, numThreads, [&](size_t start, size_t end) {
+        for (size_t i = start; i < end; ++i) {
+            char* out = &batch.data[0] + batch.offsets[i];
+            for (char c : texts[i]) {
+                if (dropped(c)) continue;
+                *out++ = (lower && c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+            }
+        }
+        });
+
+    metrics.add(Metrics::Items, numTexts);
+    metrics.add(Metrics::Bytes, Metrics::bytesOf(texts));
+
+    if (logFile.empty()) {
+        writeToFile("Batch Normalize", std::string(), logFile);
+    }
+    else {
+        std::vector<std::string> normalized;
+        for (size_t i = 0; i < numTexts; ++i) {
+            normalized.emplace_back(batch.at(i));
+        }
+        writeToFile("Batch Normalize", normalized, logFile);
+    }
+    return batch;
+}
+
+size_t countWords(const std::string& text) {
+    size_t count = 0;
+    forEachWord(text, [&](std::string_view) { ++count; });
+    return count;
+}
+
+size_t Toolkit::countTokens(const std::string& text, const std::string& logFile) {
+    /*
+    Input:
+        - text: A string to count the tokens of.
+        - logFile: A string specifying the name of the file to write the output to (default is "Outputs.txt", don't write if logFile = "").
+    Output:
+        - The number of tokens tokenize would return.
+    Functionality:
+        - Counts word starts in one pass without creating any strings.
+    */
+
+    NLP_TRACE_SCOPE("Toolkit::countTokens");
+    static const Metrics::Operation metrics("Toolkit::countTokens");
+    Metrics::Timer timer(metrics);
+    size_t count = countWords(text);
+
+    metrics.add(Metrics::Items, count);
+    metrics.add(Metrics::Bytes, text.size());
+    writeToFile("Count Tokens", std::to_string(count), logFile);
+    return count;
+}
+
+std::vector<size_t> Toolkit::batchCountTokens(const std::vector<std::string>& texts, int numThreads, const std::string& logFile) {
+    /*
+    Input:
+        - texts: A batch of strings.
+        - numThreads: The number of threads to use for processing (default is 2 and -1 is get all).
+        - logFile: A string specifying the name of the file to write the output to (default is "Outputs.txt", don't write if logFile = "").
+    Output:
+        - The token count of each text.
+    Functionality:
+        - Runs countTokens over blocks of texts in parallel.
+    */
+
+    NLP_TRACE_SCOPE("Toolkit::batchCountTokens");
+    static const Metrics::Operation metrics("Toolkit::batchCountTokens");
+    Metrics::Timer timer(metrics);
+    size_t maxThreads = std::thread::hardware_concurrency();
+    if (numThreads <= 0 || numThreads > static_cast<int>(maxThreads)) {
+        numThreads = maxThreads;
+    }
+
+    std::vector<size_t> counts(texts.size());
+    size_t blockSize = (texts.size() + numThreads - 1) / numThreads;
+    ThreadPool pool(numThreads);
+    std::vector<std::future<void>> futures;
+
+    for (int t = 0; t < numThreads; ++t) {
+        size_t start = std::min(t * blockSize, texts.size());
+        size_t end = std::min(start + blockSize, texts.size());
+        futures.push_back(pool.enqueue([&texts, &counts, start, end]() {
+            for (size_t i = start; i < end; ++i) {
+                counts[i] = countWords(texts[i]);
+            }
+            }));
+    }
+
+    for (auto& future : futures) {
+        future.get();
+    }
+
+    metrics.add(Metrics::Items, std::accumulate(counts.begin(), counts.end(), size_t(0)));
+    metrics.add(Metrics::Bytes, Metrics::bytesOf(texts));
+    writeToFile("Batch Count Tokens", counts, logFile);
+    return counts;
+}
+
 std::unordered_map<std::string, int> Toolkit::getBagOfWords(const std::vector<std::string>& tokens, int numThreads, const std::string& logFile) {
     /*
     Input:
@@ -178,6 +544,10 @@ std::unordered_map<std::string, int> Toolkit::getBagOfWords(const std::vector<st
         - Splits the tokens into chunks and processes each chunk in parallel to count token occurrences.
     */
 
+    NLP_TRACE_SCOPE("Toolkit::getBagOfWords");
+    static const Metrics::Operation metrics("Toolkit::getBagOfWords");
+    Metrics::Timer timer(metrics);
+    metrics.add(Metrics::Items, tokens.size());
     size_t maxThreads = std::thread::hardware_concurrency();
     if (numThreads <= 0 || numThreads > static_cast<int>(maxThreads)) {
         numThreads = maxThreads;
@@ -187,17 +557,21 @@ std::unordered_map<std::string, int> Toolkit::getBagOfWords(const std::vector<st
     auto splitBlocks = splitTokens(tokens, numThreads);
 
     ThreadPool pool(numThreads);
+    std::vector<std::future<void>> futures;
 
     for (int i = 0; i < numThreads; ++i) {
-        pool.enqueue([&results, &splitBlocks, i] {
+        futures.push_back(pool.enqueue([&results, &splitBlocks, i] {
             for (const auto& token : splitBlocks[i]) {
                 results[i][token]++;
             }
-            });
+            }));
     }
 
-    pool.~ThreadPool();
+    for (auto& future : futures) {
+        future.get();
+    }
 
+    NLP_TRACE_SCOPE("Toolkit::getBagOfWords/merge");
     std::unordered_map<std::string, int> combinedResult;
     for (const auto& result : results) {
         for (const auto& [token, count] : result) {
@@ -209,6 +583,112 @@ std::unordered_map<std::string, int> Toolkit::getBagOfWords(const std::vector<st
     return combinedResult;
 }
 
+std::pmr::unordered_map<std::pmr::string, int> Toolkit::getBagOfWords(const std::pmr::vector<std::pmr::string>& tokens, int numThreads, std::pmr::memory_resource* resource, const std::string& logFile) {
+    /*
+    Input:
+        - tokens: A vector of strings (tokens), e.g. from the arena overload of tokenize.
+        - numThreads: The number of threads to use for processing (-1 is get all).
+        - resource: The memory resource that the map and its keys are allocated from.
+        - logFile: A string specifying the name of the file to write the output to (default is "Outputs.txt", don't write if logFile = "").
+    Output:
+        - An unordered map where keys are words and values are their frequencies, allocated from `resource`.
+    Functionality:
+        - The workers count views of the tokens in their own maps; only the calling thread allocates from
+          `resource`, so a resource that is not thread-safe (std::pmr::monotonic_buffer_resource) is fine.
+    */
+
+    NLP_TRACE_SCOPE("Toolkit::getBagOfWords");
+    static const Metrics::Operation metrics("Toolkit::getBagOfWords");
+    Metrics::Timer timer(metrics);
+    metrics.add(Metrics::Items, tokens.size());
+    size_t maxThreads = std::thread::hardware_concurrency();
+    if (numThreads <= 0 || numThreads > static_cast<int>(maxThreads)) {
+        numThreads = maxThreads;
+    }
+
+    std::vector<std::unordered_map<std::string_view, int>> results(numThreads);
+    size_t blockSize = (tokens.size() + numThreads - 1) / numThreads;
+    runBlocks(tokens.size(), numThreads, [&](size_t start, size_t end) {
+        auto& result = results[blockSize ? start / blockSize : 0];
+        for (size_t i = start; i < end; ++i) {
+            result[tokens[i]]++;
+        }
+        });
+
+    NLP_TRACE_SCOPE("Toolkit::getBagOfWords/merge");
+    // Merged by view first, so each distinct word is copied into the arena exactly once.
+    std::unordered_map<std::string_view, int> merged;
+    for (const auto& result : results) {
+        for (const auto& [token, count] : result) {
+            merged[token] += count;
+        }
+    }
+    std::pmr::unordered_map<std::pmr::string, int> combinedResult(merged.size(), resource);
+    for (const auto& [token, count] : merged) {
+        combinedResult.emplace(token, count);
+    }
+
+    if (logFile.empty()) {
+        writeToFile("Bag Of Words", std::string(), logFile);
+    }
+    else {
+        std::unordered_map<std::string, int> counts;
+        for (const auto& [token, count] : combinedResult) counts.emplace(token, count);
+        writeToFile("Bag Of Words", counts, logFile);
+    }
+    return combinedResult;
+}
+
+std::unordered_map<uint32_t, int> Toolkit::getBagOfSymbols(const std::vector<uint32_t>& symbols, int numThreads, const std::string& logFile) {
+    /*
+    Input:
+        - symbols: Symbols of SymbolTable::global(), e.g. from tokenizeToSymbols or getSymbolNGrams.
+        - numThreads: The number of threads to use for processing (default is 2 and -1 is get all).
+        - logFile: A string specifying the name of the file to write the output to (default is "Outputs.txt", don't write if logFile = "").
+    Output:
+        - An unordered map where keys are symbols and values are their frequencies.
+    Functionality:
+        - Same counts as getBagOfWords, but keyed by integers: no string is hashed, compared or copied.
+    */
+
+    NLP_TRACE_SCOPE("Toolkit::getBagOfSymbols");
+    static const Metrics::Operation metrics("Toolkit::getBagOfSymbols");
+    Metrics::Timer timer(metrics);
+    metrics.add(Metrics::Items, symbols.size());
+    size_t maxThreads = std::thread::hardware_concurrency();
+    if (numThreads <= 0 || numThreads > static_cast<int>(maxThreads)) {
+        numThreads = maxThreads;
+    }
+
+    std::vector<std::unordered_map<uint32_t, int>> results(numThreads);
+    size_t blockSize = (symbols.size() + numThreads - 1) / numThreads;
+    runBlocks(symbols.size(), numThreads, [&](size_t start, size_t end) {
+        auto& result = results[blockSize ? start / blockSize : 0];
+        for (size_t i = start; i < end; ++i) {
+            result[symbols[i]]++;
+        }
+        });
+
+    NLP_TRACE_SCOPE("Toolkit::getBagOfSymbols/merge");
+    std::unordered_map<uint32_t, int> combinedResult = std::move(results[0]);
+    for (size_t t = 1; t < results.size(); ++t) {
+        for (const auto& [symbol, count] : results[t]) {
+            combinedResult[symbol] += count;
+        }
+    }
+
+    if (logFile.empty()) {
+        writeToFile("Bag Of Symbols", std::string(), logFile);
+    }
+    else {
+        const SymbolTable& table = SymbolTable::global();
+        std::unordered_map<std::string, int> counts;
+        for (const auto& [symbol, count] : combinedResult) counts.emplace(table.str(symbol), count);
+        writeToFile("Bag Of Symbols", counts, logFile);
+    }
+    return combinedResult;
+}
+
 std::vector<std::string> Toolkit::getNGrams(const std::vector<std::string>& tokens, int n, const std::string& logFile) {
     /*
     Input:
@@ -222,6 +702,10 @@ std::vector<std::string> Toolkit::getNGrams(const std::vector<std::string>& toke
         - Returns an empty vector if the input tokens are empty or if `n` is less than or equal to 0.
     */
 
+    NLP_TRACE_SCOPE("Toolkit::getNGrams");
+    static const Metrics::Operation metrics("Toolkit::getNGrams");
+    Metrics::Timer timer(metrics);
+    metrics.add(Metrics::Items, tokens.size());
     std::vector<std::string> ngrams;
 
     if (tokens.empty() || n <= 0) return ngrams;
@@ -240,6 +724,94 @@ std::vector<std::string> Toolkit::getNGrams(const std::vector<std::string>& toke
     return ngrams;
 }
 
+std::pmr::vector<std::pmr::string> Toolkit::getNGrams(const std::pmr::vector<std::pmr::string>& tokens, int n, std::pmr::memory_resource* resource, const std::string& logFile) {
+    /*
+    Input:
+        - tokens: A vector of strings (tokens), e.g. from the arena overload of tokenize.
+        - n: The desired n-gram size.
+        - resource: The memory resource that the vector and every n-gram are allocated from.
+        - logFile: A string specifying the name of the file to write the output to (default is "Outputs.txt", don't write if logFile = "").
+    Output:
+        - A vector of n-grams, allocated from `resource`.
+    Functionality:
+        - Same n-grams as getNGrams. Each one is sized up front and appended in place, so it takes a
+          single allocation from `resource`.
+    */
+
+    NLP_TRACE_SCOPE("Toolkit::getNGrams");
+    static const Metrics::Operation metrics("Toolkit::getNGrams");
+    Metrics::Timer timer(metrics);
+    metrics.add(Metrics::Items, tokens.size());
+    std::pmr::vector<std::pmr::string> ngrams(resource);
+
+    if (!tokens.empty() && n > 0 && static_cast<size_t>(n) <= tokens.size()) {
+        ngrams.reserve(tokens.size() - n + 1);
+        for (size_t i = 0; i + n <= tokens.size(); ++i) {
+            size_t length = n - 1;
+            for (size_t j = i; j < i + n; ++j) length += tokens[j].size();
+            std::pmr::string& ngram = ngrams.emplace_back();
+            ngram.reserve(length);
+            for (size_t j = i; j < i + n; ++j) {
+                ngram += tokens[j];
+                if (j < i + n - 1) ngram += ' ';
+            }
+        }
+    }
+
+    std::string task = std::to_string(n) + "-Grams";
+    if (logFile.empty()) {
+        writeToFile(task, std::string(), logFile);
+    }
+    else {
+        writeToFile(task, std::vector<std::string>(ngrams.begin(), ngrams.end()), logFile);
+    }
+    return ngrams;
+}
+
+std::vector<uint32_t> Toolkit::getSymbolNGrams(const std::vector<uint32_t>& symbols, int n, const std::string& logFile) {
+    /*
+    Input:
+        - symbols: Symbols of SymbolTable::global(), e.g. from tokenizeToSymbols.
+        - n: The desired n-gram size.
+        - logFile: A string specifying the name of the file to write the output to (default is "Outputs.txt", don't write if logFile = "").
+    Output:
+        - The symbol of each n-gram, i.e. of the text getNGrams would return for the same tokens.
+    Functionality:
+        - Each n-gram is joined in one reused buffer and interned, so repeated n-grams cost no
+          allocation and can be counted with getBagOfSymbols.
+        - Returns an empty vector if there are fewer than `n` symbols or if `n` is less than or equal to 0.
+    */
+
+    NLP_TRACE_SCOPE("Toolkit::getSymbolNGrams");
+    static const Metrics::Operation metrics("Toolkit::getSymbolNGrams");
+    Metrics::Timer timer(metrics);
+    metrics.add(Metrics::Items, symbols.size());
+    SymbolTable& table = SymbolTable::global();
+    std::vector<uint32_t> ngrams;
+
+    if (n > 0 && static_cast<size_t>(n) <= symbols.size()) {
+        ngrams.reserve(symbols.size() - n + 1);
+        std::string ngram;
+        for (size_t i = 0; i + n <= symbols.size(); ++i) {
+            ngram.clear();
+            for (size_t j = i; j < i + n; ++j) {
+                ngram += table.str(symbols[j]);
+                if (j < i + n - 1) ngram += ' ';
+            }
+            ngrams.push_back(table.intern(ngram));
+        }
+    }
+
+    std::string task = std::to_string(n) + "-Gram Symbols";
+    if (logFile.empty()) {
+        writeToFile(task, std::string(), logFile);
+    }
+    else {
+        writeToFile(task, symbolTexts(ngrams), logFile);
+    }
+    return ngrams;
+}
+
 std::string Toolkit::toLower(const std::string& text, const std::string& logFile) {
     /*
     Input:
@@ -251,8 +823,12 @@ std::string Toolkit::toLower(const std::string& text, const std::string& logFile
         - Uses `std::transform` to convert all characters in the input string to lowercase.
     */
 
+    NLP_TRACE_SCOPE("Toolkit::toLower");
+    static const Metrics::Operation metrics("Toolkit::toLower");
+    Metrics::Timer timer(metrics);
+    metrics.add(Metrics::Bytes, text.size());
     std::string result = text;
-    std::transform(result.begin(), result.end(), result.begin(), ::tolower);
+    std::transform(result.begin(), result.end(), result.begin(), [](char c) { return static_cast<char>(std::tolower(static_cast<unsigned char>(c))); });
 
     writeToFile("To Lower", result, logFile);
     return result;
@@ -270,9 +846,13 @@ std::string Toolkit::removePunctuation(const std::string& text, const std::strin
         - Uses `std::ispunct` to check for punctuation characters.
     */
 
+    NLP_TRACE_SCOPE("Toolkit::removePunctuation");
+    static const Metrics::Operation metrics("Toolkit::removePunctuation");
+    Metrics::Timer timer(metrics);
+    metrics.add(Metrics::Bytes, text.size());
     std::string result;
     for (char ch : text) {
-        if (!std::ispunct(ch)) {
+        if (!std::ispunct(static_cast<unsigned char>(ch))) {
             result += ch;
         }
     }
@@ -294,6 +874,10 @@ std::unordered_map<std::string, std::vector<float>> Toolkit::getEmbeddings(const
         - Splits the tokens into chunks and generates random embeddings for each token in parallel.
     */
 
+    NLP_TRACE_SCOPE("Toolkit::getEmbeddings");
+    static const Metrics::Operation metrics("Toolkit::getEmbeddings");
+    Metrics::Timer timer(metrics);
+    metrics.add(Metrics::Items, tokens.size());
     size_t maxThreads = std::thread::hardware_concurrency();
     if (numThreads <= 0 || numThreads > static_cast<int>(maxThreads)) {
         numThreads = maxThreads;
@@ -303,9 +887,10 @@ std::unordered_map<std::string, std::vector<float>> Toolkit::getEmbeddings(const
     auto splitBlocks = splitTokens(tokens, numThreads);
 
     ThreadPool pool(numThreads);
+    std::vector<std::future<void>> futures;
 
     for (int i = 0; i < numThreads; ++i) {
-        pool.enqueue([&results, &splitBlocks, i, embeddingSize] {
+        futures.push_back(pool.enqueue([&results, &splitBlocks, i, embeddingSize] {
             std::random_device rd;
             std::mt19937 gen(rd());
             std::uniform_real_distribution<> dis(-1.0, 1.0);
@@ -317,11 +902,14 @@ std::unordered_map<std::string, std::vector<float>> Toolkit::getEmbeddings(const
                 }
                 results[i][token] = embedding;
             }
-            });
+            }));
     }
 
-    pool.~ThreadPool();
+    for (auto& future : futures) {
+        future.get();
+    }
 
+    NLP_TRACE_SCOPE("Toolkit::getEmbeddings/merge");
     std::unordered_map<std::string, std::vector<float>> combinedEmbeddings;
     for (const auto& result : results) {
         for (const auto& [token, embedding] : result) {
@@ -333,6 +921,76 @@ std::unordered_map<std::string, std::vector<float>> Toolkit::getEmbeddings(const
     return combinedEmbeddings;
 }
 
+EmbeddingMatrix Toolkit::getEmbeddingMatrix(const std::vector<std::string>& tokens, size_t embeddingSize, int numThreads, const std::string& logFile) {
+    /*
+    Input:
+        - tokens: A vector of strings for which embeddings will be generated.
+        - embeddingSize: The size of the embedding vector for each token.
+        - numThreads: The number of threads to use for parallel processing (default is 2 and -1 is get all).
+        - logFile: A string specifying the name of the file to write the output to (default is "Outputs.txt", don't write if logFile = "").
+    Output:
+        - An EmbeddingMatrix with one randomly generated row per distinct token.
+    Functionality:
+        - Same embeddings as getEmbeddings, stored as one contiguous matrix instead of a vector per token,
+          so it can be handed to other runtimes (e.g. NumPy) without copying.
+        - Rows are split into blocks and filled in parallel.
+    */
+
+    NLP_TRACE_SCOPE("Toolkit::getEmbeddingMatrix");
+    static const Metrics::Operation metrics("Toolkit::getEmbeddingMatrix");
+    Metrics::Timer timer(metrics);
+    metrics.add(Metrics::Items, tokens.size());
+    size_t maxThreads = std::thread::hardware_concurrency();
+    if (numThreads <= 0 || numThreads > static_cast<int>(maxThreads)) {
+        numThreads = maxThreads;
+    }
+
+    EmbeddingMatrix matrix;
+    matrix.dimension = embeddingSize;
+    std::unordered_set<std::string> seen;
+    for (const auto& token : tokens) {
+        if (seen.insert(token).second) {
+            matrix.tokens.push_back(token);
+        }
+    }
+    matrix.values.resize(matrix.tokens.size() * embeddingSize);
+
+    size_t numRows = matrix.tokens.size();
+    size_t blockSize = (numRows + numThreads - 1) / numThreads;
+    {
+        ThreadPool pool(numThreads);
+        std::vector<std::future<void>> futures;
+        for (int t = 0; t < numThreads; ++t) {
+            size_t start = std::min(t * blockSize, numRows);
+            size_t end = std::min(start + blockSize, numRows);
+            futures.push_back(pool.enqueue([&matrix, start, end, embeddingSize] {
+                std::random_device rd;
+                std::mt19937 gen(rd());
+                std::uniform_real_distribution<> dis(-1.0, 1.0);
+
+                for (size_t i = start * embeddingSize; i < end * embeddingSize; ++i) {
+                    matrix.values[i] = static_cast<float>(dis(gen));
+                }
+                }));
+        }
+        for (auto& future : futures) {
+            future.get();
+        }
+    }
+
+    if (logFile.empty()) {
+        writeToFile("Embedding Matrix", std::string(), logFile);
+    }
+    else {
+        std::unordered_map<std::string, std::vector<float>> embeddings;
+        for (size_t i = 0; i < numRows; ++i) {
+            embeddings[matrix.tokens[i]].assign(matrix.row(i), matrix.row(i) + embeddingSize);
+        }
+        writeToFile("Embedding Matrix", embeddings, logFile);
+    }
+    return matrix;
+}
+
 std::string Toolkit::stem(const std::string& text, const std::string& logFile) {
     /*
     Input:
@@ -346,6 +1004,10 @@ std::string Toolkit::stem(const std::string& text, const std::string& logFile) {
         - Uses regex to identify and handle suffixes efficiently.
     */
 
+    NLP_TRACE_SCOPE("Toolkit::stem");
+    static const Metrics::Operation metrics("Toolkit::stem");
+    Metrics::Timer timer(metrics);
+    metrics.add(Metrics::Bytes, text.size());
     if (text.size() <= 3) {
         return text;
     }
@@ -392,6 +1054,10 @@ std::string Toolkit::removeSpecialCharacters(const std::string& text, const std:
         - A string with special characters removed.
     */
 
+    NLP_TRACE_SCOPE("Toolkit::removeSpecialCharacters");
+    static const Metrics::Operation metrics("Toolkit::removeSpecialCharacters");
+    Metrics::Timer timer(metrics);
+    metrics.add(Metrics::Bytes, text.size());
     auto specialChars = readFromFileTXT(specialCharFile);
 
     size_t maxThreads = std::thread::hardware_concurrency();
@@ -410,9 +1076,10 @@ std::string Toolkit::removeSpecialCharacters(const std::string& text, const std:
     }
 
     ThreadPool pool(numThreads);
+    std::vector<std::future<void>> futures;
 
     for (int i = 0; i < numThreads; ++i) {
-        pool.enqueue([&splitText, &specialChars, &results, i] {
+        futures.push_back(pool.enqueue([&splitText, &specialChars, &results, i] {
             std::string result;
             for (char ch : splitText[i]) {
                 if (specialChars.find(std::string(1, ch)) == specialChars.end()) {
@@ -420,11 +1087,14 @@ std::string Toolkit::removeSpecialCharacters(const std::string& text, const std:
                 }
             }
             results[i] = result;
-            });
+            }));
     }
 
-    pool.~ThreadPool(); 
+    for (auto& future : futures) {
+        future.get();
+    }
 
+    NLP_TRACE_SCOPE("Toolkit::removeSpecialCharacters/merge");
     std::string result;
     for (const auto& part : results) {
         result += part;
@@ -445,8 +1115,11 @@ std::string Toolkit::removeStopWords(const std::string& text, const std::string&
         - A string with stop words removed.
     */
 
+    NLP_TRACE_SCOPE("Toolkit::removeStopWords");
+    static const Metrics::Operation metrics("Toolkit::removeStopWords");
+    Metrics::Timer timer(metrics);
     auto stopWords = readFromFileTXT(stopWordsFile);
-    auto tokens = tokenize(text);
+    auto tokens = splitWords(text);
 
     size_t maxThreads = std::thread::hardware_concurrency();
     if (numThreads <= 0 || numThreads > static_cast<int>(maxThreads)) {
@@ -457,24 +1130,32 @@ std::string Toolkit::removeStopWords(const std::string& text, const std::string&
     auto splitBlocks = splitTokens(tokens, numThreads);
 
     ThreadPool pool(numThreads);
+    std::vector<std::future<void>> futures;
 
     for (int i = 0; i < numThreads; ++i) {
-        pool.enqueue([&results, &splitBlocks, &stopWords, i] {
+        futures.push_back(pool.enqueue([&results, &splitBlocks, &stopWords, i] {
             for (const auto& token : splitBlocks[i]) {
                 if (stopWords.find(token) == stopWords.end()) {
                     results[i].push_back(token);
                 }
             }
-            });
+            }));
     }
 
-    pool.~ThreadPool(); 
+    for (auto& future : futures) {
+        future.get();
+    }
 
+    NLP_TRACE_SCOPE("Toolkit::removeStopWords/merge");
     std::vector<std::string> filteredTokens;
     for (const auto& result : results) {
         filteredTokens.insert(filteredTokens.end(), result.begin(), result.end());
     }
 
+    metrics.add(Metrics::Items, tokens.size());
+    metrics.add(Metrics::Bytes, text.size());
+    metrics.add(Metrics::StopWordsRemoved, tokens.size() - filteredTokens.size());
+
     std::ostringstream result;
     for (size_t i = 0; i < filteredTokens.size(); ++i) {
         result << filteredTokens[i];
@@ -485,4 +1166,85 @@ std::string Toolkit::removeStopWords(const std::string& text, const std::string&
 
     writeToFile("Remove Stop Words", result.str(), logFile);
     return result.str();
+}
+
+StringBatch Toolkit::batchRemoveStopWords(const TokenizedBatch& batch, const std::string& stopWordsFile, int numThreads, const std::string& logFile) {
+    /*
+    Input:
+        - batch: Tokenized texts, e.g. from batchTokenize.
+        - stopWordsFile: Path to a file containing stop words (one per line).
+        - numThreads: The number of threads to use for processing (default is 2 and -1 is get all).
+        - logFile: A string specifying the name of the file to write the output to (default is "Outputs.txt", don't write if logFile = "").
+    Output:
+        - One string per text with its stop words removed and the remaining tokens joined by single spaces, like removeStopWords.
+    Functionality:
+        - A first parallel pass marks the tokens to keep and measures each output, a second writes every
+          output into one buffer, so the result is ready for batchEncodeTextToBuffer without copying.
+    */
+
+    NLP_TRACE_SCOPE("Toolkit::batchRemoveStopWords");
+    static const Metrics::Operation metrics("Toolkit::batchRemoveStopWords");
+    Metrics::Timer timer(metrics);
+    size_t maxThreads = std::thread::hardware_concurrency();
+    if (numThreads <= 0 || numThreads > static_cast<int>(maxThreads)) {
+        numThreads = maxThreads;
+    }
+
+    auto stopWords = readFromFileTXT(stopWordsFile);
+    std::unordered_set<std::string_view> stopViews(stopWords.begin(), stopWords.end());
+
+    size_t numTexts = batch.textOffsets.empty() ? 0 : batch.textOffsets.size() - 1;
+    std::vector<char> keep(batch.tokens.size(), 0);
+    StringBatch result;
+    result.offsets.assign(numTexts + 1, 0);
+    runBlocks(numTexts, numThreads, [&](size_t start, size_t end) {
+        for (size_t i = start; i < end; ++i) {
+            size_t kept = 0, bytes = 0;
+            for (size_t j = batch.textOffsets[i]; j < batch.textOffsets[i + 1]; ++j) {
+                std::string_view token = batch.tokens.at(j);
+                if (stopViews.find(token) == stopViews.end()) {
+                    keep[j] = 1;
+                    ++kept;
+                    bytes += token.size();
+                }
+            }
+            result.offsets[i + 1] = kept > 0 ? bytes + kept - 1 : 0;
+        }
+        });
+
+    for (size_t i = 0; i < numTexts; ++i) {
+        result.offsets[i + 1] += result.offsets[i];
+    }
+    result.data.resize(result.offsets[numTexts]);
+
+    runBlocks(numTexts, numThreads, [&](size_t start, size_t end) {
+        for (size_t i = start; i < end; ++i) {
+            char* out = &result.data[0] + result.offsets[i];
+            bool first = true;
+            for (size_t j = batch.textOffsets[i]; j < batch.textOffsets[i + 1]; ++j) {
+                if (!keep[j]) continue;
+                if (!first) *out++ = ' ';
+                std::string_view token = batch.tokens.at(j);
+                std::memcpy(out, token.data(), token.size());
+                out += token.size();
+                first = false;
+            }
+        }
+        });
+
+    metrics.add(Metrics::Items, batch.tokens.size());
+    metrics.add(Metrics::Bytes, batch.tokens.data.size());
+    metrics.add(Metrics::StopWordsRemoved, batch.tokens.size() - std::count(keep.begin(), keep.end(), 1));
+
+    if (logFile.empty()) {
+        writeToFile("Batch Remove Stop Words", std::string(), logFile);
+    }
+    else {
+        std::vector<std::string> filtered;
+        for (size_t i = 0; i < numTexts; ++i) {
+            filtered.emplace_back(result.at(i));
+        }
+        writeToFile("Batch Remove Stop Words", filtered, logFile);
+    }
+    return result;
 }
\ No newline at end of file
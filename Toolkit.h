@@ -1,15 +1,21 @@
 ﻿#pragma once
 #include <string>
+#include <string_view>
 #include <vector>
 #include <iostream>
 #include <unordered_map>
 #include <variant>
 #include <iomanip>
 #include <fstream>
+#include <memory_resource>
+#include <cstdint>
+#include <cctype>
+#include <type_traits>
 
 using OutputType = std::variant<
     std::string,
     std::vector<int>,
+    std::vector<size_t>,
     std::vector<std::string>,
     std::vector<std::vector<int>>,
     std::vector<std::vector<std::string>>,
@@ -19,22 +25,91 @@ using OutputType = std::variant<
 
 void writeToFile(const std::string& taskName, const OutputType& output, const std::string& fileName = "Outputs.txt");
 
+// The whitespace split shared by every tokenizing operation: calls word(w) for each maximal run of
+// non-space bytes of `text`, in order, with w viewing `text`. If word returns bool, false stops the walk.
+template <typename F>
+void forEachWord(std::string_view text, F&& word) {
+    size_t i = 0;
+    while (i < text.size()) {
+        while (i < text.size() && std::isspace(static_cast<unsigned char>(text[i]))) ++i;
+        size_t start = i;
+        while (i < text.size() && !std::isspace(static_cast<unsigned char>(text[i]))) ++i;
+        if (i > start) {
+            if constexpr (std::is_same_v<std::invoke_result_t<F&, std::string_view>, bool>) {
+                if (!word(text.substr(start, i - start))) return;
+            }
+            else {
+                word(text.substr(start, i - start));
+            }
+        }
+    }
+}
+
+struct StringBatch {
+    std::string data;                       // All strings back to back in one buffer.
+    std::vector<size_t> offsets;            // String i is data[offsets[i], offsets[i + 1]).
+
+    size_t size() const { return offsets.empty() ? 0 : offsets.size() - 1; }
+    std::string_view at(size_t i) const { return std::string_view(data).substr(offsets[i], offsets[i + 1] - offsets[i]); }
+};
+
+struct TokenizedBatch {
+    StringBatch tokens;                     // The tokens of every text, in order.
+    std::vector<size_t> textOffsets;        // Text i has tokens [textOffsets[i], textOffsets[i + 1]).
+};
+
+struct EmbeddingMatrix {
+    std::vector<std::string> tokens;        // Distinct tokens in order of first appearance.
+    std::vector<float> values;              // Row-major, one row of `dimension` values per token.
+    size_t dimension = 0;
+
+    const float* row(size_t i) const { return values.data() + i * dimension; }
+};
+
 class Toolkit {
 public:
     static std::vector<std::string> tokenize(const std::string& text, const std::string& logFile = "Outputs.txt");
 
+    static std::vector<std::string> tokenize(const std::string& text, size_t maxTokens, const std::string& logFile = "Outputs.txt");
+
+    static std::pmr::vector<std::pmr::string> tokenize(const std::string& text, std::pmr::memory_resource* resource, const std::string& logFile = "Outputs.txt");
+
+    static std::vector<uint32_t> tokenizeToSymbols(const std::string& text, const std::string& logFile = "Outputs.txt");
+
+    static TokenizedBatch batchTokenize(const std::vector<std::string_view>& texts, int numThreads = 2, const std::string& logFile = "Outputs.txt");
+
+    static void tokenizeInto(std::string_view text, TokenizedBatch& batch);
+
+    static StringBatch batchNormalize(const std::vector<std::string_view>& texts, bool lower = true, bool removePunctuation = true, int numThreads = 2, const std::string& logFile = "Outputs.txt");
+
+    static size_t countTokens(const std::string& text, const std::string& logFile = "Outputs.txt");
+
+    static std::vector<size_t> batchCountTokens(const std::vector<std::string>& texts, int numThreads = 2, const std::string& logFile = "Outputs.txt");
+
     static std::unordered_map<std::string, int> getBagOfWords(const std::vector<std::string>& tokens, int numThreads = 2, const std::string& logFile = "Outputs.txt");
 
+    static std::pmr::unordered_map<std::pmr::string, int> getBagOfWords(const std::pmr::vector<std::pmr::string>& tokens, int numThreads, std::pmr::memory_resource* resource, const std::string& logFile = "Outputs.txt");
+
+    static std::unordered_map<uint32_t, int> getBagOfSymbols(const std::vector<uint32_t>& symbols, int numThreads = 2, const std::string& logFile = "Outputs.txt");
+
     static std::vector<std::string> getNGrams(const std::vector<std::string>& tokens, int n, const std::string& logFile = "Outputs.txt");
 
+    static std::pmr::vector<std::pmr::string> getNGrams(const std::pmr::vector<std::pmr::string>& tokens, int n, std::pmr::memory_resource* resource, const std::string& logFile = "Outputs.txt");
+
+    static std::vector<uint32_t> getSymbolNGrams(const std::vector<uint32_t>& symbols, int n, const std::string& logFile = "Outputs.txt");
+
     static std::string toLower(const std::string& text, const std::string& logFile = "Outputs.txt");
     static std::string removePunctuation(const std::string& text, const std::string& logFile = "Outputs.txt");
 
     static std::unordered_map<std::string, std::vector<float>> getEmbeddings(const std::vector<std::string>& tokens, size_t vectorEmbeddingSize = 300, int numThreads = 2, const std::string& logFile = "Outputs.txt");
 
+    static EmbeddingMatrix getEmbeddingMatrix(const std::vector<std::string>& tokens, size_t vectorEmbeddingSize = 300, int numThreads = 2, const std::string& logFile = "Outputs.txt");
+
     static std::string stem(const std::string& text, const std::string& logFile = "Outputs.txt");
 
     static std::string removeSpecialCharacters(const std::string& text, const std::string& specialCharFile, int numThreads = 2, const std::string& logFile = "Outputs.txt");
 
     static std::string removeStopWords(const std::string& text, const std::string& stopWordsFile, int numThreads = 2, const std::string& logFile = "Outputs.txt");
+
+    static StringBatch batchRemoveStopWords(const TokenizedBatch& batch, const std::string& stopWordsFile, int numThreads = 2, const std::string& logFile = "Outputs.txt");
 };
@@ -0,0 +1,160 @@
+#include "Trace.h"
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+std::atomic<bool> Trace::recording{ false };
+
+namespace {
+
+struct Event {
+    const char* name;
+    uint64_t beginNs;
+    uint64_t endNs;
+};
+
+// One ring of events. A thread takes a free buffer on its first zone and hands it back when it
+// exits, so the short-lived ThreadPool workers share a few buffers instead of growing the
+// registry; each buffer is one row ("lane") of the trace.
+struct ThreadBuffer {
+    std::mutex mutex;               // Uncontended except while toJson() copies the buffer.
+    std::vector<Event> events;
+    size_t next = 0;                // Slot of the next event.
+    bool wrapped = false;           // The oldest events have been overwritten.
+    size_t lane = 0;
+};
+
+std::mutex registryMutex;
+std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+std::vector<ThreadBuffer*> freeBuffers;
+std::atomic<size_t> capacity{ 65536 };     // Events per buffer, applied on a buffer's next record.
+uint64_t originNs = Trace::now();
+
+struct LocalBuffer {
+    ThreadBuffer* buffer = nullptr;
+
+    ~LocalBuffer() {
+        if (!buffer) return;
+        std::lock_guard<std::mutex> lock(registryMutex);
+        freeBuffers.push_back(buffer);
+    }
+
+    ThreadBuffer& get() {
+        if (buffer) return *buffer;
+        std::lock_guard<std::mutex> lock(registryMutex);
+        if (!freeBuffers.empty()) {
+            buffer = freeBuffers.back();
+            freeBuffers.pop_back();
+        }
+        else {
+            buffers.emplace_back(new ThreadBuffer());
+            buffer = buffers.back().get();
+            buffer->lane = buffers.size();
+        }
+        return *buffer;
+    }
+};
+
+thread_local LocalBuffer localBuffer;
+
+void appendEscaped(std::ostringstream& out, const char* text) {
+    for (const char* c = text; *c; ++c) {
+        if (*c == '"' || *c == '\\') out << '\\';
+        out << *c;
+    }
+}
+
+}
+
+void Trace::record(const char* name, uint64_t beginNs, uint64_t endNs) {
+    ThreadBuffer& buffer = localBuffer.get();
+    size_t size = capacity.load(std::memory_order_relaxed);
+    std::lock_guard<std::mutex> lock(buffer.mutex);
+    if (buffer.events.size() != size) {
+        buffer.events.assign(size, Event{ nullptr, 0, 0 });
+        buffer.next = 0;
+        buffer.wrapped = false;
+    }
+    if (size == 0) return;
+
+    buffer.events[buffer.next] = Event{ name, beginNs, endNs };
+    if (++buffer.next == size) {
+        buffer.next = 0;
+        buffer.wrapped = true;
+    }
+}
+
+void Trace::start(size_t eventsPerThread) {
+    /*
+    Input:
+        - eventsPerThread: Ring size of each thread's buffer. When it fills up, the oldest events are
+          overwritten, so a trace holds the most recent activity.
+    Functionality:
+        - Zones opened from now on are recorded. Events recorded earlier are kept unless the ring size
+          changes; call clear() to start afresh.
+    */
+
+    capacity.store(eventsPerThread);
+    recording.store(true);
+}
+
+void Trace::stop() {
+    recording.store(false);
+}
+
+void Trace::clear() {
+    std::lock_guard<std::mutex> lock(registryMutex);
+    for (auto& buffer : buffers) {
+        std::lock_guard<std::mutex> bufferLock(buffer->mutex);
+        buffer->next = 0;
+        buffer->wrapped = false;
+    }
+}
+
+std::string Trace::toJson() {
+    /*
+    Output:
+        - The recorded events in the Chrome trace event format: one complete ("X") event per zone, with
+          microsecond timestamps since start-up, and one row per buffer.
+    Functionality:
+        - Safe to call while zones are being recorded; each buffer is locked only while it is copied.
+    */
+
+    std::ostringstream out;
+    out << std::fixed;
+    out.precision(3);
+    out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+    bool first = true;
+
+    std::lock_guard<std::mutex> lock(registryMutex);
+    for (auto& buffer : buffers) {
+        std::vector<Event> events;
+        {
+            std::lock_guard<std::mutex> bufferLock(buffer->mutex);
+            if (buffer->wrapped) events.assign(buffer->events.begin() + buffer->next, buffer->events.end());
+            events.insert(events.end(), buffer->events.begin(), buffer->events.begin() + buffer->next);
+        }
+        if (events.empty()) continue;
+
+        out << (first ? "" : ",") << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->lane
+            << ",\"args\":{\"name\":\"lane " << buffer->lane << "\"}}";
+        first = false;
+        for (const Event& event : events) {
+            out << ",\n{\"name\":\"";
+            appendEscaped(out, event.name);
+            out << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->lane
+                << ",\"ts\":" << (event.beginNs - originNs) / 1000.0 << ",\"dur\":" << (event.endNs - event.beginNs) / 1000.0 << "}";
+        }
+    }
+    out << "\n]}\n";
+    return out.str();
+}
+
+void Trace::dump(const std::string& path) {
+    std::ofstream file(path);
+    if (!file) throw std::runtime_error("Failed to open trace file: " + path);
+    file << toJson();
+}
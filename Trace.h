@@ -0,0 +1,59 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+// Scoped timing zones recorded into per-thread ring buffers and exported as Chrome trace JSON
+// (chrome://tracing, ui.perfetto.dev). Zones are only compiled in with NLP_ENABLE_TRACING; then
+// each one costs a relaxed load and a branch until start() turns recording on.
+//
+//     NLP_TRACE_SCOPE("Tokenizer::batchEncode");     // Name must be a string literal.
+class Trace {
+private:
+    static std::atomic<bool> recording;
+
+    static void record(const char* name, uint64_t beginNs, uint64_t endNs);
+
+public:
+    static uint64_t now() {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+
+    class Zone {
+    private:
+        const char* name;
+        uint64_t beginNs = 0;
+
+    public:
+        explicit Zone(const char* name) : name(name) {
+            if (recording.load(std::memory_order_relaxed)) beginNs = now();
+        }
+        ~Zone() {
+            if (beginNs != 0) record(name, beginNs, now());
+        }
+        Zone(const Zone&) = delete;
+        Zone& operator=(const Zone&) = delete;
+    };
+
+    static void start(size_t eventsPerThread = 65536);
+
+    static void stop();
+
+    static bool isRecording() { return recording.load(std::memory_order_relaxed); }
+
+    static void clear();
+
+    static std::string toJson();
+
+    static void dump(const std::string& path);
+};
+
+#ifdef NLP_ENABLE_TRACING
+#define NLP_TRACE_CONCAT_(a, b) a##b
+#define NLP_TRACE_CONCAT(a, b) NLP_TRACE_CONCAT_(a, b)
+#define NLP_TRACE_SCOPE(name) Trace::Zone NLP_TRACE_CONCAT(traceZone, __LINE__)(name)
+#else
+#define NLP_TRACE_SCOPE(name) ((void)0)
+#endif
@@ -0,0 +1,382 @@
+#include "Vocabulary.h"
+#include "ByteIO.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#if defined(_MSC_VER)
+#include <xmmintrin.h>
+#define PREFETCH(address) _mm_prefetch(reinterpret_cast<const char*>(address), _MM_HINT_T0)
+#else
+#define PREFETCH(address) __builtin_prefetch(address)
+#endif
+
+Vocabulary::Vocabulary(const std::vector<std::string>& tokens) {
+    /*
+    Input:
+        - tokens: The vocabulary in ID order.
+    Output:
+        - Constructs the table. A token listed more than once keeps every ID for decoding, and
+          lookups return its last ID (the same rule `tokenToId[vocab[i]] = i` always had).
+    */
+
+    size_t totalChars = 0;
+    for (const auto& token : tokens) totalChars += token.size();
+    if (tokens.size() >= UINT32_MAX || totalChars >= UINT32_MAX) {
+        throw std::length_error("Vocabulary exceeds 2^32 tokens or characters.");
+    }
+
+    ownedChars.reserve(totalChars);
+    ownedOffsets.reserve(tokens.size() + 1);
+    ownedOffsets.push_back(0);
+    for (const auto& token : tokens) {
+        ownedChars += token;
+        ownedOffsets.push_back(static_cast<uint32_t>(ownedChars.size()));
+    }
+    numTokens = tokens.size();
+
+    rehash(numTokens);
+}
+
+Vocabulary::Vocabulary(const Vocabulary& other)
+    : ownedChars(other.ownedChars), ownedOffsets(other.ownedOffsets), ownedSlots(other.ownedSlots), region(other.region),
+      chars(other.chars), offsets(other.offsets), slots(other.slots), numTokens(other.numTokens), mask(other.mask) {
+    if (!region) bind();
+}
+
+Vocabulary::Vocabulary(Vocabulary&& other) noexcept
+    : ownedChars(std::move(other.ownedChars)), ownedOffsets(std::move(other.ownedOffsets)), ownedSlots(std::move(other.ownedSlots)),
+      region(std::move(other.region)), chars(other.chars), offsets(other.offsets), slots(other.slots), numTokens(other.numTokens), mask(other.mask) {
+    // A moved std::string may have kept its characters inline, so the pointers are taken again.
+    if (!region) bind();
+}
+
+Vocabulary& Vocabulary::operator=(const Vocabulary& other) {
+    if (this != &other) *this = Vocabulary(other);
+    return *this;
+}
+
+Vocabulary& Vocabulary::operator=(Vocabulary&& other) noexcept {
+    ownedChars = std::move(other.ownedChars);
+    ownedOffsets = std::move(other.ownedOffsets);
+    ownedSlots = std::move(other.ownedSlots);
+    region = std::move(other.region);
+    chars = other.chars;
+    offsets = other.offsets;
+    slots = other.slots;
+    numTokens = other.numTokens;
+    mask = other.mask;
+    if (!region) bind();
+    return *this;
+}
+
+void Vocabulary::bind() {
+    // Points the lookups at the owned arrays; called after every change to them.
+    chars = ownedChars.data();
+    offsets = ownedOffsets.data();
+    slots = ownedSlots.data();
+}
+
+void Vocabulary::own() {
+    // Copies a view into owned arrays, so it can be modified.
+    if (!region) return;
+    ownedChars.assign(chars, offsets[numTokens]);
+    ownedOffsets.assign(offsets, offsets + numTokens + 1);
+    ownedSlots.assign(slots, slots + mask + 1);
+    region.reset();
+    bind();
+}
+
+Vocabulary Vocabulary::withTokens(const std::vector<std::string>& tokens) const {
+    /*
+    Input:
+        - tokens: Tokens to append. Tokens already in the vocabulary (or repeated in the list) are skipped.
+    Output:
+        - A new Vocabulary with the same IDs as this one plus new IDs for the appended tokens.
+    Functionality:
+        - Copies the flat arrays and inserts into the copy, so the cost is a memcpy of the table plus the new tokens.
+        - The copy always owns its arrays, so a view (e.g. over shared memory) is never written to.
+    */
+
+    Vocabulary next(*this);
+    next.own();
+    for (const auto& token : tokens) {
+        if (next.find(token) >= 0) continue;
+        if (next.size() + 1 >= UINT32_MAX || next.ownedChars.size() + token.size() >= UINT32_MAX) {
+            throw std::length_error("Vocabulary exceeds 2^32 tokens or characters.");
+        }
+
+        uint32_t id = static_cast<uint32_t>(next.size());
+        next.ownedChars += token;
+        next.ownedOffsets.push_back(static_cast<uint32_t>(next.ownedChars.size()));
+        ++next.numTokens;
+        next.bind();
+        if ((next.size() * 2) > next.ownedSlots.size()) {
+            next.rehash(next.size());
+        }
+        else {
+            next.insert(next.token(id), id);
+        }
+    }
+    return next;
+}
+
+void Vocabulary::serialize(std::string& out, bool withTable) const {
+    /*
+    Input:
+        - out: Receives the table, appended at an 8-byte aligned size.
+        - withTable: Also write the hash slots. Needed for view(); without them the image is about
+          half the size and deserialize() rebuilds the slots.
+    Output:
+        - None (void). The layout is: token count, character count, slot count (0 when left out),
+          then the slots, the offsets and the characters, each padded to 8 bytes.
+    */
+
+    size_t numSlots = withTable ? mask + 1 : 0;
+    ByteIO::append<uint64_t>(out, numTokens);
+    ByteIO::append<uint64_t>(out, offsets[numTokens]);
+    ByteIO::append<uint64_t>(out, numSlots);
+    ByteIO::append(out, slots, numSlots);
+    ByteIO::append(out, offsets, numTokens + 1);
+    ByteIO::append(out, chars, offsets[numTokens]);
+}
+
+namespace {
+
+struct Layout {
+    const uint64_t* slots;
+    const uint32_t* offsets;
+    const char* chars;
+    size_t numTokens;
+    size_t numChars;
+    size_t numSlots;
+};
+
+Layout readLayout(std::string_view data, size_t& pos) {
+    // Validates everything a lookup relies on, so corrupt input throws instead of reading out of
+    // bounds or probing a full table forever.
+    ByteIO::Reader reader(data, pos);
+    Layout layout;
+    layout.numTokens = reader.read<uint64_t>();
+    layout.numChars = reader.read<uint64_t>();
+    layout.numSlots = reader.read<uint64_t>();
+    if (layout.numTokens >= UINT32_MAX || layout.numChars >= UINT32_MAX) {
+        throw std::runtime_error("Vocabulary data is corrupt.");
+    }
+    if (layout.numSlots != 0 && ((layout.numSlots & (layout.numSlots - 1)) != 0 || layout.numSlots < layout.numTokens * 2)) {
+        throw std::runtime_error("Vocabulary data is corrupt.");
+    }
+
+    layout.slots = reader.take<uint64_t>(layout.numSlots);
+    layout.offsets = reader.take<uint32_t>(layout.numTokens + 1);
+    layout.chars = reader.take<char>(layout.numChars);
+
+    uint32_t previous = 0;
+    for (size_t i = 0; i <= layout.numTokens; ++i) {
+        uint32_t offset;
+        std::memcpy(&offset, layout.offsets + i, sizeof(offset));
+        if (offset < previous || (i == 0 && offset != 0)) throw std::runtime_error("Vocabulary data is corrupt.");
+        previous = offset;
+    }
+    if (previous != layout.numChars) throw std::runtime_error("Vocabulary data is corrupt.");
+
+    size_t used = 0;
+    for (size_t i = 0; i < layout.numSlots; ++i) {
+        uint64_t slot;
+        std::memcpy(&slot, layout.slots + i, sizeof(slot));
+        if (slot == 0) continue;
+        // The low word is id + 1: 0 under a nonzero tag would make a lookup read token 0xFFFFFFFF.
+        uint32_t idPlusOne = static_cast<uint32_t>(slot);
+        if (idPlusOne == 0 || idPlusOne > layout.numTokens) throw std::runtime_error("Vocabulary data is corrupt.");
+        ++used;
+    }
+    if (layout.numSlots != 0 && used >= layout.numSlots) throw std::runtime_error("Vocabulary data is corrupt.");
+    return layout;
+}
+
+}
+
+Vocabulary Vocabulary::deserialize(std::string_view data, size_t& pos) {
+    /*
+    Input:
+        - data: An image written by serialize(), at any alignment.
+        - pos: Offset of the table in `data`, advanced past it.
+    Output:
+        - A Vocabulary owning a copy of the table. Throws `std::runtime_error` if the data is truncated or corrupt.
+    */
+
+    Layout layout = readLayout(data, pos);
+    Vocabulary vocab;
+    vocab.ownedChars.assign(layout.chars, layout.numChars);
+    vocab.ownedOffsets.resize(layout.numTokens + 1);
+    std::memcpy(vocab.ownedOffsets.data(), layout.offsets, vocab.ownedOffsets.size() * sizeof(uint32_t));
+    vocab.numTokens = layout.numTokens;
+    vocab.bind();
+
+    if (layout.numSlots == 0) {
+        vocab.rehash(vocab.numTokens);
+    }
+    else {
+        vocab.ownedSlots.resize(layout.numSlots);
+        std::memcpy(vocab.ownedSlots.data(), layout.slots, layout.numSlots * sizeof(uint64_t));
+        vocab.mask = layout.numSlots - 1;
+        vocab.bind();
+    }
+    return vocab;
+}
+
+Vocabulary Vocabulary::view(std::string_view data, size_t& pos, std::shared_ptr<const void> region) {
+    /*
+    Input:
+        - data: An image written by serialize(out, true), starting 8-byte aligned.
+        - pos: Offset of the table in `data`, advanced past it.
+        - region: Owner of `data`; the Vocabulary and its copies keep it alive.
+    Output:
+        - A Vocabulary that looks tokens up in `data` directly, without copying it.
+          An image without slots has nothing to look up in, so it is copied like deserialize().
+    */
+
+    if (reinterpret_cast<uintptr_t>(data.data()) % alignof(uint64_t) != 0) {
+        throw std::invalid_argument("Vocabulary::view needs 8-byte aligned data.");
+    }
+
+    size_t start = pos;
+    Layout layout = readLayout(data, pos);
+    if (layout.numSlots == 0) {
+        pos = start;
+        return deserialize(data, pos);
+    }
+
+    Vocabulary vocab;
+    vocab.region = std::move(region);
+    vocab.chars = layout.chars;
+    vocab.offsets = layout.offsets;
+    vocab.slots = layout.slots;
+    vocab.numTokens = layout.numTokens;
+    vocab.mask = layout.numSlots - 1;
+    return vocab;
+}
+
+uint64_t Vocabulary::hash(std::string_view token) {
+    /*
+    Functionality:
+        - 64-bit FNV-1a. The result does not depend on the platform or standard library, so the
+          slot layout stays valid for a table written by one build and read by another.
+    */
+
+    uint64_t h = 14695981039346656037ull;
+    for (unsigned char c : token) {
+        h ^= c;
+        h *= 1099511628211ull;
+    }
+    return h;
+}
+
+void Vocabulary::rehash(size_t capacity) {
+    size_t numSlots = 16;
+    while (numSlots < capacity * 2) numSlots <<= 1;
+
+    ownedSlots.assign(numSlots, 0);
+    mask = numSlots - 1;
+    bind();
+    for (size_t id = 0; id < size(); ++id) {
+        insert(token(id), static_cast<uint32_t>(id));
+    }
+}
+
+void Vocabulary::insert(std::string_view token, uint32_t id) {
+    uint64_t h = hash(token);
+    uint64_t tag = h >> 32;
+    for (uint64_t i = h & mask;; i = (i + 1) & mask) {
+        uint64_t slot = slots[i];
+        if (slot == 0) {
+            ownedSlots[i] = (tag << 32) | (uint64_t(id) + 1);
+            return;
+        }
+        if ((slot >> 32) == tag && this->token(static_cast<uint32_t>(slot) - 1) == token) {
+            ownedSlots[i] = (tag << 32) | (uint64_t(id) + 1);
+            return;
+        }
+    }
+}
+
+int Vocabulary::find(std::string_view token, uint64_t tokenHash) const {
+    /*
+    Input:
+        - token: The token to look up.
+        - tokenHash: hash(token), for callers that already computed it.
+    Output:
+        - The token ID, or -1 if the token is not in the vocabulary.
+    */
+
+    uint64_t tag = tokenHash >> 32;
+    for (uint64_t i = tokenHash & mask;; i = (i + 1) & mask) {
+        uint64_t slot = slots[i];
+        if (slot == 0) return -1;
+        if ((slot >> 32) == tag) {
+            uint32_t id = static_cast<uint32_t>(slot) - 1;
+            if (this->token(id) == token) return static_cast<int>(id);
+        }
+    }
+}
+
+void Vocabulary::findBatch(const std::string_view* tokens, size_t count, int* ids) const {
+    /*
+    Input:
+        - tokens: Tokens to look up.
+        - count: Number of tokens.
+        - ids: Receives `count` IDs, -1 for tokens not in the vocabulary.
+    Output:
+        - None (void). Same results as calling find() on each token.
+    Functionality:
+        - When the table is larger than the caches every lookup takes up to three dependent misses:
+          the slot, the token's offsets and its text. find() takes them one after another.
+        - Here tokens go through in groups of `lookupGroup`. Each stage issues the prefetches of the
+          next stage for the whole group before any of them is used, so the misses of a group overlap
+          instead of adding up.
+        - Tokens whose first slot holds a different token (a collision) finish with a plain find().
+        - Tables that fit in L2 take the plain loop: without misses to hide, the extra passes only cost.
+    */
+
+    if ((mask + 1) * sizeof(uint64_t) <= 512 * 1024) {
+        for (size_t i = 0; i < count; ++i) ids[i] = find(tokens[i]);
+        return;
+    }
+
+    uint64_t hashes[lookupGroup];
+    uint64_t candidate[lookupGroup];    // Slot of the first probe, 0 if empty.
+
+    for (size_t base = 0; base < count; base += lookupGroup) {
+        size_t n = std::min(lookupGroup, count - base);
+        const std::string_view* group = tokens + base;
+        int* out = ids + base;
+
+        for (size_t i = 0; i < n; ++i) {
+            hashes[i] = hash(group[i]);
+            PREFETCH(&slots[hashes[i] & mask]);
+        }
+
+        for (size_t i = 0; i < n; ++i) {
+            candidate[i] = slots[hashes[i] & mask];
+            if (candidate[i] != 0) PREFETCH(&offsets[static_cast<uint32_t>(candidate[i]) - 1]);
+        }
+
+        for (size_t i = 0; i < n; ++i) {
+            if (candidate[i] != 0) PREFETCH(chars + offsets[static_cast<uint32_t>(candidate[i]) - 1]);
+        }
+
+        for (size_t i = 0; i < n; ++i) {
+            if (candidate[i] == 0) {
+                out[i] = -1;
+                continue;
+            }
+            uint32_t id = static_cast<uint32_t>(candidate[i]) - 1;
+            if ((candidate[i] >> 32) == (hashes[i] >> 32) && token(id) == group[i]) {
+                out[i] = static_cast<int>(id);
+            }
+            else {
+                out[i] = find(group[i], hashes[i]);
+            }
+        }
+    }
+}
@@ -0,0 +1,64 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <cstdint>
+
+// Immutable token <-> ID table. Token text is stored back to back in one buffer and looked up
+// through an open-addressing table, so a snapshot can be shared by any number of readers.
+// The arrays are either owned or a view over serialized data kept alive by `region`
+// (e.g. a shared-memory mapping), see view().
+class Vocabulary {
+private:
+    std::string ownedChars;
+    std::vector<uint32_t> ownedOffsets;
+    std::vector<uint64_t> ownedSlots;
+    std::shared_ptr<const void> region;     // Memory a view points into, null when the arrays are owned.
+
+    const char* chars = nullptr;            // All tokens, concatenated in ID order.
+    const uint32_t* offsets = nullptr;      // Token i is chars[offsets[i], offsets[i + 1]).
+    const uint64_t* slots = nullptr;        // (hash tag << 32) | (id + 1); 0 marks an empty slot.
+    size_t numTokens = 0;
+    uint64_t mask = 0;
+
+    Vocabulary() = default;
+
+    void bind();
+    void own();
+    void rehash(size_t capacity);
+    void insert(std::string_view token, uint32_t id);
+
+public:
+    explicit Vocabulary(const std::vector<std::string>& tokens);
+    Vocabulary(const Vocabulary& other);
+    Vocabulary(Vocabulary&& other) noexcept;
+    Vocabulary& operator=(const Vocabulary& other);
+    Vocabulary& operator=(Vocabulary&& other) noexcept;
+
+    Vocabulary withTokens(const std::vector<std::string>& tokens) const;
+
+    void serialize(std::string& out, bool withTable) const;
+
+    static Vocabulary deserialize(std::string_view data, size_t& pos);
+
+    static Vocabulary view(std::string_view data, size_t& pos, std::shared_ptr<const void> region);
+
+    bool isView() const { return region != nullptr; }
+
+    static uint64_t hash(std::string_view token);
+
+    int find(std::string_view token) const { return find(token, hash(token)); }
+
+    int find(std::string_view token, uint64_t tokenHash) const;
+
+    static constexpr size_t lookupGroup = 16;
+
+    void findBatch(const std::string_view* tokens, size_t count, int* ids) const;
+
+    std::string_view token(size_t id) const {
+        return std::string_view(chars + offsets[id], offsets[id + 1] - offsets[id]);
+    }
+
+    size_t size() const { return numTokens; }
+};
@@ -0,0 +1,207 @@
+#pragma once
+// Minimal in-tree benchmark harness: times a callable until a minimum duration has passed and
+// reports the median iteration as items/s and MB/s, plus IPC and misses per item when hardware
+// counters are enabled and allocations per item in NLP_COUNT_ALLOCATIONS builds. Toolkit calls
+// print "Skip write task" when they are not logging, so std::cout is silenced while a case runs.
+#include "PerfCounters.h"
+#include "../Allocations.h"
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <streambuf>
+#include <string>
+#include <vector>
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+struct BenchResult {
+    std::string name;
+    size_t iterations = 0;
+    double seconds = 0.0;           // Median time of one iteration.
+    size_t items = 0;               // Items (words, tokens, sentences) processed per iteration.
+    size_t bytes = 0;               // Input bytes processed per iteration.
+    PerfSample counters;            // Mean hardware counts of one iteration, all invalid when not counting.
+    double allocations = 0.0;       // Mean heap allocations of one iteration, 0 unless Allocations::enabled.
+    double allocatedBytes = 0.0;
+
+    double itemsPerSecond() const { return seconds > 0 ? items / seconds : 0.0; }
+    double bytesPerSecond() const { return seconds > 0 ? bytes / seconds : 0.0; }
+};
+
+// Swallows everything written to std::cout while in scope.
+class QuietCout {
+private:
+    class NullBuffer : public std::streambuf {
+    protected:
+        int overflow(int c) override { return c; }
+        std::streamsize xsputn(const char*, std::streamsize n) override { return n; }
+    };
+
+    NullBuffer sink;
+    std::streambuf* saved;
+
+public:
+    QuietCout() : saved(std::cout.rdbuf(&sink)) {}
+    ~QuietCout() { std::cout.rdbuf(saved); }
+    QuietCout(const QuietCout&) = delete;
+    QuietCout& operator=(const QuietCout&) = delete;
+};
+
+inline std::string perItemColumn(const PerfSample& sample, PerfEvent event, size_t items) {
+    // One counter per item for a results table, "-" when the counter is not available.
+    if (!sample.has(event)) return "-";
+    std::ostringstream text;
+    text << std::fixed << std::setprecision(3) << sample.perItem(event, items);
+    return text.str();
+}
+
+class BenchHarness {
+private:
+    double minSeconds;
+    std::string filter;
+    std::vector<BenchResult> results;
+    std::unique_ptr<PerfCounters> counters;
+    bool printedHeader = false;
+
+public:
+    BenchHarness(double minSeconds = 0.2, const std::string& filter = "") : minSeconds(minSeconds), filter(filter) {}
+
+    bool enableCounters() {
+        /*
+        Output:
+            - true when at least one hardware counter could be opened. Otherwise the reason is printed
+              to std::cerr and the cases run with timing only.
+        */
+
+        counters.reset(new PerfCounters());
+        if (counters->available()) return true;
+        std::cerr << "Hardware counters unavailable (" << counters->error() << "), reporting time only.\n";
+        counters.reset();
+        return false;
+    }
+
+    bool selected(const std::string& name) const { return filter.empty() || name.find(filter) != std::string::npos; }
+
+    void run(const std::string& name, size_t items, size_t bytes, const std::function<void()>& body) {
+        /*
+        Input:
+            - name: Case name, e.g. "batchEncode/words:65536/threads:4". Skipped unless it contains the filter.
+            - items, bytes: Work done by one call of `body`.
+            - body: The code to time.
+        Functionality:
+            - Measures the case like measure() and prints its row.
+        */
+
+        if (!selected(name)) return;
+        BenchResult result = measure(name, items, bytes, body);
+        results.push_back(result);
+        print(result);
+    }
+
+    BenchResult measure(const std::string& name, size_t items, size_t bytes, const std::function<void()>& body) {
+        /*
+        Output:
+            - The timing of `body`, neither filtered, printed nor kept in getResults().
+        Functionality:
+            - One untimed warm-up call, then timed calls until `minSeconds` have passed (at least 3).
+        */
+
+        std::vector<double> times;
+        PerfSample sample;
+        AllocationStats allocated;
+        {
+            QuietCout quiet;
+            body();
+            double total = 0.0;
+            Allocations::Scope allocationScope;
+            if (counters) counters->start();
+            while (total < minSeconds || times.size() < 3) {
+                auto begin = std::chrono::steady_clock::now();
+                body();
+                times.push_back(std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count());
+                total += times.back();
+            }
+            if (counters) sample = counters->stop();
+            allocated = allocationScope.stats();
+        }
+        std::sort(times.begin(), times.end());
+
+        BenchResult result;
+        result.name = name;
+        result.iterations = times.size();
+        result.seconds = times[times.size() / 2];
+        result.items = items;
+        result.bytes = bytes;
+        result.counters = sample.scaled(1.0 / times.size());
+        result.allocations = static_cast<double>(allocated.allocations) / times.size();
+        result.allocatedBytes = static_cast<double>(allocated.bytes) / times.size();
+        return result;
+    }
+
+    void print(const BenchResult& result) {
+        if (!printedHeader) {
+            std::cout << std::left << std::setw(56) << "case" << std::right << std::setw(8) << "iters" << std::setw(14) << "ms/iter"
+                << std::setw(16) << "items/s" << std::setw(12) << "MB/s";
+            if (counters) {
+                std::cout << std::setw(8) << "IPC" << std::setw(14) << "L1 miss/item" << std::setw(15) << "LLC miss/item"
+                    << std::setw(15) << "br miss/item";
+            }
+            if (Allocations::enabled) std::cout << std::setw(13) << "allocs/item" << std::setw(13) << "bytes/item";
+            std::cout << "\n";
+            printedHeader = true;
+        }
+        std::cout << std::left << std::setw(56) << result.name << std::right << std::setw(8) << result.iterations
+            << std::setw(14) << std::fixed << std::setprecision(3) << result.seconds * 1e3
+            << std::setw(16) << std::setprecision(0) << result.itemsPerSecond()
+            << std::setw(12) << std::setprecision(1) << result.bytesPerSecond() / (1024.0 * 1024.0);
+        if (counters) {
+            const PerfSample& sample = result.counters;
+            std::cout << std::setw(8) << std::setprecision(2);
+            if (sample.has(Cycles) && sample.has(Instructions)) std::cout << sample.ipc();
+            else std::cout << "-";
+            std::cout << std::setw(14) << perItemColumn(sample, L1Misses, result.items) << std::setw(15) << perItemColumn(sample, LlcMisses, result.items)
+                << std::setw(15) << perItemColumn(sample, BranchMisses, result.items);
+        }
+        if (Allocations::enabled) {
+            double items = result.items > 0 ? static_cast<double>(result.items) : 1.0;
+            std::cout << std::setw(13) << std::setprecision(3) << result.allocations / items
+                << std::setw(13) << std::setprecision(1) << result.allocatedBytes / items;
+        }
+        std::cout << "\n";
+    }
+
+    const std::vector<BenchResult>& getResults() const { return results; }
+};
+
+inline std::string caseName(const std::string& op, size_t size, const char* unit, int threads = 0) {
+    std::ostringstream name;
+    name << op << "/" << unit << ":" << size;
+    if (threads > 0) name << "/threads:" << threads;
+    return name.str();
+}
+
+inline size_t peakRssBytes() {
+    // High-water mark of the process's resident memory, 0 where the platform does not report it.
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) return 0;
+    return counters.PeakWorkingSetSize;
+#else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+#ifdef __APPLE__
+    return static_cast<size_t>(usage.ru_maxrss);            // Bytes on macOS.
+#else
+    return static_cast<size_t>(usage.ru_maxrss) * 1024;     // Kilobytes on Linux and the BSDs.
+#endif
+#endif
+}
@@ -0,0 +1,363 @@
+// End-to-end throughput of the preprocessing chain normalize -> tokenize -> stop-word removal ->
+// encode -> count over a generated Zipfian corpus. The corpus is generated and processed one chunk
+// at a time, so multi-GB runs need only a few chunks of memory. Reports GB/s of corpus text, peak
+// RSS and the time of each stage (with IPC and misses per token under --counters), can write the
+// results as JSON, and exits with status 2 when they regress against a baseline written by an
+// earlier run. Builds with NLP_COUNT_ALLOCATIONS also report and check the heap allocations of each
+// stage per 1000 tokens. --trace records the library's trace zones (NLP_ENABLE_TRACING builds) and writes
+// them as Chrome trace JSON.
+//
+// Usage: bench_corpus [--size-gb=2] [--chunk-mb=64] [--threads=N] [--seed=42] [--json=path]
+//                     [--baseline=path] [--max-slowdown=0.10] [--max-rss-growth=0.25] [--counters]
+//                     [--max-alloc-growth=0.10] [--trace=path]
+#include "BenchHarness.h"
+#include "ZipfCorpus.h"
+#include "../Toolkit.h"
+#include "../Tokenizer.h"
+#include "../ThreadPool.h"
+#include "../Trace.h"
+#include <cmath>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <string_view>
+#include <thread>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+const char* stageNames[] = { "normalize", "tokenize", "removeStopWords", "encode", "count" };
+constexpr size_t numStages = sizeof(stageNames) / sizeof(stageNames[0]);
+
+struct CorpusReport {
+    size_t bytes = 0;
+    size_t documents = 0;
+    size_t tokens = 0;              // Tokens after normalization.
+    size_t keptTokens = 0;          // Tokens left after stop-word removal, i.e. IDs encoded.
+    size_t distinctIds = 0;
+    int threads = 0;
+    double generateSeconds = 0.0;   // Not part of the pipeline time.
+    double stageSeconds[numStages] = {};
+    PerfSample stageCounters[numStages];    // All invalid unless --counters found hardware counters.
+    AllocationStats stageAllocations[numStages];    // All 0 unless Allocations::enabled.
+    size_t peakRss = 0;
+
+    double seconds() const {
+        double total = 0.0;
+        for (double s : stageSeconds) total += s;
+        return total;
+    }
+    double gbPerSecond(double s) const { return s > 0 ? bytes / s / 1e9 : 0.0; }
+    double perToken(uint64_t count) const { return tokens > 0 ? static_cast<double>(count) / tokens : 0.0; }
+    double perKToken(uint64_t count) const { return perToken(count) * 1000; }
+    uint64_t allocations() const {
+        uint64_t total = 0;
+        for (const auto& stage : stageAllocations) total += stage.allocations;
+        return total;
+    }
+};
+
+template <class F>
+double secondsOf(F&& f) {
+    auto begin = std::chrono::steady_clock::now();
+    f();
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+}
+
+void countIds(const EncodedBuffer& encoded, int numThreads, std::vector<uint64_t>& counts) {
+    // Term frequencies of the encoded IDs: one histogram per thread, summed into `counts`.
+    // IDs outside the table (the unknown ID when there is none) land in the last bucket.
+    size_t numIds = encoded.ids.size();
+    size_t blockSize = (numIds + numThreads - 1) / numThreads;
+    std::vector<std::vector<uint64_t>> partial(numThreads, std::vector<uint64_t>(counts.size(), 0));
+    ThreadPool pool(numThreads);
+    std::vector<std::future<void>> futures;
+
+    for (int t = 0; t < numThreads; ++t) {
+        size_t start = std::min(t * blockSize, numIds);
+        size_t end = std::min(start + blockSize, numIds);
+        futures.push_back(pool.enqueue([&encoded, &partial, t, start, end]() {
+            auto& histogram = partial[t];
+            size_t unknown = histogram.size() - 1;
+            for (size_t i = start; i < end; ++i) {
+                size_t id = static_cast<size_t>(encoded.ids[i]);
+                ++histogram[id < unknown ? id : unknown];
+            }
+            }));
+    }
+
+    for (auto& future : futures) {
+        future.get();
+    }
+    for (const auto& histogram : partial) {
+        for (size_t id = 0; id < counts.size(); ++id) counts[id] += histogram[id];
+    }
+}
+
+void writeJson(const std::string& path, const CorpusReport& report) {
+    std::ofstream out(path);
+    if (!out) throw std::runtime_error("Cannot write " + path);
+
+    out << std::fixed << std::setprecision(6);
+    out << "{\n";
+    out << "  \"benchmark\": \"corpus\",\n";
+    out << "  \"bytes\": " << report.bytes << ",\n";
+    out << "  \"documents\": " << report.documents << ",\n";
+    out << "  \"tokens\": " << report.tokens << ",\n";
+    out << "  \"keptTokens\": " << report.keptTokens << ",\n";
+    out << "  \"distinctIds\": " << report.distinctIds << ",\n";
+    out << "  \"threads\": " << report.threads << ",\n";
+    out << "  \"generateSeconds\": " << report.generateSeconds << ",\n";
+    out << "  \"seconds\": " << report.seconds() << ",\n";
+    out << "  \"gbPerSecond\": " << report.gbPerSecond(report.seconds()) << ",\n";
+    out << "  \"peakRssMB\": " << report.peakRss / (1024.0 * 1024.0) << ",\n";
+    if (Allocations::enabled) out << "  \"allocationsPerKToken\": " << report.perKToken(report.allocations()) << ",\n";
+    out << "  \"stages\": {\n";
+    for (size_t i = 0; i < numStages; ++i) {
+        const PerfSample& counters = report.stageCounters[i];
+        out << "    \"" << stageNames[i] << "\": { \"seconds\": " << report.stageSeconds[i]
+            << ", \"gbPerSecond\": " << report.gbPerSecond(report.stageSeconds[i]);
+        if (counters.has(Cycles) && counters.has(Instructions)) out << ", \"ipc\": " << counters.ipc();
+        if (counters.has(L1Misses)) out << ", \"l1MissesPerToken\": " << counters.perItem(L1Misses, report.tokens);
+        if (counters.has(LlcMisses)) out << ", \"llcMissesPerToken\": " << counters.perItem(LlcMisses, report.tokens);
+        if (counters.has(BranchMisses)) out << ", \"branchMissesPerToken\": " << counters.perItem(BranchMisses, report.tokens);
+        if (Allocations::enabled) {
+            out << ", \"allocationsPerKToken\": " << report.perKToken(report.stageAllocations[i].allocations)
+                << ", \"allocatedBytesPerToken\": " << report.perToken(report.stageAllocations[i].bytes);
+        }
+        out << " }" << (i + 1 < numStages ? "," : "") << "\n";
+    }
+    out << "  }\n";
+    out << "}\n";
+}
+
+double jsonNumber(const std::string& json, const std::string& key, size_t from = 0) {
+    // Value of the first "key": <number> at or after `from`; NaN when absent. Enough for the files writeJson produces.
+    size_t pos = json.find("\"" + key + "\"", from);
+    if (pos == std::string::npos) return std::numeric_limits<double>::quiet_NaN();
+    pos = json.find(':', pos);
+    if (pos == std::string::npos) return std::numeric_limits<double>::quiet_NaN();
+    char* end = nullptr;
+    double value = std::strtod(json.c_str() + pos + 1, &end);
+    return end == json.c_str() + pos + 1 ? std::numeric_limits<double>::quiet_NaN() : value;
+}
+
+bool compareToBaseline(const std::string& path, const CorpusReport& report, double maxSlowdown, double maxRssGrowth, double maxAllocGrowth) {
+    /*
+    Input:
+        - path: JSON written by an earlier `--json` run.
+        - maxSlowdown: Largest tolerated drop of any GB/s figure, as a fraction of the baseline.
+        - maxRssGrowth: Largest tolerated rise of the peak RSS, as a fraction of the baseline.
+        - maxAllocGrowth: Largest tolerated rise of allocations per 1000 tokens, overall and per stage. Only
+          checked when both runs counted allocations.
+    Output:
+        - false when any metric is outside its threshold.
+    */
+
+    std::ifstream in(path);
+    if (!in) throw std::runtime_error("Cannot read baseline " + path);
+    std::string json((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+
+    if (jsonNumber(json, "bytes") != static_cast<double>(report.bytes) || jsonNumber(json, "threads") != report.threads) {
+        std::cout << "\n\033[33mBaseline was measured with a different corpus size or thread count.\033[0m\n";
+    }
+
+    bool passed = true;
+    std::cout << "\n" << std::left << std::setw(36) << "metric" << std::right << std::setw(12) << "baseline"
+        << std::setw(12) << "current" << std::setw(10) << "change" << "\n";
+    auto check = [&](const std::string& metric, double baseline, double current, bool higherIsBetter, double threshold) {
+        if (std::isnan(baseline)) {
+            std::cout << std::left << std::setw(36) << metric << std::right << std::setw(12) << "-" << std::setw(12) << current << "\n";
+            return;
+        }
+        double change = baseline > 0 ? (current - baseline) / baseline : 0.0;
+        bool regressed = higherIsBetter ? change < -threshold : change > threshold;
+        passed = passed && !regressed;
+        std::cout << std::left << std::setw(36) << metric << std::right << std::fixed << std::setprecision(3)
+            << std::setw(12) << baseline << std::setw(12) << current << std::setw(9) << std::setprecision(1) << change * 100 << "%"
+            << (regressed ? "  \033[31mREGRESSION\033[0m" : "") << "\n";
+    };
+
+    check("gbPerSecond", jsonNumber(json, "gbPerSecond"), report.gbPerSecond(report.seconds()), true, maxSlowdown);
+    size_t stages = json.find("\"stages\"");
+    for (size_t i = 0; i < numStages; ++i) {
+        size_t stage = stages == std::string::npos ? std::string::npos : json.find("\"" + std::string(stageNames[i]) + "\"", stages);
+        double baseline = stage == std::string::npos ? std::numeric_limits<double>::quiet_NaN() : jsonNumber(json, "gbPerSecond", stage);
+        check(std::string(stageNames[i]) + ".gbPerSecond", baseline, report.gbPerSecond(report.stageSeconds[i]), true, maxSlowdown);
+    }
+    check("peakRssMB", jsonNumber(json, "peakRssMB"), report.peakRss / (1024.0 * 1024.0), false, maxRssGrowth);
+    if (Allocations::enabled && !std::isnan(jsonNumber(json, "allocationsPerKToken"))) {
+        check("allocationsPerKToken", jsonNumber(json, "allocationsPerKToken"), report.perKToken(report.allocations()), false, maxAllocGrowth);
+        for (size_t i = 0; i < numStages; ++i) {
+            size_t stage = stages == std::string::npos ? std::string::npos : json.find("\"" + std::string(stageNames[i]) + "\"", stages);
+            double baseline = stage == std::string::npos ? std::numeric_limits<double>::quiet_NaN() : jsonNumber(json, "allocationsPerKToken", stage);
+            check(std::string(stageNames[i]) + ".allocationsPerKToken", baseline, report.perKToken(report.stageAllocations[i].allocations), false, maxAllocGrowth);
+        }
+    }
+    return passed;
+}
+
+}
+
+int main(int argc, char** argv) {
+    double sizeGB = 2.0;
+    size_t chunkMB = 64;
+    int numThreads = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    uint64_t seed = 42;
+    std::string jsonPath, baselinePath, tracePath;
+    double maxSlowdown = 0.10, maxRssGrowth = 0.25, maxAllocGrowth = 0.10;
+    bool useCounters = false;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg.rfind("--size-gb=", 0) == 0) sizeGB = std::atof(arg.c_str() + 10);
+        else if (arg.rfind("--chunk-mb=", 0) == 0) chunkMB = std::strtoull(arg.c_str() + 11, nullptr, 10);
+        else if (arg.rfind("--threads=", 0) == 0) numThreads = std::atoi(arg.c_str() + 10);
+        else if (arg.rfind("--seed=", 0) == 0) seed = std::strtoull(arg.c_str() + 7, nullptr, 10);
+        else if (arg.rfind("--json=", 0) == 0) jsonPath = arg.substr(7);
+        else if (arg.rfind("--baseline=", 0) == 0) baselinePath = arg.substr(11);
+        else if (arg.rfind("--max-slowdown=", 0) == 0) maxSlowdown = std::atof(arg.c_str() + 15);
+        else if (arg.rfind("--max-rss-growth=", 0) == 0) maxRssGrowth = std::atof(arg.c_str() + 17);
+        else if (arg.rfind("--max-alloc-growth=", 0) == 0) maxAllocGrowth = std::atof(arg.c_str() + 19);
+        else if (arg.rfind("--trace=", 0) == 0) tracePath = arg.substr(8);
+        else if (arg == "--counters") useCounters = true;
+        else {
+            std::cerr << "Usage: bench_corpus [--size-gb=2] [--chunk-mb=64] [--threads=N] [--seed=42] [--json=path]\n"
+                << "                    [--baseline=path] [--max-slowdown=0.10] [--max-rss-growth=0.25] [--counters]\n"
+                << "                    [--max-alloc-growth=0.10] [--trace=path]\n";
+            return 1;
+        }
+    }
+    if (sizeGB <= 0 || chunkMB == 0 || numThreads <= 0) {
+        std::cerr << "--size-gb, --chunk-mb and --threads must be positive.\n";
+        return 1;
+    }
+
+    fs::path configDir = fs::temp_directory_path() / "nlp_toolkit_bench_corpus";
+    fs::create_directories(configDir);
+    std::string stopWordsFile = (configDir / "stop_words.txt").string();
+    {
+        std::ofstream out(stopWordsFile);
+        for (const char* word : { "the", "of", "and", "to", "a", "in", "is", "it", "that", "for", "was", "on" }) out << word << "\n";
+    }
+
+    ZipfCorpus corpus(50000, 1.1, seed);
+    Tokenizer tokenizer(corpus.vocabulary());
+    std::mt19937_64 gen(seed);
+
+    CorpusReport report;
+    report.threads = numThreads;
+    size_t targetBytes = static_cast<size_t>(sizeGB * 1e9);
+    size_t chunkBytes = chunkMB * 1024 * 1024;
+    std::vector<uint64_t> idCounts(tokenizer.vocabSize() + 1, 0);
+
+    std::unique_ptr<PerfCounters> counters;
+    if (useCounters) {
+        counters.reset(new PerfCounters());
+        if (!counters->available()) {
+            std::cerr << "Hardware counters unavailable (" << counters->error() << "), reporting time only.\n";
+            counters.reset();
+        }
+    }
+    auto runStage = [&](size_t stage, const std::function<void()>& body) {
+        Allocations::Scope allocationScope;
+        if (counters) counters->start();
+        report.stageSeconds[stage] += secondsOf(body);
+        if (counters) report.stageCounters[stage] += counters->stop();
+        AllocationStats allocated = allocationScope.stats();
+        report.stageAllocations[stage].allocations += allocated.allocations;
+        report.stageAllocations[stage].bytes += allocated.bytes;
+    };
+
+    if (!tracePath.empty()) {
+#ifndef NLP_ENABLE_TRACING
+        std::cerr << "Built without NLP_ENABLE_TRACING, the trace will be empty.\n";
+#endif
+        Trace::start();
+    }
+
+    while (report.bytes < targetBytes) {
+        // Documents of 20-400 words, the shape of web pages and paragraphs.
+        std::vector<std::string> documents;
+        size_t generated = 0;
+        report.generateSeconds += secondsOf([&]() {
+            while (generated < std::min(chunkBytes, targetBytes - report.bytes)) {
+                documents.push_back(corpus.text(20 + gen() % 381));
+                generated += documents.back().size();
+            }
+            });
+        std::vector<std::string_view> views(documents.begin(), documents.end());
+
+        QuietCout quiet;
+        StringBatch normalized;
+        TokenizedBatch tokenized;
+        StringBatch filtered;
+        EncodedBuffer encoded;
+        runStage(0, [&]() { normalized = Toolkit::batchNormalize(views, true, true, numThreads, ""); });
+
+        std::vector<std::string_view> normalizedViews(normalized.size());
+        for (size_t i = 0; i < normalized.size(); ++i) normalizedViews[i] = normalized.at(i);
+        runStage(1, [&]() { tokenized = Toolkit::batchTokenize(normalizedViews, numThreads, ""); });
+        runStage(2, [&]() { filtered = Toolkit::batchRemoveStopWords(tokenized, stopWordsFile, numThreads, ""); });
+
+        std::vector<std::string_view> filteredViews(filtered.size());
+        for (size_t i = 0; i < filtered.size(); ++i) filteredViews[i] = filtered.at(i);
+        runStage(3, [&]() { encoded = tokenizer.batchEncodeTextToBuffer(filteredViews, numThreads, SIZE_MAX, ""); });
+        runStage(4, [&]() { countIds(encoded, numThreads, idCounts); });
+
+        report.bytes += generated;
+        report.documents += documents.size();
+        report.tokens += tokenized.tokens.size();
+        report.keptTokens += encoded.ids.size();
+    }
+    for (uint64_t count : idCounts) report.distinctIds += count > 0 ? 1 : 0;
+    report.peakRss = peakRssBytes();
+    fs::remove_all(configDir);
+
+    double total = report.seconds();
+    std::cout << "corpus: " << std::fixed << std::setprecision(2) << report.bytes / 1e9 << " GB, " << report.documents << " documents, "
+        << report.tokens << " tokens (" << report.keptTokens << " after stop words, " << report.distinctIds << " distinct IDs), "
+        << numThreads << " threads, generated in " << report.generateSeconds << " s\n\n";
+    std::cout << std::left << std::setw(20) << "stage" << std::right << std::setw(12) << "seconds" << std::setw(10) << "GB/s" << std::setw(10) << "share";
+    if (counters) {
+        std::cout << std::setw(8) << "IPC" << std::setw(15) << "L1 miss/token" << std::setw(16) << "LLC miss/token" << std::setw(15) << "br miss/token";
+    }
+    if (Allocations::enabled) std::cout << std::setw(15) << "allocs/1k tok" << std::setw(14) << "bytes/token";
+    std::cout << "\n";
+    for (size_t i = 0; i < numStages; ++i) {
+        std::cout << std::left << std::setw(20) << stageNames[i] << std::right << std::setprecision(3) << std::setw(12) << report.stageSeconds[i]
+            << std::setw(10) << report.gbPerSecond(report.stageSeconds[i])
+            << std::setw(9) << std::setprecision(1) << (total > 0 ? report.stageSeconds[i] / total * 100 : 0.0) << "%";
+        if (counters) {
+            const PerfSample& sample = report.stageCounters[i];
+            std::cout << std::setw(8) << std::setprecision(2);
+            if (sample.has(Cycles) && sample.has(Instructions)) std::cout << sample.ipc();
+            else std::cout << "-";
+            std::cout << std::setw(15) << perItemColumn(sample, L1Misses, report.tokens) << std::setw(16) << perItemColumn(sample, LlcMisses, report.tokens)
+                << std::setw(15) << perItemColumn(sample, BranchMisses, report.tokens);
+        }
+        if (Allocations::enabled) {
+            std::cout << std::setw(15) << std::setprecision(3) << report.perKToken(report.stageAllocations[i].allocations)
+                << std::setw(14) << std::setprecision(1) << report.perToken(report.stageAllocations[i].bytes);
+        }
+        std::cout << "\n";
+    }
+    std::cout << std::left << std::setw(20) << "total" << std::right << std::setprecision(3) << std::setw(12) << total
+        << std::setw(10) << report.gbPerSecond(total) << "\n";
+    std::cout << "peak RSS: " << std::setprecision(1) << report.peakRss / (1024.0 * 1024.0) << " MB\n";
+
+    try {
+        if (!tracePath.empty()) {
+            Trace::stop();
+            Trace::dump(tracePath);
+        }
+        if (!jsonPath.empty()) writeJson(jsonPath, report);
+        if (!baselinePath.empty() && !compareToBaseline(baselinePath, report, maxSlowdown, maxRssGrowth, maxAllocGrowth)) return 2;
+    }
+    catch (const std::exception& e) {
+        std::cerr << e.what() << "\n";
+        return 1;
+    }
+    return 0;
+}
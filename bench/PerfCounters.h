@@ -0,0 +1,135 @@
+#pragma once
+// Hardware performance counters for the benchmarks, read through Linux perf_event_open: cycles,
+// instructions, L1 data and last-level cache misses, and branch misses of the calling thread and
+// every thread it starts while counting (so ThreadPool workers are included). Each counter is
+// opened on its own, so a PMU that lacks one event still reports the others. Where perf is not
+// available (other platforms, containers, perf_event_paranoid > 2) every counter reads as invalid.
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#ifdef __linux__
+#include <cerrno>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+enum PerfEvent { Cycles, Instructions, L1Misses, LlcMisses, BranchMisses, numPerfEvents };
+
+struct PerfSample {
+    std::array<double, numPerfEvents> counts{};
+    std::array<bool, numPerfEvents> valid{};
+    size_t samples = 0;             // start()/stop() intervals summed into this sample.
+
+    bool has(PerfEvent event) const { return valid[event]; }
+    double ipc() const { return has(Cycles) && has(Instructions) && counts[Cycles] > 0 ? counts[Instructions] / counts[Cycles] : 0.0; }
+    double perItem(PerfEvent event, size_t items) const { return items > 0 ? counts[event] / items : 0.0; }
+
+    PerfSample& operator+=(const PerfSample& other) {
+        for (size_t i = 0; i < numPerfEvents; ++i) {
+            valid[i] = (samples == 0 || valid[i]) && other.valid[i];
+            counts[i] += other.counts[i];
+        }
+        samples += other.samples;
+        return *this;
+    }
+
+    PerfSample scaled(double factor) const {
+        PerfSample result = *this;
+        for (double& count : result.counts) count *= factor;
+        return result;
+    }
+};
+
+class PerfCounters {
+private:
+    std::array<int, numPerfEvents> fds;
+    std::string failure;
+
+#ifdef __linux__
+    static int open(uint32_t type, uint64_t config) {
+        perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = type;
+        attr.config = config;
+        attr.disabled = 1;
+        attr.inherit = 1;               // Count threads created while enabled, e.g. ThreadPool workers.
+        attr.exclude_kernel = 1;        // Allowed at perf_event_paranoid 2, the common default.
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+    }
+#endif
+
+public:
+    PerfCounters() {
+        fds.fill(-1);
+#ifdef __linux__
+        const uint64_t l1ReadMiss = PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+        fds[Cycles] = open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+        if (fds[Cycles] < 0) failure = std::string("perf_event_open: ") + std::strerror(errno);
+        fds[Instructions] = open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+        fds[L1Misses] = open(PERF_TYPE_HW_CACHE, l1ReadMiss);
+        fds[LlcMisses] = open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+        fds[BranchMisses] = open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES);
+#else
+        failure = "hardware counters need Linux perf_event_open";
+#endif
+    }
+
+    ~PerfCounters() {
+#ifdef __linux__
+        for (int fd : fds) {
+            if (fd >= 0) close(fd);
+        }
+#endif
+    }
+
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+    bool available() const {
+        for (int fd : fds) {
+            if (fd >= 0) return true;
+        }
+        return false;
+    }
+
+    // Why no counter could be opened, empty when at least one is available.
+    std::string error() const { return available() ? std::string() : failure; }
+
+    void start() {
+#ifdef __linux__
+        for (int fd : fds) {
+            if (fd < 0) continue;
+            ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+            ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+#endif
+    }
+
+    PerfSample stop() {
+        /*
+        Output:
+            - The counts since start(). When the kernel multiplexed a counter with others it was only
+              running part of the time, so its count is scaled up by enabled / running time.
+        */
+
+        PerfSample sample;
+        sample.samples = 1;
+#ifdef __linux__
+        for (size_t i = 0; i < numPerfEvents; ++i) {
+            if (fds[i] < 0) continue;
+            ioctl(fds[i], PERF_EVENT_IOC_DISABLE, 0);
+            uint64_t values[3] = {};    // value, time enabled, time running
+            if (read(fds[i], values, sizeof(values)) != static_cast<ssize_t>(sizeof(values)) || values[2] == 0) continue;
+            sample.counts[i] = static_cast<double>(values[0]) * values[1] / values[2];
+            sample.valid[i] = true;
+        }
+#endif
+        return sample;
+    }
+};
@@ -0,0 +1,194 @@
+// Thread scaling of every operation that takes numThreads: runs each one at 1..N threads on the
+// same input and reports speedup, parallel efficiency and the Karp-Flatt serial fraction
+//     e(p) = (1 / S(p) - 1 / p) / (1 - 1 / p),
+// the share of the one-thread time that behaved serially at p threads. A serial fraction that
+// stays flat as p grows is an Amdahl bottleneck (a serial merge or copy) capping speedup at 1 / e;
+// one that grows with p points at overhead such as thread start-up or contention instead.
+//
+// Usage: bench_scaling [--filter=substring] [--min-time=seconds] [--words=count] [--max-threads=N]
+#include "BenchHarness.h"
+#include "ZipfCorpus.h"
+#include "../Toolkit.h"
+#include "../Tokenizer.h"
+#include <cmath>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <string_view>
+#include <thread>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+struct ScalingCase {
+    std::string name;
+    size_t items;
+    size_t bytes;
+    std::function<void(int)> body;      // Runs the operation with the given thread count.
+};
+
+struct ScalingSummary {
+    std::string name;
+    double bestSpeedup = 1.0;
+    int bestThreads = 1;
+    double serialFraction = std::numeric_limits<double>::quiet_NaN();  // Karp-Flatt at the largest thread count.
+};
+
+double karpFlatt(double speedup, int threads) {
+    // Undefined (NaN) at one thread. Negative when the speedup is superlinear, e.g. from more cache.
+    if (threads <= 1 || speedup <= 0) return std::numeric_limits<double>::quiet_NaN();
+    return (1.0 / speedup - 1.0 / threads) / (1.0 - 1.0 / threads);
+}
+
+void writeLines(const fs::path& path, const std::vector<std::string>& lines) {
+    std::ofstream out(path);
+    for (const auto& line : lines) out << line << "\n";
+}
+
+}
+
+int main(int argc, char** argv) {
+    std::string filter;
+    double minTime = 0.2;
+    size_t numWords = size_t(1) << 20;
+    int maxThreads = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg.rfind("--filter=", 0) == 0) filter = arg.substr(9);
+        else if (arg.rfind("--min-time=", 0) == 0) minTime = std::atof(arg.c_str() + 11);
+        else if (arg.rfind("--words=", 0) == 0) numWords = std::strtoull(arg.c_str() + 8, nullptr, 10);
+        else if (arg.rfind("--max-threads=", 0) == 0) maxThreads = std::atoi(arg.c_str() + 14);
+        else {
+            std::cerr << "Usage: bench_scaling [--filter=substring] [--min-time=seconds] [--words=count] [--max-threads=N]\n";
+            return 1;
+        }
+    }
+
+    // The operations clamp numThreads to the hardware concurrency, so larger counts would only repeat it.
+    int hardwareThreads = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    if (maxThreads <= 0 || maxThreads > hardwareThreads) maxThreads = hardwareThreads;
+
+    fs::path configDir = fs::temp_directory_path() / "nlp_toolkit_bench_scaling";
+    fs::create_directories(configDir);
+    std::string stopWordsFile = (configDir / "stop_words.txt").string();
+    std::string specialCharFile = (configDir / "special_characters.txt").string();
+    writeLines(stopWordsFile, { "the", "of", "and", "to", "a", "in", "is", "it", "that", "for", "was", "on" });
+    writeLines(specialCharFile, { ",", ".", ";", ":", "!", "?", "(", ")", "\"", "'" });
+
+    ZipfCorpus corpus;
+    Tokenizer tokenizer(corpus.vocabulary());
+    std::string text = corpus.text(numWords);
+
+    // Sentences of 32 words, as both token lists and texts.
+    std::vector<std::string> tokens;
+    {
+        QuietCout quiet;
+        tokens = Toolkit::tokenize(text, "");
+    }
+    std::vector<std::vector<std::string>> sentences;
+    std::vector<std::string> texts;
+    for (size_t i = 0; i + 32 <= tokens.size(); i += 32) {
+        sentences.emplace_back(tokens.begin() + i, tokens.begin() + i + 32);
+        std::string joined;
+        for (const auto& token : sentences.back()) joined += (joined.empty() ? "" : " ") + token;
+        texts.push_back(std::move(joined));
+    }
+    std::vector<std::string_view> views(texts.begin(), texts.end());
+    size_t sentenceWords = sentences.size() * 32;
+    size_t textBytes = 0;
+    for (const auto& t : texts) textBytes += t.size();
+
+    TokenizedBatch tokenized;
+    std::vector<std::vector<int>> encoded;
+    {
+        QuietCout quiet;
+        tokenized = Toolkit::batchTokenize(views, 1, "");
+        encoded = tokenizer.batchEncode(sentences, 1, "");
+    }
+    std::vector<std::string> embeddingTokens(tokens.begin(), tokens.begin() + std::min<size_t>(tokens.size(), 65536));
+
+    std::vector<ScalingCase> cases = {
+        { "getBagOfWords", tokens.size(), text.size(), [&](int n) { Toolkit::getBagOfWords(tokens, n, ""); } },
+        { "getEmbeddings/dim:64", embeddingTokens.size(), 0, [&](int n) { Toolkit::getEmbeddings(embeddingTokens, 64, n, ""); } },
+        { "getEmbeddingMatrix/dim:64", embeddingTokens.size(), 0, [&](int n) { Toolkit::getEmbeddingMatrix(embeddingTokens, 64, n, ""); } },
+        { "removeSpecialCharacters", numWords, text.size(), [&](int n) { Toolkit::removeSpecialCharacters(text, specialCharFile, n, ""); } },
+        { "removeStopWords", numWords, text.size(), [&](int n) { Toolkit::removeStopWords(text, stopWordsFile, n, ""); } },
+        { "batchTokenize", sentenceWords, textBytes, [&](int n) { Toolkit::batchTokenize(views, n, ""); } },
+        { "batchNormalize", sentenceWords, textBytes, [&](int n) { Toolkit::batchNormalize(views, true, true, n, ""); } },
+        { "batchRemoveStopWords", sentenceWords, textBytes, [&](int n) { Toolkit::batchRemoveStopWords(tokenized, stopWordsFile, n, ""); } },
+        { "Toolkit::batchCountTokens", sentenceWords, textBytes, [&](int n) { Toolkit::batchCountTokens(texts, n, ""); } },
+        { "batchEncode", sentenceWords, textBytes, [&](int n) { tokenizer.batchEncode(sentences, n, ""); } },
+        { "batchEncodeToBuffer", sentenceWords, textBytes, [&](int n) { tokenizer.batchEncodeToBuffer(sentences, n, SIZE_MAX, ""); } },
+        { "batchDecode", sentenceWords, textBytes, [&](int n) { tokenizer.batchDecode(encoded, n, ""); } },
+        { "batchDecodeToString", sentenceWords, textBytes, [&](int n) { tokenizer.batchDecodeToString(encoded, n, DetokenizeOptions(), ""); } },
+        { "batchDecodeToBuffer", sentenceWords, textBytes, [&](int n) { tokenizer.batchDecodeToBuffer(encoded, n, DetokenizeOptions(), ""); } },
+        { "batchEncodeText", sentenceWords, textBytes, [&](int n) { tokenizer.batchEncodeText(texts, n, ""); } },
+        { "batchEncodeTextToBuffer", sentenceWords, textBytes, [&](int n) { tokenizer.batchEncodeTextToBuffer(views, n, SIZE_MAX, ""); } },
+        { "batchEncodeTextPadded", sentenceWords, textBytes, [&](int n) { tokenizer.batchEncodeTextPadded(views, n, SIZE_MAX, 0, ""); } },
+        { "Tokenizer::batchCountTokens", sentenceWords, textBytes, [&](int n) { tokenizer.batchCountTokens(texts, n, ""); } },
+    };
+
+    BenchHarness harness(minTime);
+    std::vector<ScalingSummary> summaries;
+    for (const auto& scalingCase : cases) {
+        if (!filter.empty() && scalingCase.name.find(filter) == std::string::npos) continue;
+
+        std::cout << "\n" << scalingCase.name << " (" << scalingCase.items << " items)\n";
+        std::cout << std::right << std::setw(9) << "threads" << std::setw(12) << "ms" << std::setw(16) << "items/s"
+            << std::setw(10) << "speedup" << std::setw(12) << "efficiency" << std::setw(10) << "serial" << "\n";
+
+        ScalingSummary summary;
+        summary.name = scalingCase.name;
+        double oneThread = 0.0;
+        for (int threads = 1; threads <= maxThreads; ++threads) {
+            BenchResult result = harness.measure(caseName(scalingCase.name, scalingCase.items, "items", threads),
+                scalingCase.items, scalingCase.bytes, [&]() { scalingCase.body(threads); });
+            if (threads == 1) oneThread = result.seconds;
+
+            double speedup = result.seconds > 0 ? oneThread / result.seconds : 0.0;
+            double serial = karpFlatt(speedup, threads);
+            if (speedup > summary.bestSpeedup) {
+                summary.bestSpeedup = speedup;
+                summary.bestThreads = threads;
+            }
+            summary.serialFraction = serial;
+
+            std::cout << std::setw(9) << threads << std::fixed << std::setprecision(3) << std::setw(12) << result.seconds * 1e3
+                << std::setprecision(0) << std::setw(16) << result.itemsPerSecond()
+                << std::setprecision(2) << std::setw(10) << speedup << std::setw(11) << speedup / threads * 100 << "%";
+            if (!std::isnan(serial)) std::cout << std::setw(9) << std::setprecision(1) << serial * 100 << "%";
+            else std::cout << std::setw(10) << "-";
+            std::cout << "\n";
+        }
+        summaries.push_back(summary);
+    }
+    fs::remove_all(configDir);
+
+    // Most serial first: these are the operations whose speedup stops growing soonest.
+    std::stable_sort(summaries.begin(), summaries.end(), [](const ScalingSummary& a, const ScalingSummary& b) {
+        auto key = [](double serial) { return std::isnan(serial) ? -std::numeric_limits<double>::infinity() : serial; };
+        return key(a.serialFraction) > key(b.serialFraction);
+        });
+    std::cout << "\nSummary at " << maxThreads << " threads\n";
+    std::cout << std::left << std::setw(32) << "operation" << std::right << std::setw(14) << "best speedup"
+        << std::setw(10) << "serial" << std::setw(16) << "Amdahl limit" << "\n";
+    for (const auto& summary : summaries) {
+        std::cout << std::left << std::setw(32) << summary.name << std::right << std::fixed << std::setprecision(2)
+            << std::setw(8) << summary.bestSpeedup << "x @ " << std::setw(2) << summary.bestThreads;
+        if (std::isnan(summary.serialFraction)) {
+            std::cout << std::setw(10) << "-" << std::setw(16) << "-";
+        }
+        else {
+            std::cout << std::setw(9) << std::setprecision(1) << summary.serialFraction * 100 << "%";
+            if (summary.serialFraction > 0) std::cout << std::setw(15) << std::setprecision(1) << 1.0 / summary.serialFraction << "x";
+            else std::cout << std::setw(16) << "-";
+        }
+        std::cout << "\n";
+    }
+    if (maxThreads == 1) {
+        std::cout << "\n\033[33mOnly one hardware thread: speedup and serial fractions need at least two.\033[0m\n";
+    }
+    return 0;
+}
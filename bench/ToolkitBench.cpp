@@ -0,0 +1,157 @@
+// Microbenchmarks of every Toolkit and Tokenizer operation on Zipfian synthetic text, across
+// input sizes and thread counts. Reports the median iteration as items/s and MB/s, and with
+// --counters the IPC and L1/LLC/branch misses per item from the hardware counters.
+//
+// Usage: bench [--filter=substring] [--min-time=seconds] [--max-words=count] [--counters]
+#include "BenchHarness.h"
+#include "ZipfCorpus.h"
+#include "../Toolkit.h"
+#include "../Tokenizer.h"
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <string_view>
+#include <thread>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+size_t bytesOf(const std::vector<std::string>& strings) {
+    size_t bytes = 0;
+    for (const auto& s : strings) bytes += s.size();
+    return bytes;
+}
+
+size_t bytesOf(const std::vector<std::vector<std::string>>& sentences) {
+    size_t bytes = 0;
+    for (const auto& sentence : sentences) bytes += bytesOf(sentence);
+    return bytes;
+}
+
+std::vector<int> threadCounts() {
+    int maxThreads = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    std::vector<int> counts;
+    for (int n : { 1, 2, 4, maxThreads }) {
+        if (n <= maxThreads && std::find(counts.begin(), counts.end(), n) == counts.end()) counts.push_back(n);
+    }
+    return counts;
+}
+
+void writeLines(const fs::path& path, const std::vector<std::string>& lines) {
+    std::ofstream out(path);
+    for (const auto& line : lines) out << line << "\n";
+}
+
+}
+
+int main(int argc, char** argv) {
+    std::string filter;
+    double minTime = 0.2;
+    size_t maxWords = size_t(1) << 20;
+    bool useCounters = false;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg.rfind("--filter=", 0) == 0) filter = arg.substr(9);
+        else if (arg.rfind("--min-time=", 0) == 0) minTime = std::atof(arg.c_str() + 11);
+        else if (arg.rfind("--max-words=", 0) == 0) maxWords = std::strtoull(arg.c_str() + 12, nullptr, 10);
+        else if (arg == "--counters") useCounters = true;
+        else {
+            std::cerr << "Usage: bench [--filter=substring] [--min-time=seconds] [--max-words=count] [--counters]\n";
+            return 1;
+        }
+    }
+
+    BenchHarness harness(minTime, filter);
+    if (useCounters) harness.enableCounters();
+    ZipfCorpus corpus;
+    std::vector<int> threads = threadCounts();
+
+    fs::path configDir = fs::temp_directory_path() / "nlp_toolkit_bench";
+    fs::create_directories(configDir);
+    std::string stopWordsFile = (configDir / "stop_words.txt").string();
+    std::string specialCharFile = (configDir / "special_characters.txt").string();
+    writeLines(stopWordsFile, { "the", "of", "and", "to", "a", "in", "is", "it", "that", "for", "was", "on" });
+    writeLines(specialCharFile, { ",", ".", ";", ":", "!", "?", "(", ")", "\"", "'" });
+
+    Tokenizer tokenizer(corpus.vocabulary());
+
+    for (size_t words = 1024; words <= maxWords; words *= 64) {
+        std::string text = corpus.text(words);
+        std::vector<std::string> tokens;
+        {
+            QuietCout quiet;
+            tokens = Toolkit::tokenize(text, "");
+        }
+        size_t tokenBytes = bytesOf(tokens);
+
+        harness.run(caseName("tokenize", words, "words"), words, text.size(), [&]() { Toolkit::tokenize(text, ""); });
+        harness.run(caseName("toLower", words, "words"), words, text.size(), [&]() { Toolkit::toLower(text, ""); });
+        harness.run(caseName("removePunctuation", words, "words"), words, text.size(), [&]() { Toolkit::removePunctuation(text, ""); });
+        harness.run(caseName("getNGrams/n:3", words, "words"), words, tokenBytes, [&]() { Toolkit::getNGrams(tokens, 3, ""); });
+        harness.run(caseName("stem", words, "words"), words, tokenBytes, [&]() {
+            for (const auto& token : tokens) Toolkit::stem(token, "");
+            });
+
+        // One sentence of 32 words per batch item.
+        std::vector<std::vector<std::string>> sentences;
+        for (size_t i = 0; i + 32 <= tokens.size(); i += 32) sentences.emplace_back(tokens.begin() + i, tokens.begin() + i + 32);
+        std::vector<std::string> texts;
+        for (const auto& sentence : sentences) {
+            std::string joined;
+            for (const auto& token : sentence) joined += (joined.empty() ? "" : " ") + token;
+            texts.push_back(std::move(joined));
+        }
+        std::vector<std::string_view> views(texts.begin(), texts.end());
+        size_t sentenceWords = sentences.size() * 32;
+        size_t sentenceBytes = bytesOf(sentences);
+        size_t textBytes = bytesOf(texts);
+
+        std::vector<int> ids;
+        std::vector<std::vector<int>> encoded;
+        {
+            QuietCout quiet;
+            ids = tokenizer.encode(tokens, "");
+            encoded = tokenizer.batchEncode(sentences, 1, "");
+        }
+        harness.run(caseName("encode", words, "words"), words, tokenBytes, [&]() { tokenizer.encode(tokens, ""); });
+        harness.run(caseName("decode", words, "words"), words, tokenBytes, [&]() { tokenizer.decode(ids, ""); });
+        harness.run(caseName("decodeToString", words, "words"), words, tokenBytes, [&]() { tokenizer.decodeToString(ids, DetokenizeOptions(), ""); });
+        harness.run(caseName("encodeText", words, "words"), words, text.size(), [&]() { tokenizer.encodeText(text, ""); });
+        harness.run(caseName("countTokens", words, "words"), words, text.size(), [&]() { tokenizer.countTokens(text, ""); });
+
+        for (int n : threads) {
+            harness.run(caseName("getBagOfWords", words, "words", n), words, tokenBytes, [&]() { Toolkit::getBagOfWords(tokens, n, ""); });
+            harness.run(caseName("removeSpecialCharacters", words, "words", n), words, text.size(), [&]() {
+                Toolkit::removeSpecialCharacters(text, specialCharFile, n, "");
+                });
+            harness.run(caseName("removeStopWords", words, "words", n), words, text.size(), [&]() {
+                Toolkit::removeStopWords(text, stopWordsFile, n, "");
+                });
+            if (words <= 65536) {
+                harness.run(caseName("getEmbeddings/dim:64", words, "words", n), words, tokenBytes, [&]() {
+                    Toolkit::getEmbeddings(tokens, 64, n, "");
+                    });
+            }
+
+            harness.run(caseName("batchTokenize", sentenceWords, "words", n), sentenceWords, textBytes, [&]() { Toolkit::batchTokenize(views, n, ""); });
+            harness.run(caseName("batchNormalize", sentenceWords, "words", n), sentenceWords, textBytes, [&]() { Toolkit::batchNormalize(views, true, true, n, ""); });
+            harness.run(caseName("batchEncode", sentenceWords, "words", n), sentenceWords, sentenceBytes, [&]() { tokenizer.batchEncode(sentences, n, ""); });
+            harness.run(caseName("batchEncodeToBuffer", sentenceWords, "words", n), sentenceWords, sentenceBytes, [&]() {
+                tokenizer.batchEncodeToBuffer(sentences, n, SIZE_MAX, "");
+                });
+            harness.run(caseName("batchDecode", sentenceWords, "words", n), sentenceWords, sentenceBytes, [&]() { tokenizer.batchDecode(encoded, n, ""); });
+            harness.run(caseName("batchDecodeToString", sentenceWords, "words", n), sentenceWords, sentenceBytes, [&]() {
+                tokenizer.batchDecodeToString(encoded, n, DetokenizeOptions(), "");
+                });
+            harness.run(caseName("batchEncodeText", sentenceWords, "words", n), sentenceWords, textBytes, [&]() { tokenizer.batchEncodeText(texts, n, ""); });
+            harness.run(caseName("batchEncodeTextToBuffer", sentenceWords, "words", n), sentenceWords, textBytes, [&]() {
+                tokenizer.batchEncodeTextToBuffer(views, n, SIZE_MAX, "");
+                });
+            harness.run(caseName("batchCountTokens", sentenceWords, "words", n), sentenceWords, textBytes, [&]() { tokenizer.batchCountTokens(texts, n, ""); });
+        }
+    }
+
+    fs::remove_all(configDir);
+    return 0;
+}
@@ -0,0 +1,82 @@
+// Compares one-at-a-time Vocabulary::find against the prefetched Vocabulary::findBatch
+// for vocabularies from cache-resident up to larger than the last-level cache.
+//
+// Usage: bench_vocab_lookup [max vocabulary size] [lookups]
+#include "../Vocabulary.h"
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <iomanip>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+std::string makeToken(uint64_t i) {
+    // Spread IDs over the alphabet so token lengths and prefixes vary like real words.
+    std::string token;
+    uint64_t x = i * 0x9E3779B97F4A7C15ull;
+    do {
+        token += static_cast<char>('a' + x % 26);
+        x /= 26;
+    } while (token.size() < 6 || (x % 4 != 0 && token.size() < 12));
+    return token + std::to_string(i);
+}
+
+template <class F>
+double secondsOf(F&& f) {
+    auto begin = std::chrono::steady_clock::now();
+    f();
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+}
+
+}
+
+int main(int argc, char** argv) {
+    size_t maxVocab = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 16000000;
+    size_t numLookups = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 4000000;
+
+    std::cout << std::left << std::setw(12) << "vocab" << std::setw(12) << "table MB"
+        << std::setw(16) << "find Mops/s" << std::setw(16) << "batch Mops/s" << "speedup\n";
+
+    for (size_t vocabSize = 1000; vocabSize <= maxVocab; vocabSize *= 4) {
+        std::vector<std::string> tokens;
+        tokens.reserve(vocabSize);
+        size_t textBytes = 0;
+        for (size_t i = 0; i < vocabSize; ++i) {
+            tokens.push_back(makeToken(i));
+            textBytes += tokens.back().size();
+        }
+        Vocabulary vocab(tokens);
+
+        // Uniform draws defeat the caches; 1 in 8 lookups misses the vocabulary entirely.
+        std::mt19937_64 gen(42);
+        std::vector<std::string> queries;
+        queries.reserve(numLookups);
+        for (size_t i = 0; i < numLookups; ++i) {
+            uint64_t r = gen();
+            queries.push_back(r % 8 == 0 ? makeToken(vocabSize + r % vocabSize) : tokens[r % vocabSize]);
+        }
+        std::vector<std::string_view> views(queries.begin(), queries.end());
+        std::vector<int> scalarIds(numLookups), batchIds(numLookups);
+
+        double scalar = secondsOf([&]() {
+            for (size_t i = 0; i < numLookups; ++i) scalarIds[i] = vocab.find(views[i]);
+            });
+        double batch = secondsOf([&]() {
+            vocab.findBatch(views.data(), views.size(), batchIds.data());
+            });
+        if (scalarIds != batchIds) {
+            std::cerr << "findBatch disagrees with find at vocabulary size " << vocabSize << "\n";
+            return 1;
+        }
+
+        // Slots are 16 bytes per token at the minimum load factor, plus offsets and text.
+        double tableMB = (vocabSize * (16.0 + 4.0) + textBytes) / (1024.0 * 1024.0);
+        std::cout << std::left << std::setw(12) << vocabSize << std::setw(12) << std::fixed << std::setprecision(1) << tableMB
+            << std::setw(16) << numLookups / scalar / 1e6 << std::setw(16) << numLookups / batch / 1e6
+            << std::setprecision(2) << scalar / batch << "x\n";
+    }
+    return 0;
+}
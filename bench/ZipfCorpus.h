@@ -0,0 +1,92 @@
+#pragma once
+// Synthetic corpora whose word frequencies follow Zipf's law, like natural text: a few function
+// words make up much of the text and the tail is long. Deterministic for a given seed.
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+class ZipfCorpus {
+private:
+    std::vector<std::string> words;     // By rank, most frequent first.
+    std::vector<double> cdf;
+    std::mt19937_64 gen;
+
+    static std::string syntheticWord(uint64_t i) {
+        std::string word;
+        uint64_t x = (i + 1) * 0x9E3779B97F4A7C15ull;
+        size_t length = 3 + x % 9;
+        while (word.size() < length) {
+            word += static_cast<char>('a' + (x >> 8) % 26);
+            x = x * 6364136223846793005ull + 1442695040888963407ull;
+        }
+        // Suffixes the stemmer strips, on about a third of the words.
+        static const char* suffixes[] = { "ing", "ed", "ly", "ness", "es", "s" };
+        if (i % 3 == 0) word += suffixes[(i / 3) % 6];
+        return word;
+    }
+
+public:
+    ZipfCorpus(size_t vocabularySize = 50000, double exponent = 1.1, uint64_t seed = 42) : gen(seed) {
+        // The top ranks are real function words, so stop-word removal has realistic work to do.
+        static const char* common[] = { "the", "of", "and", "to", "a", "in", "is", "it", "that", "for",
+            "was", "on", "with", "as", "he", "be", "at", "by", "this", "had", "not", "are", "but", "from" };
+        for (const char* word : common) {
+            if (words.size() < vocabularySize) words.push_back(word);
+        }
+        for (uint64_t i = 0; words.size() < vocabularySize; ++i) words.push_back(syntheticWord(i));
+
+        cdf.resize(words.size());
+        double total = 0.0;
+        for (size_t rank = 0; rank < words.size(); ++rank) {
+            total += 1.0 / std::pow(static_cast<double>(rank + 1), exponent);
+            cdf[rank] = total;
+        }
+        for (double& value : cdf) value /= total;
+    }
+
+    const std::vector<std::string>& vocabulary() const { return words; }
+
+    const std::string& word() {
+        double u = std::uniform_real_distribution<double>(0.0, 1.0)(gen);
+        size_t rank = std::lower_bound(cdf.begin(), cdf.end(), u) - cdf.begin();
+        return words[std::min(rank, words.size() - 1)];
+    }
+
+    std::vector<std::string> tokens(size_t count) {
+        std::vector<std::string> result;
+        result.reserve(count);
+        for (size_t i = 0; i < count; ++i) result.push_back(word());
+        return result;
+    }
+
+    std::string text(size_t numWords) {
+        // Sentences of 5-24 words with a capital first letter, commas and a closing period.
+        std::string result;
+        size_t sentenceLeft = 0;
+        for (size_t i = 0; i < numWords; ++i) {
+            bool first = sentenceLeft == 0;
+            if (first) sentenceLeft = 5 + gen() % 20;
+            if (!result.empty()) result += ' ';
+            size_t start = result.size();
+            result += word();
+            if (first) result[start] = static_cast<char>(result[start] - 'a' + 'A');
+            if (--sentenceLeft == 0) {
+                result += '.';
+            }
+            else if (gen() % 12 == 0) {
+                result += ',';
+            }
+        }
+        return result;
+    }
+
+    std::vector<std::vector<std::string>> sentences(size_t count, size_t length) {
+        std::vector<std::vector<std::string>> result;
+        result.reserve(count);
+        for (size_t i = 0; i < count; ++i) result.push_back(tokens(length));
+        return result;
+    }
+};
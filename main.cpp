@@ -1,205 +1,871 @@
-﻿#include <iostream>
+﻿// Concurrency stress test. Worker threads call every Toolkit and Tokenizer operation at the same
+// time, many times over, on large randomized inputs and on batches smaller than the thread count,
+// and compare each result with a reference computed serially before the run. A writer thread keeps adding tokens to the shared Tokenizer
+// meanwhile. Build with -DNLP_SANITIZER=thread or =address to let a sanitizer watch the run.
+//
+// Usage: NLP_Toolkit [--threads=N] [--seconds=S] [--words=K] [--cases=C] [--seed=X]
+// Exits with status 1 when any result differs from its reference.
+#include <iostream>
 #include <vector>
 #include <unordered_map>
 #include <string>
 #include <sstream>
 #include <algorithm>
-#define NOMINMAX
-#include <windows.h> 
+#include <atomic>
+#include <chrono>
+#include <cctype>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <random>
+#include <streambuf>
+#include <cstring>
+#include <stdexcept>
+#include <thread>
 #include "Toolkit.h"
-#include "Tokenizer.h" 
+#include "Tokenizer.h"
+#include "ShardEncoder.h"
+#include "Chunker.h"
+#include "DocumentStream.h"
+#include "SymbolTable.h"
 
-// Critical Section for print sync
-CRITICAL_SECTION coutLock;
+namespace fs = std::filesystem;
 
-std::vector<std::string> tokens = { "hello", "world", "hello", "my", "name", "is", "My", "what", "is", "your", "name" };
-std::vector<std::string> vocab = { "hello", "world", "<UNK>", "my", "name", "is", "<UNK>", "My" };
-Tokenizer tokenizer(vocab);
-std::string text = "Hello, @World! This is a test for NLP(Toolkit).";
+// Guards std::cout while worker threads run.
+std::mutex coutLock;
 
 void synchronizedPrint(const std::string& text) {
-    EnterCriticalSection(&coutLock);
+    std::lock_guard<std::mutex> lock(coutLock);
     std::cout << text << std::endl;
-    LeaveCriticalSection(&coutLock);
 }
 
-// Test Toolkit
-void testTokenize() {
-    std::vector<std::string> tokens = Toolkit::tokenize(text);
-    std::ostringstream oss;
-    oss << "Tokens: ";
-    for (const auto& token : tokens) oss << token << " | ";
-    oss << std::endl;
-    synchronizedPrint(oss.str());
+// The operations print "Skip write task" on every call without a log file; the run discards that.
+class NullBuffer : public std::streambuf {
+protected:
+    int overflow(int c) override { return c; }
+    std::streamsize xsputn(const char*, std::streamsize n) override { return n; }
+};
+
+// Random text over a fixed vocabulary: mostly known words with Zipf-like frequencies, plus unknown
+// words, capitalized words, attached punctuation, multi-byte UTF-8, special tokens and mixed whitespace.
+class RandomText {
+private:
+    const std::vector<std::string>& vocab;
+    std::mt19937_64 gen;
+
+    std::string letters(size_t length) {
+        std::string word;
+        while (word.size() < length) word += static_cast<char>('a' + gen() % 26);
+        return word;
+    }
+
+public:
+    RandomText(const std::vector<std::string>& vocab, uint64_t seed) : vocab(vocab), gen(seed) {}
+
+    std::string word() {
+        double u = std::uniform_real_distribution<double>(0.0, 1.0)(gen);
+        std::string known = vocab[static_cast<size_t>(u * u * u * vocab.size()) % vocab.size()];
+        switch (gen() % 20) {
+        case 0: return "zq" + letters(3 + gen() % 8);        // Never in the vocabulary (see makeVocabulary).
+        case 1: known[0] = static_cast<char>(std::toupper(static_cast<unsigned char>(known[0]))); return known;
+        case 2: return known + ",";
+        case 3: return known + ".";
+        case 4: return "(" + known + ")";
+        case 5: return gen() % 2 ? "caf\xC3\xA9" : "\xE6\x97\xA5\xE6\x9C\xAC";
+        case 6: return "[SEP]";
+        default: return known;
+        }
+    }
+
+    std::vector<std::string> words(size_t count) {
+        std::vector<std::string> result;
+        result.reserve(count);
+        for (size_t i = 0; i < count; ++i) result.push_back(word());
+        return result;
+    }
+
+    std::string text(size_t count) {
+        static const char* separators[] = { " ", " ", " ", " ", "  ", "\t", "\n", " \r\n" };
+        std::string result = gen() % 4 == 0 ? " " : "";
+        for (size_t i = 0; i < count; ++i) {
+            if (i > 0) result += separators[gen() % 8];
+            result += word();
+        }
+        return result;
+    }
+
+    size_t below(size_t n) { return static_cast<size_t>(gen() % n); }
+};
+
+std::vector<std::string> makeVocabulary(size_t size) {
+    // Lowercase words of 2-10 letters that never start with "zq", so RandomText's unknown words stay unknown.
+    std::mt19937_64 gen(7);
+    std::vector<std::string> vocab = { "<UNK>", "the", "of", "and", "to", "a", "in", "is", "it", "that" };
+    std::unordered_map<std::string, int> seen;
+    for (const auto& word : vocab) seen[word] = 0;
+    while (vocab.size() < size) {
+        std::string word;
+        size_t length = 2 + gen() % 9;
+        while (word.size() < length) word += static_cast<char>('a' + gen() % 26);
+        if (word.compare(0, 2, "zq") == 0 || !seen.emplace(word, 0).second) continue;
+        vocab.push_back(word);
+    }
+    return vocab;
 }
 
-void testBagOfWords() {
-    auto bag = Toolkit::getBagOfWords(tokens, 4);
-    std::ostringstream oss;
-    oss << "Bag of Words: ";
-    for (const auto& [word, count] : bag) {
-        oss << word << ": " << count << " ";
+std::vector<std::string> referenceSplit(const std::string& text) {
+    std::vector<std::string> tokens;
+    std::string current;
+    for (char c : text) {
+        if (std::isspace(static_cast<unsigned char>(c))) {
+            if (!current.empty()) tokens.push_back(std::move(current));
+            current.clear();
+        }
+        else {
+            current += c;
+        }
     }
-    oss << std::endl;
-    synchronizedPrint(oss.str());
+    if (!current.empty()) tokens.push_back(std::move(current));
+    return tokens;
 }
 
-void testNGrams() {
-    int n = 2;
-    auto ngrams = Toolkit::getNGrams(tokens, n);
-    std::ostringstream oss;
-    oss << n << "-grams: ";
-    for (const auto& ngram : ngrams) oss << "\"" << ngram << "\" ";
-    oss << std::endl;
-    synchronizedPrint(oss.str());
+template <class T>
+std::vector<std::vector<T>> rowsOf(const T* values, const std::vector<size_t>& offsets) {
+    std::vector<std::vector<T>> rows;
+    for (size_t i = 0; i + 1 < offsets.size(); ++i) rows.emplace_back(values + offsets[i], values + offsets[i + 1]);
+    return rows;
 }
 
-void testNormalization() {
-    std::string lower = Toolkit::toLower(text);
-    std::string noPunctuation = Toolkit::removePunctuation(text);
-    std::ostringstream oss;
-    oss << "Lowercase: " << lower << "\nWithout Punctuation: " << noPunctuation;
-    oss << std::endl;
-    synchronizedPrint(oss.str());
+std::vector<std::string> rowsOf(const StringBatch& batch) {
+    std::vector<std::string> rows;
+    for (size_t i = 0; i < batch.size(); ++i) rows.emplace_back(batch.at(i));
+    return rows;
 }
 
-void testEmbeddings() {
-    auto embeddings = Toolkit::getEmbeddings(tokens, 3);
-    std::ostringstream oss;
-    oss << "Embeddings (showing first 5 values):" << std::endl;
-    for (const auto& [token, vec] : embeddings) {
-        oss << token << ": ";
-        for (size_t i = 0; i < std::min(vec.size(), static_cast<size_t>(5)); ++i) {
-            oss << vec[i] << " ";
-        }
-        oss << "..." << std::endl;
+std::vector<std::vector<std::string>> rowsOf(const TokenizedBatch& batch) {
+    std::vector<std::vector<std::string>> rows;
+    for (size_t i = 0; i + 1 < batch.textOffsets.size(); ++i) {
+        rows.emplace_back();
+        for (size_t j = batch.textOffsets[i]; j < batch.textOffsets[i + 1]; ++j) rows.back().emplace_back(batch.tokens.at(j));
     }
-    synchronizedPrint(oss.str());
+    return rows;
 }
 
-void testStemming() {
-    std::string text = "swimming";
-    std::string stemmed = Toolkit::stem(text);
-    synchronizedPrint("Stemmed: " + stemmed + "\n");
+// Element-wise comparisons of the std::pmr results with their std counterparts.
+template <class Strings>
+bool sameStrings(const Strings& strings, const std::vector<std::string>& expected) {
+    return std::equal(strings.begin(), strings.end(), expected.begin(), expected.end(),
+        [](const auto& a, const std::string& b) { return std::string_view(a) == b; });
 }
 
-void testRemoveSpecialCharacters() {
-    std::string specialCharsFile = "TXTconfig/special_characters.txt"; 
+template <class Rows>
+bool sameRows(const Rows& rows, const std::vector<std::vector<int>>& expected) {
+    return std::equal(rows.begin(), rows.end(), expected.begin(), expected.end(),
+        [](const auto& a, const std::vector<int>& b) { return std::equal(a.begin(), a.end(), b.begin(), b.end()); });
+}
 
-    std::string result = Toolkit::removeSpecialCharacters(text, specialCharsFile, 4);
-    std::ostringstream oss;
-    oss << "Original Text: " << text << "\n";
-    oss << "After Removing Special Characters: " << result << "\n";
-    synchronizedPrint(oss.str());
+template <class Counts>
+bool sameCounts(const Counts& counts, const std::unordered_map<std::string, int>& expected) {
+    return counts.size() == expected.size() && std::all_of(counts.begin(), counts.end(), [&](const auto& entry) {
+        auto it = expected.find(std::string(entry.first));
+        return it != expected.end() && it->second == entry.second;
+        });
 }
 
-void testRemoveStopWords() {
-    std::string stopWordsFile = "TXTconfig/stop_words.txt";
-    std::string result = Toolkit::removeStopWords(text, stopWordsFile, 2);
-    std::ostringstream oss;
-    oss << "Original Text: " << text << "\n";
-    oss << "After Removing Stop Words: " << result << "\n";
-    synchronizedPrint(oss.str());
+bool sameChunks(const ChunkedDocument& a, const ChunkedDocument& b) {
+    return a.ids == b.ids && std::equal(a.chunks.begin(), a.chunks.end(), b.chunks.begin(), b.chunks.end(), [](const Chunk& x, const Chunk& y) {
+        return x.tokenBegin == y.tokenBegin && x.tokenEnd == y.tokenEnd && x.charBegin == y.charBegin && x.charEnd == y.charEnd;
+        });
 }
 
+bool sameChunks(const std::vector<ChunkedDocument>& a, const std::vector<ChunkedDocument>& b) {
+    return std::equal(a.begin(), a.end(), b.begin(), b.end(), [](const ChunkedDocument& x, const ChunkedDocument& y) { return sameChunks(x, y); });
+}
+
+// One randomized input and the serial results every operation must reproduce on it.
+struct Case {
+    std::string text;
+    std::vector<std::string> tokens;
+    std::vector<std::string> stemWords;
+    std::vector<std::string> texts;
+    std::vector<std::string_view> views;
+    std::vector<std::vector<std::string>> sentences;
+    std::vector<std::vector<int>> encoded;
+
+    std::vector<std::string> tokenized, ngrams, stemmed, decodedText;
+    std::vector<std::vector<std::string>> batchTokenized, decodedSentences;
+    std::vector<std::string> normalized, withoutStopWordsBatch;
+    std::string lower, noPunctuation, noSpecialCharacters, noStopWords, decodedString;
+    std::unordered_map<std::string, int> bagOfWords;
+    std::vector<std::string> distinctTokens;
+    size_t wordCount = 0, idCount = 0;
+    std::vector<size_t> wordCounts, idCounts;
+    std::vector<int> ids, textIds;
+    std::vector<std::vector<int>> sentenceIds, textsIds;
+
+    std::pmr::vector<std::pmr::string> pmrTokens;   // `tokens` again, for the arena overloads.
+    std::vector<uint32_t> symbols, symbolNGrams;
+    std::unordered_map<uint32_t, int> bagOfSymbols;
+    std::vector<int> symbolIds;
+    ChunkedDocument chunkedText, overlapChunkedText;
+    std::vector<ChunkedDocument> chunkedTexts;
+};
+
+struct Fixture {
+    std::vector<std::string> vocab;
+    Tokenizer tokenizer;
+    Chunker chunker;
+    Chunker overlapChunker;                         // Overlap close to maxTokens, so a sentence cut may not stall the window.
+    std::unordered_map<std::string, int> idOf;      // Independent reference for the encoders.
+    std::string stopWordsFile, specialCharFile;
+    std::vector<Case> cases;
+
+    Fixture(std::vector<std::string> vocabulary, const fs::path& configDir)
+        : vocab(std::move(vocabulary)), tokenizer(vocab, { "[SEP]" }),
+        chunker(tokenizer, ChunkerOptions{ 64, 16, true }), overlapChunker(tokenizer, ChunkerOptions{ 10, 8, true }) {
+        for (size_t i = 0; i < vocab.size(); ++i) idOf.emplace(vocab[i], static_cast<int>(i));
+        idOf["[SEP]"] = tokenizer.tokenId("[SEP]");
+
+        stopWordsFile = (configDir / "stop_words.txt").string();
+        specialCharFile = (configDir / "special_characters.txt").string();
+        std::ofstream(stopWordsFile) << "the\nof\nand\nto\na\nin\nis\nit\nthat\n";
+        std::ofstream(specialCharFile) << ",\n.\n(\n)\n!\n?\n";
+    }
+
+    int referenceId(const std::string& token) const {
+        auto it = idOf.find(token);
+        return it != idOf.end() ? it->second : idOf.at("<UNK>");
+    }
+};
 
-// Test Tokenizer
-void testTokenizerEncode() {
-    std::vector<std::string> sentence = { "hello", "unknown", "world", "is", "name" };
+void check(bool ok, const std::string& what, std::vector<std::string>& problems) {
+    if (!ok && std::find(problems.begin(), problems.end(), what) == problems.end()) problems.push_back(what);
+}
 
-    auto encoded = tokenizer.encode(sentence);
-    std::ostringstream oss;
-    oss << "Tokenizer Encode: ";
-    for (auto id : encoded) {
-        oss << id << " ";
+void checkChunks(const Chunker& chunker, const ChunkerOptions& options, const std::string& text, const std::vector<int>& ids,
+    const ChunkedDocument& document, std::vector<std::string>& problems) {
+    // The chunks must cover the encodeText IDs in order, each at most maxTokens long, overlapping the
+    // previous one by overlapTokens and moving the window forward by more than half the fresh tokens.
+    check(document.ids == ids, "chunk IDs differ from encodeText", problems);
+    check(document.ids.empty() ? document.chunks.empty() : !document.chunks.empty() && document.chunks.back().tokenEnd == document.ids.size(),
+        "chunks do not reach the end of the document", problems);
+    size_t fresh = options.maxTokens - options.overlapTokens;
+    for (size_t i = 0; i < document.chunks.size(); ++i) {
+        const Chunk& chunk = document.chunks[i];
+        bool bounded = chunk.tokenBegin < chunk.tokenEnd && chunk.tokenEnd <= document.ids.size()
+            && chunk.tokenEnd - chunk.tokenBegin <= options.maxTokens && chunk.charBegin < chunk.charEnd && chunk.charEnd <= text.size();
+        check(bounded, "a chunk is empty, longer than maxTokens or out of range", problems);
+        if (!bounded) return;
+
+        // The chunk's own text encodes to exactly its IDs.
+        std::vector<int> own(document.ids.begin() + chunk.tokenBegin, document.ids.begin() + chunk.tokenEnd);
+        check(chunker.chunk(text.substr(chunk.charBegin, chunk.charEnd - chunk.charBegin), "").ids == own, "a chunk's text does not encode to its IDs", problems);
+        if (i == 0) {
+            check(chunk.tokenBegin == 0, "the first chunk does not start at token 0", problems);
+        }
+        else {
+            const Chunk& previous = document.chunks[i - 1];
+            check(chunk.tokenBegin + options.overlapTokens == previous.tokenEnd, "chunks do not overlap by overlapTokens", problems);
+            check(chunk.tokenEnd > previous.tokenEnd + fresh / 2 || chunk.tokenEnd == document.ids.size(),
+                "a chunk adds no more than half of maxTokens - overlapTokens new tokens", problems);
+        }
     }
-    oss << std::endl;
-    synchronizedPrint(oss.str());
 }
 
-void testTokenizerDecode() {
-    std::vector<int> encoded = { 0, 2, 1, 5, 7, 3, 4 }; 
+Case makeCase(const Fixture& fixture, RandomText& random, size_t numWords, size_t numTexts, std::vector<std::string>& problems) {
+    /*
+    Input:
+        - numWords: Words in the case's text and token list.
+        - numTexts: Texts and sentences in the batch inputs, or SIZE_MAX for about numWords words of them.
+        - problems: Receives a line for every serial result that disagrees with its independent reference.
+    Output:
+        - A case whose expected results come from calling each operation alone with one thread.
+    */
+
+    Case c;
+    c.text = random.text(numWords);
+    c.tokens = random.words(numWords);
+    c.stemWords = random.words(std::min<size_t>(numWords, 256));
+    for (size_t words = 0; numTexts == SIZE_MAX ? words < numWords : c.texts.size() < numTexts; ) {
+        size_t length = random.below(64);       // Includes empty texts and sentences.
+        c.texts.push_back(random.text(length));
+        c.sentences.push_back(random.words(length));
+        words += length + 1;
+    }
+    c.views.assign(c.texts.begin(), c.texts.end());
+
+    const Tokenizer& tokenizer = fixture.tokenizer;
+    c.tokenized = Toolkit::tokenize(c.text, "");
+    c.batchTokenized = rowsOf(Toolkit::batchTokenize(c.views, 1, ""));
+    c.normalized = rowsOf(Toolkit::batchNormalize(c.views, true, true, 1, ""));
+    c.lower = Toolkit::toLower(c.text, "");
+    c.noPunctuation = Toolkit::removePunctuation(c.text, "");
+    c.ngrams = Toolkit::getNGrams(c.tokens, 3, "");
+    for (const auto& word : c.stemWords) c.stemmed.push_back(Toolkit::stem(word, ""));
+    c.bagOfWords = Toolkit::getBagOfWords(c.tokens, 1, "");
+    c.distinctTokens = Toolkit::getEmbeddingMatrix(c.tokens, 1, 1, "").tokens;
+    c.noSpecialCharacters = Toolkit::removeSpecialCharacters(c.text, fixture.specialCharFile, 1, "");
+    c.noStopWords = Toolkit::removeStopWords(c.text, fixture.stopWordsFile, 1, "");
+    c.withoutStopWordsBatch = rowsOf(Toolkit::batchRemoveStopWords(Toolkit::batchTokenize(c.views, 1, ""), fixture.stopWordsFile, 1, ""));
+    c.wordCount = Toolkit::countTokens(c.text, "");
+    c.wordCounts = Toolkit::batchCountTokens(c.texts, 1, "");
+
+    c.ids = tokenizer.encode(c.tokens, "");
+    c.sentenceIds = tokenizer.batchEncode(c.sentences, 1, "");
+    c.encoded = c.sentenceIds;
+    c.decodedText = tokenizer.decode(c.ids, "");
+    c.decodedSentences = tokenizer.batchDecode(c.encoded, 1, "");
+    c.decodedString = tokenizer.decodeToString(c.ids, DetokenizeOptions(), "");
+    c.textIds = tokenizer.encodeText(c.text, "");
+    c.textsIds = tokenizer.batchEncodeText(c.texts, 1, "");
+    c.idCount = tokenizer.countTokens(c.text, "");
+    c.idCounts = tokenizer.batchCountTokens(c.texts, 1, "");
+
+    for (const auto& token : c.tokens) c.pmrTokens.emplace_back(token);
+    c.symbols = Toolkit::tokenizeToSymbols(c.text, "");
+    c.bagOfSymbols = Toolkit::getBagOfSymbols(c.symbols, 1, "");
+    c.symbolNGrams = Toolkit::getSymbolNGrams(c.symbols, 3, "");
+    c.symbolIds = tokenizer.encodeSymbols(c.symbols, "");
+    c.chunkedText = fixture.chunker.chunk(c.text, "");
+    c.overlapChunkedText = fixture.overlapChunker.chunk(c.text, "");
+    c.chunkedTexts = fixture.chunker.batchChunk(c.texts, 1, "");
+
+    // The serial results themselves, against references that do not go through the library.
+    std::vector<std::string> split = referenceSplit(c.text);
+    check(c.tokenized == split, "tokenize differs from a whitespace split", problems);
+    for (size_t i = 0; i < c.texts.size(); ++i) {
+        check(c.batchTokenized[i] == referenceSplit(c.texts[i]), "batchTokenize differs from a whitespace split", problems);
+    }
+    check(c.wordCount == split.size(), "countTokens differs from the number of words", problems);
+
+    std::string lower = c.text;
+    for (char& ch : lower) ch = static_cast<char>(std::tolower(static_cast<unsigned char>(ch)));
+    check(c.lower == lower, "toLower differs from std::tolower", problems);
 
-    auto decoded = tokenizer.decode(encoded);
-    std::ostringstream oss;
-    oss << "Tokenizer Decode: ";
-    for (const auto& token : decoded) {
-        oss << token << " ";
+    std::unordered_map<std::string, int> bag;
+    for (const auto& token : c.tokens) ++bag[token];
+    check(c.bagOfWords == bag, "getBagOfWords differs from a serial count", problems);
+    check(c.ngrams.size() == (c.tokens.size() >= 3 ? c.tokens.size() - 2 : 0)
+        && (c.ngrams.empty() || c.ngrams[0] == c.tokens[0] + " " + c.tokens[1] + " " + c.tokens[2]), "getNGrams differs from joined triples", problems);
+
+    std::vector<int> ids;
+    for (const auto& token : c.tokens) ids.push_back(fixture.referenceId(token));
+    check(c.ids == ids, "encode differs from a map lookup", problems);
+    std::vector<int> textIds;
+    for (const auto& token : split) textIds.push_back(fixture.referenceId(token));
+    check(c.textIds == textIds, "encodeText differs from a map lookup of the split text", problems);
+    check(c.idCount == c.textIds.size(), "countTokens differs from encodeText", problems);
+    for (size_t i = 0; i < c.sentences.size(); ++i) {
+        check(c.sentenceIds[i] == tokenizer.encode(c.sentences[i], ""), "batchEncode differs from encode", problems);
+    }
+    for (size_t i = 0; i < c.ids.size(); ++i) {
+        const std::string& token = c.ids[i] == fixture.idOf.at("[SEP]") ? std::string("[SEP]") : fixture.vocab[c.ids[i]];
+        check(c.decodedText[i] == token, "decode does not return the vocabulary entry", problems);
     }
-    oss << std::endl;
-    synchronizedPrint(oss.str());
+
+    // The arena overloads against the std ones.
+    std::pmr::monotonic_buffer_resource arena;
+    check(sameStrings(Toolkit::tokenize(c.text, &arena, ""), c.tokenized), "tokenize into an arena differs from tokenize", problems);
+    check(sameCounts(Toolkit::getBagOfWords(c.pmrTokens, 1, &arena, ""), c.bagOfWords), "getBagOfWords into an arena differs from getBagOfWords", problems);
+    check(sameStrings(Toolkit::getNGrams(c.pmrTokens, 3, &arena, ""), c.ngrams), "getNGrams into an arena differs from getNGrams", problems);
+    check(sameRows(tokenizer.batchEncode(c.sentences, 1, &arena, ""), c.sentenceIds), "batchEncode into an arena differs from batchEncode", problems);
+
+    // The symbol operations, mapped back to text, against the string ones.
+    const SymbolTable& table = SymbolTable::global();
+    std::vector<std::string> symbolTexts;
+    for (uint32_t symbol : c.symbols) symbolTexts.emplace_back(table.str(symbol));
+    check(symbolTexts == c.tokenized, "tokenizeToSymbols does not map back to tokenize", problems);
+    std::unordered_map<std::string, int> symbolBag;
+    for (const auto& [symbol, count] : c.bagOfSymbols) symbolBag.emplace(table.str(symbol), count);
+    check(symbolBag == Toolkit::getBagOfWords(c.tokenized, 1, ""), "getBagOfSymbols does not map back to getBagOfWords", problems);
+    std::vector<std::string> ngramTexts;
+    for (uint32_t symbol : c.symbolNGrams) ngramTexts.emplace_back(table.str(symbol));
+    check(ngramTexts == Toolkit::getNGrams(c.tokenized, 3, ""), "getSymbolNGrams does not map back to getNGrams", problems);
+    check(c.symbolIds == c.textIds, "encodeSymbols differs from encodeText", problems);
+
+    checkChunks(fixture.chunker, ChunkerOptions{ 64, 16, true }, c.text, c.textIds, c.chunkedText, problems);
+    checkChunks(fixture.overlapChunker, ChunkerOptions{ 10, 8, true }, c.text, c.textIds, c.overlapChunkedText, problems);
+    check(c.chunkedTexts.size() == c.texts.size(), "batchChunk returns a different number of documents", problems);
+    for (size_t i = 0; i < c.chunkedTexts.size() && i < c.texts.size(); ++i) {
+        checkChunks(fixture.chunker, ChunkerOptions{ 64, 16, true }, c.texts[i], c.textsIds[i], c.chunkedTexts[i], problems);
+    }
+    return c;
 }
 
-void testTokenizerBatchEncode() {
-    std::vector<std::vector<std::string>> sentences = {
-        {"hello", "world", "test"},
-        {"unknown", "hello", "name", "My"}
+void checkImages(const Fixture& fixture, std::vector<std::string>& problems) {
+    // A deserialized copy, with or without its hash table, and both sides of a shared-memory segment
+    // must answer every lookup the way the original Tokenizer does.
+    const Tokenizer& original = fixture.tokenizer;
+    auto sameLookups = [&](const Tokenizer& copy, const std::string& what) {
+        bool ok = copy.vocabSize() == original.vocabSize() && copy.getSpecialTokens() == original.getSpecialTokens();
+        for (const auto& word : fixture.vocab) ok = ok && copy.tokenId(word) == fixture.idOf.at(word);
+        for (const Case& c : fixture.cases) {
+            ok = ok && copy.encodeText(c.text, "") == c.textIds && copy.batchEncodeText(c.texts, 1, "") == c.textsIds
+                && copy.decode(c.ids, "") == c.decodedText;
+        }
+        check(ok, what + " answers lookups differently from the original", problems);
     };
 
-    auto batchEncoded = tokenizer.batchEncode(sentences, 5);
-    std::ostringstream oss;
-    oss << "Tokenizer Batch Encode:" << std::endl;
-    for (const auto& encoded : batchEncoded) {
-        for (auto id : encoded) {
-            oss << id << " ";
+    for (bool withTable : { false, true }) {
+        std::string image = original.serialize(withTable);
+        std::unique_ptr<Tokenizer> copy = Tokenizer::deserialize(image);
+        sameLookups(*copy, withTable ? "A Tokenizer deserialized with its table" : "A deserialized Tokenizer");
+        check(copy->serialize(withTable) == image, "serialize(deserialize(image)) differs from the image", problems);
+    }
+
+#if !defined(_WIN32)
+    std::string name = "/nlp_toolkit_stress_" + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count());
+    try {
+        std::unique_ptr<Tokenizer> shared = Tokenizer::deserialize(original.serialize());
+        shared->shareMemory(name);
+        std::unique_ptr<Tokenizer> attached = Tokenizer::attachSharedMemory(name);
+        // The mappings stay valid after the name is gone.
+        Tokenizer::unlinkSharedMemory(name);
+        sameLookups(*shared, "A Tokenizer moved into shared memory");
+        sameLookups(*attached, "A Tokenizer attached to shared memory");
+    }
+    catch (const std::exception& e) {
+        Tokenizer::unlinkSharedMemory(name);
+        check(false, std::string("shareMemory / attachSharedMemory threw: ") + e.what(), problems);
+    }
+#endif
+}
+
+void checkDocumentStream(const Fixture& fixture, const Case& c, const fs::path& workDir, std::vector<std::string>& problems) {
+    // Streams the case's texts from a file, one per line, in small batches so they finish out of
+    // order; the batches must come back as batchTokenize and batchEncodeText return them.
+    fs::path input = workDir / "stream.txt";
+    std::vector<std::vector<std::string>> expectedTokens;
+    std::vector<std::vector<int>> expectedIds;
+    {
+        std::ofstream out(input, std::ios::binary);
+        for (size_t i = 0; i < c.texts.size(); ++i) {
+            std::string line = c.texts[i];
+            std::replace(line.begin(), line.end(), '\n', ' ');
+            std::replace(line.begin(), line.end(), '\r', ' ');
+            out << line << "\n";
+            // Blank lines are not documents.
+            if (c.batchTokenized[i].empty()) continue;
+            expectedTokens.push_back(c.batchTokenized[i]);
+            expectedIds.push_back(c.textsIds[i]);
+        }
+    }
+
+    DocumentStreamOptions options;
+    options.batchDocuments = 7;
+    options.prefetchBatches = 2;
+    options.numThreads = 2;
+    std::vector<std::vector<std::string>> tokens;
+    std::vector<std::vector<int>> ids;
+    DocumentBatch batch;
+    {
+        DocumentStream stream({ input.string() }, options);
+        while (stream.next(batch)) {
+            for (auto& row : rowsOf(batch.tokens)) tokens.push_back(std::move(row));
+        }
+    }
+    {
+        DocumentStream stream({ input.string() }, fixture.tokenizer, options);
+        while (stream.next(batch)) {
+            for (auto& row : rowsOf(batch.encoded.ids.data(), batch.encoded.offsets)) ids.push_back(std::move(row));
         }
-        oss << std::endl;
     }
-    synchronizedPrint(oss.str());
+    check(tokens == expectedTokens, "DocumentStream tokens differ from batchTokenize", problems);
+    check(ids == expectedIds, "DocumentStream IDs differ from batchEncodeText", problems);
 }
 
-void testTokenizerBatchDecode() {
-    std::vector<std::vector<int>> encodedSentences = {
-        {0, 1, 2, 4, 3},
-        {2, 0, 6, 5}
-    };
+void checkCorruptImages(std::vector<std::string>& problems) {
+    // A vocabulary image whose slot points at no token must throw instead of being read out of bounds.
+    std::string image;
+    Vocabulary({ "alpha", "beta", "gamma" }).serialize(image, true);
+    size_t numSlots;
+    std::memcpy(&numSlots, image.data() + 2 * sizeof(uint64_t), sizeof(numSlots));
+    for (uint32_t idPlusOne : { 0u, 4u }) {
+        std::string corrupt = image;
+        for (size_t i = 0; i < numSlots; ++i) {
+            uint64_t slot;
+            char* at = &corrupt[(3 + i) * sizeof(uint64_t)];
+            std::memcpy(&slot, at, sizeof(slot));
+            if (slot == 0) continue;
+            slot = (slot & ~uint64_t(UINT32_MAX)) | idPlusOne;
+            std::memcpy(at, &slot, sizeof(slot));
+            break;
+        }
 
-    auto batchDecoded = tokenizer.batchDecode(encodedSentences, 3); 
-    std::ostringstream oss;
-    oss << "Tokenizer Batch Decode:" << std::endl;
-    for (const auto& decoded : batchDecoded) {
-        for (const auto& token : decoded) {
-            oss << token << " ";
+        std::vector<uint64_t> aligned((corrupt.size() + 7) / 8);
+        std::memcpy(aligned.data(), corrupt.data(), corrupt.size());
+        std::string_view data(reinterpret_cast<const char*>(aligned.data()), corrupt.size());
+        bool deserializeThrew = false, viewThrew = false;
+        try {
+            size_t pos = 0;
+            Vocabulary::deserialize(data, pos);
+        }
+        catch (const std::runtime_error&) {
+            deserializeThrew = true;
         }
-        oss << std::endl;
+        try {
+            size_t pos = 0;
+            Vocabulary::view(data, pos, std::make_shared<int>(0));
+        }
+        catch (const std::runtime_error&) {
+            viewThrew = true;
+        }
+        check(deserializeThrew && viewThrew, "a corrupt vocabulary image (slot id + 1 = " + std::to_string(idPlusOne) + ") is accepted", problems);
+    }
+}
+
+void checkShardIdWidth(const fs::path& workDir, std::vector<std::string>& problems) {
+    // IDs that outgrow uint16 shards after the encoder was built must fail the run instead of losing their high bytes.
+    fs::path input = workDir / "uint16.txt";
+    std::ofstream(input) << "grown words\n";
+    Tokenizer tokenizer({ "<UNK>" });
+    ShardEncoderOptions options;
+    options.tokenBytes = 2;
+    options.reportSeconds = 0;
+    ShardEncoder encoder(tokenizer, options);
+
+    std::vector<std::string> filler;
+    for (int i = 0; i < 65536; ++i) filler.push_back("filler_" + std::to_string(i));
+    tokenizer.addTokens(filler);
+    tokenizer.addTokens({ "grown" });
+    bool threw = false;
+    try {
+        encoder.encode({ input.string() }, (workDir / "shards_uint16").string());
+    }
+    catch (const std::runtime_error&) {
+        threw = true;
     }
-    synchronizedPrint(oss.str());
+    check(threw, "ShardEncoder writes IDs above 65535 into uint16 shards", problems);
 }
 
-// Multi-thread testing
-void testAllInParallel() {
-    HANDLE processes[12];
+std::map<std::string, std::string> filesOf(const fs::path& dir) {
+    std::map<std::string, std::string> files;
+    for (const auto& entry : fs::directory_iterator(dir)) {
+        std::ifstream in(entry.path(), std::ios::binary);
+        files[entry.path().filename().string()].assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+    return files;
+}
 
-    // Create threads for each test function
-    processes[0] = CreateThread(nullptr, 0, [](LPVOID) -> DWORD { testTokenize(); return 0; }, nullptr, 0, nullptr);
-    processes[1] = CreateThread(nullptr, 0, [](LPVOID) -> DWORD { testBagOfWords(); return 0; }, nullptr, 0, nullptr);
-    processes[2] = CreateThread(nullptr, 0, [](LPVOID) -> DWORD { testNGrams(); return 0; }, nullptr, 0, nullptr);
-    processes[3] = CreateThread(nullptr, 0, [](LPVOID) -> DWORD { testNormalization(); return 0; }, nullptr, 0, nullptr);
-    processes[4] = CreateThread(nullptr, 0, [](LPVOID) -> DWORD { testEmbeddings(); return 0; }, nullptr, 0, nullptr);
-    processes[5] = CreateThread(nullptr, 0, [](LPVOID) -> DWORD { testStemming(); return 0; }, nullptr, 0, nullptr);
-    processes[6] = CreateThread(nullptr, 0, [](LPVOID) -> DWORD { testRemoveSpecialCharacters(); return 0; }, nullptr, 0, nullptr);
-    processes[7] = CreateThread(nullptr, 0, [](LPVOID) -> DWORD { testRemoveStopWords(); return 0; }, nullptr, 0, nullptr);
-    processes[8] = CreateThread(nullptr, 0, [](LPVOID) -> DWORD { testTokenizerEncode(); return 0; }, nullptr, 0, nullptr);
-    processes[9] = CreateThread(nullptr, 0, [](LPVOID) -> DWORD { testTokenizerDecode(); return 0; }, nullptr, 0, nullptr);
-    processes[10] = CreateThread(nullptr, 0, [](LPVOID) -> DWORD { testTokenizerBatchEncode(); return 0; }, nullptr, 0, nullptr);
-    processes[11] = CreateThread(nullptr, 0, [](LPVOID) -> DWORD { testTokenizerBatchDecode(); return 0; }, nullptr, 0, nullptr);
+void checkShardResume(const Fixture& fixture, RandomText& random, const fs::path& workDir, std::vector<std::string>& problems) {
+    /*
+    Functionality:
+        - Encodes a corpus once uninterrupted and once interrupted (an input file is missing, so the run
+          throws after checkpointing part of the output) and resumed, with junk appended past the
+          checkpoint as a crash mid-write would leave. Both output directories must be byte-identical.
+        - Resuming with different options must throw instead of mixing two layouts.
+    */
 
-    // Wait for all threads to complete
-    WaitForMultipleObjects(12, processes, TRUE, INFINITE);
+    std::vector<std::string> inputs;
+    for (int f = 0; f < 3; ++f) {
+        inputs.push_back((workDir / ("corpus_" + std::to_string(f) + ".txt")).string());
+        std::ofstream out(inputs.back(), std::ios::binary);
+        for (int line = 0; line < 400; ++line) out << random.text(random.below(40)) << "\n";
+    }
+    ShardEncoderOptions options;
+    options.tokenBytes = 2;
+    options.shardTokens = 997;
+    options.batchDocuments = 16;
+    options.queueCapacity = 2;
+    options.reportSeconds = 0;
+    fs::path whole = workDir / "shards_whole", resumed = workDir / "shards_resumed";
+    fs::remove_all(whole);
+    fs::remove_all(resumed);
+    ShardEncoder(fixture.tokenizer, options).encode(inputs, whole.string());
 
-    for (auto process : processes) {
-        CloseHandle(process);
+    fs::path hidden = inputs[1] + ".hidden";
+    fs::rename(inputs[1], hidden);
+    bool interrupted = false;
+    try {
+        ShardEncoder(fixture.tokenizer, options).encode(inputs, resumed.string());
+    }
+    catch (const std::runtime_error&) {
+        interrupted = true;
+    }
+    fs::rename(hidden, inputs[1]);
+    std::map<std::string, std::string> partial = filesOf(resumed);
+    check(interrupted && partial.count("progress.txt") && partial["progress.txt"].find("\ndocuments=0\n") == std::string::npos,
+        "ShardEncoder: the interrupted run left no checkpoint", problems);
+
+    std::string lastShard;
+    for (const auto& [name, bytes] : partial) {
+        if (name.compare(0, 6, "shard_") == 0) lastShard = name;
+    }
+    if (!lastShard.empty()) std::ofstream(resumed / lastShard, std::ios::binary | std::ios::app) << "junk";
+    std::ofstream(resumed / "index.bin", std::ios::binary | std::ios::app) << "junk past the checkpoint";
+
+    ShardEncoderOptions changed = options;
+    changed.shardTokens = options.shardTokens + 1;
+    bool mismatchThrew = false;
+    try {
+        ShardEncoder(fixture.tokenizer, changed).encode(inputs, resumed.string());
+    }
+    catch (const std::runtime_error&) {
+        mismatchThrew = true;
     }
+    check(mismatchThrew, "ShardEncoder resumes a checkpoint written with different options", problems);
+
+    ShardEncoder(fixture.tokenizer, options).encode(inputs, resumed.string());
+    check(filesOf(resumed) == filesOf(whole), "ShardEncoder: resumed shards differ from an uninterrupted run", problems);
 }
 
-int main() {
-    InitializeCriticalSection(&coutLock);
+struct OpStats {
+    std::string name;
+    std::function<bool(const Case&, int numThreads)> run;     // true when the result matches the case.
+    std::atomic<uint64_t> calls{ 0 };
+    std::atomic<uint64_t> failures{ 0 };
+};
+
+std::vector<std::unique_ptr<OpStats>> makeOperations(const Fixture& fixture) {
+    const Tokenizer& tokenizer = fixture.tokenizer;
+    std::vector<std::unique_ptr<OpStats>> ops;
+    auto add = [&ops](const std::string& name, std::function<bool(const Case&, int)> run) {
+        ops.emplace_back(new OpStats());
+        ops.back()->name = name;
+        ops.back()->run = std::move(run);
+    };
+
+    // Toolkit
+    add("tokenize", [](const Case& c, int) { return Toolkit::tokenize(c.text, "") == c.tokenized; });
+    add("batchTokenize", [](const Case& c, int n) { return rowsOf(Toolkit::batchTokenize(c.views, n, "")) == c.batchTokenized; });
+    add("batchNormalize", [](const Case& c, int n) { return rowsOf(Toolkit::batchNormalize(c.views, true, true, n, "")) == c.normalized; });
+    add("toLower", [](const Case& c, int) { return Toolkit::toLower(c.text, "") == c.lower; });
+    add("removePunctuation", [](const Case& c, int) { return Toolkit::removePunctuation(c.text, "") == c.noPunctuation; });
+    add("getNGrams", [](const Case& c, int) { return Toolkit::getNGrams(c.tokens, 3, "") == c.ngrams; });
+    add("stem", [](const Case& c, int) {
+        for (size_t i = 0; i < c.stemWords.size(); ++i) {
+            if (Toolkit::stem(c.stemWords[i], "") != c.stemmed[i]) return false;
+        }
+        return true;
+        });
+    add("getBagOfWords", [](const Case& c, int n) { return Toolkit::getBagOfWords(c.tokens, n, "") == c.bagOfWords; });
+    add("getEmbeddings", [](const Case& c, int n) {
+        // Values are random, so only the shape can be checked.
+        auto embeddings = Toolkit::getEmbeddings(c.tokens, 8, n, "");
+        if (embeddings.size() != c.distinctTokens.size()) return false;
+        for (const auto& token : c.distinctTokens) {
+            auto it = embeddings.find(token);
+            if (it == embeddings.end() || it->second.size() != 8) return false;
+        }
+        return true;
+        });
+    add("getEmbeddingMatrix", [](const Case& c, int n) {
+        auto matrix = Toolkit::getEmbeddingMatrix(c.tokens, 8, n, "");
+        return matrix.tokens == c.distinctTokens && matrix.values.size() == c.distinctTokens.size() * 8
+            && std::all_of(matrix.values.begin(), matrix.values.end(), [](float v) { return v >= -1.0f && v <= 1.0f; });
+        });
+    add("removeSpecialCharacters", [&fixture](const Case& c, int n) {
+        return Toolkit::removeSpecialCharacters(c.text, fixture.specialCharFile, n, "") == c.noSpecialCharacters;
+        });
+    add("removeStopWords", [&fixture](const Case& c, int n) { return Toolkit::removeStopWords(c.text, fixture.stopWordsFile, n, "") == c.noStopWords; });
+    add("batchRemoveStopWords", [&fixture](const Case& c, int n) {
+        return rowsOf(Toolkit::batchRemoveStopWords(Toolkit::batchTokenize(c.views, n, ""), fixture.stopWordsFile, n, "")) == c.withoutStopWordsBatch;
+        });
+    add("Toolkit::countTokens", [](const Case& c, int) { return Toolkit::countTokens(c.text, "") == c.wordCount; });
+    add("Toolkit::batchCountTokens", [](const Case& c, int n) { return Toolkit::batchCountTokens(c.texts, n, "") == c.wordCounts; });
+    add("tokenize (arena)", [](const Case& c, int) {
+        std::pmr::monotonic_buffer_resource arena;
+        return sameStrings(Toolkit::tokenize(c.text, &arena, ""), c.tokenized);
+        });
+    add("getBagOfWords (arena)", [](const Case& c, int n) {
+        std::pmr::monotonic_buffer_resource arena;
+        return sameCounts(Toolkit::getBagOfWords(c.pmrTokens, n, &arena, ""), c.bagOfWords);
+        });
+    add("getNGrams (arena)", [](const Case& c, int) {
+        std::pmr::monotonic_buffer_resource arena;
+        return sameStrings(Toolkit::getNGrams(c.pmrTokens, 3, &arena, ""), c.ngrams);
+        });
+    add("tokenizeToSymbols", [](const Case& c, int) { return Toolkit::tokenizeToSymbols(c.text, "") == c.symbols; });
+    add("getBagOfSymbols", [](const Case& c, int n) { return Toolkit::getBagOfSymbols(c.symbols, n, "") == c.bagOfSymbols; });
+    add("getSymbolNGrams", [](const Case& c, int) { return Toolkit::getSymbolNGrams(c.symbols, 3, "") == c.symbolNGrams; });
+
+    // Tokenizer
+    add("encode", [&tokenizer](const Case& c, int) { return tokenizer.encode(c.tokens, "") == c.ids; });
+    add("batchEncode", [&tokenizer](const Case& c, int n) { return tokenizer.batchEncode(c.sentences, n, "") == c.sentenceIds; });
+    add("batchEncode (arena)", [&tokenizer](const Case& c, int n) {
+        std::pmr::monotonic_buffer_resource arena;
+        return sameRows(tokenizer.batchEncode(c.sentences, n, &arena, ""), c.sentenceIds);
+        });
+    add("encodeSymbols", [&tokenizer](const Case& c, int) { return tokenizer.encodeSymbols(c.symbols, "") == c.symbolIds; });
+    add("batchEncodeToBuffer", [&tokenizer](const Case& c, int n) {
+        EncodedBuffer buffer = tokenizer.batchEncodeToBuffer(c.sentences, n, SIZE_MAX, "");
+        return rowsOf(buffer.ids.data(), buffer.offsets) == c.sentenceIds;
+        });
+    add("decode", [&tokenizer](const Case& c, int) { return tokenizer.decode(c.ids, "") == c.decodedText; });
+    add("batchDecode", [&tokenizer](const Case& c, int n) { return tokenizer.batchDecode(c.encoded, n, "") == c.decodedSentences; });
+    add("decodeToString", [&tokenizer](const Case& c, int) { return tokenizer.decodeToString(c.ids, DetokenizeOptions(), "") == c.decodedString; });
+    add("batchDecodeToBuffer", [&tokenizer](const Case& c, int n) {
+        DecodedBatch batch = tokenizer.batchDecodeToBuffer(c.encoded, n, DetokenizeOptions(), "");
+        std::vector<std::string> serial = tokenizer.batchDecodeToString(c.encoded, 1, DetokenizeOptions(), "");
+        if (batch.size() != serial.size()) return false;
+        for (size_t i = 0; i < serial.size(); ++i) {
+            if (batch.sentence(i) != serial[i]) return false;
+        }
+        return true;
+        });
+    add("encodeText", [&tokenizer](const Case& c, int) { return tokenizer.encodeText(c.text, "") == c.textIds; });
+    add("batchEncodeText", [&tokenizer](const Case& c, int n) { return tokenizer.batchEncodeText(c.texts, n, "") == c.textsIds; });
+    add("batchEncodeTextToBuffer", [&tokenizer](const Case& c, int n) {
+        EncodedBuffer buffer = tokenizer.batchEncodeTextToBuffer(c.views, n, SIZE_MAX, "");
+        return rowsOf(buffer.ids.data(), buffer.offsets) == c.textsIds;
+        });
+    add("batchEncodeTextPadded", [&tokenizer](const Case& c, int n) {
+        PaddedBatch padded = tokenizer.batchEncodeTextPadded(c.views, n, SIZE_MAX, -1, "");
+        if (padded.rows != c.textsIds.size()) return false;
+        for (size_t i = 0; i < padded.rows; ++i) {
+            const auto& expected = c.textsIds[i];
+            for (size_t j = 0; j < padded.columns; ++j) {
+                bool real = j < expected.size();
+                if (padded.attentionMask[i * padded.columns + j] != (real ? 1 : 0)) return false;
+                if (padded.ids[i * padded.columns + j] != (real ? expected[j] : -1)) return false;
+            }
+        }
+        return true;
+        });
+    add("Tokenizer::countTokens", [&tokenizer](const Case& c, int) { return tokenizer.countTokens(c.text, "") == c.idCount; });
+    add("Tokenizer::batchCountTokens", [&tokenizer](const Case& c, int n) { return tokenizer.batchCountTokens(c.texts, n, "") == c.idCounts; });
+    add("chunk", [&fixture](const Case& c, int) { return sameChunks(fixture.chunker.chunk(c.text, ""), c.chunkedText); });
+    add("batchChunk", [&fixture](const Case& c, int n) { return sameChunks(fixture.chunker.batchChunk(c.texts, n, ""), c.chunkedTexts); });
+    return ops;
+}
+
+int main(int argc, char** argv) {
+    int numWorkers = static_cast<int>(std::max(4u, std::thread::hardware_concurrency()));
+    double seconds = 10.0;
+    size_t numWords = 20000;
+    size_t numCases = 4;
+    uint64_t seed = 42;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg.rfind("--threads=", 0) == 0) numWorkers = std::atoi(arg.c_str() + 10);
+        else if (arg.rfind("--seconds=", 0) == 0) seconds = std::atof(arg.c_str() + 10);
+        else if (arg.rfind("--words=", 0) == 0) numWords = std::strtoull(arg.c_str() + 8, nullptr, 10);
+        else if (arg.rfind("--cases=", 0) == 0) numCases = std::strtoull(arg.c_str() + 8, nullptr, 10);
+        else if (arg.rfind("--seed=", 0) == 0) seed = std::strtoull(arg.c_str() + 7, nullptr, 10);
+        else {
+            std::cerr << "Usage: NLP_Toolkit [--threads=N] [--seconds=S] [--words=K] [--cases=C] [--seed=X]\n";
+            return 1;
+        }
+    }
+    if (numWorkers <= 0 || numCases == 0) {
+        std::cerr << "--threads and --cases must be positive.\n";
+        return 1;
+    }
+
+    fs::path configDir = fs::temp_directory_path() / "nlp_toolkit_stress";
+    fs::create_directories(configDir);
+    Fixture fixture(makeVocabulary(20000), configDir);
 
-    std::cout << "Testing Toolkit and Tokenizer with multi-threading:" << std::endl;
-    std::cout << std::string(30, '-') << std::endl;
-    testAllInParallel();
+    NullBuffer sink;
+    std::streambuf* console = std::cout.rdbuf(&sink);
+
+    std::vector<std::string> problems;
+    RandomText random(fixture.vocab, seed);
+    for (size_t i = 0; i < numCases; ++i) fixture.cases.push_back(makeCase(fixture, random, numWords, SIZE_MAX, problems));
+    // Batches of fewer items than threads, so the batch operations also run with empty blocks.
+    std::vector<size_t> tinySizes = { 0, 1, 2, 3, 5 };
+    if (std::find(tinySizes.begin(), tinySizes.end(), static_cast<size_t>(numWorkers - 1)) == tinySizes.end()) {
+        tinySizes.push_back(numWorkers - 1);
+    }
+    for (size_t size : tinySizes) fixture.cases.push_back(makeCase(fixture, random, size, size, problems));
+    checkImages(fixture, problems);
+    for (const Case& c : fixture.cases) checkDocumentStream(fixture, c, configDir, problems);
+    checkCorruptImages(problems);
+    checkShardIdWidth(configDir, problems);
+    checkShardResume(fixture, random, configDir, problems);
+    auto ops = makeOperations(fixture);
 
-    DeleteCriticalSection(&coutLock);
+    std::atomic<bool> stop{ false };
+    std::mutex failureMutex;
+    std::vector<std::string> failures;
 
+    // Workers pick an operation, a case and an inner thread count at random, so nested thread pools
+    // of every size compete with each other and with the writer.
+    std::vector<std::thread> workers;
+    for (int w = 0; w < numWorkers; ++w) {
+        workers.emplace_back([&, w]() {
+            std::mt19937_64 gen(seed * 1000003 + w);
+            while (!stop.load(std::memory_order_relaxed)) {
+                OpStats& op = *ops[gen() % ops.size()];
+                const Case& c = fixture.cases[gen() % fixture.cases.size()];
+                int innerThreads = 1 + static_cast<int>(gen() % 4);
+                bool ok = false;
+                std::string error;
+                try {
+                    ok = op.run(c, innerThreads);
+                }
+                catch (const std::exception& e) {
+                    error = e.what();
+                }
+                op.calls.fetch_add(1, std::memory_order_relaxed);
+                if (!ok) {
+                    op.failures.fetch_add(1, std::memory_order_relaxed);
+                    std::lock_guard<std::mutex> lock(failureMutex);
+                    if (failures.size() < 20) {
+                        failures.push_back(op.name + " with " + std::to_string(innerThreads) + " threads: "
+                            + (error.empty() ? "result differs from the serial reference" : "threw " + error));
+                    }
+                }
+            }
+            });
+    }
+
+    // The writer grows the vocabulary with tokens no input contains, so every expected result stays
+    // valid, and checks that each new token reads back with the ID it was given.
+    std::atomic<uint64_t> tokensAdded{ 0 };
+    std::thread writer([&]() {
+        for (uint64_t round = 0; !stop.load(std::memory_order_relaxed); ++round) {
+            std::vector<std::string> fresh;
+            for (int i = 0; i < 16; ++i) fresh.push_back("added_" + std::to_string(round) + "_" + std::to_string(i));
+            std::vector<int> ids = fixture.tokenizer.addTokens(fresh);
+            for (size_t i = 0; i < fresh.size(); ++i) {
+                if (fixture.tokenizer.tokenId(fresh[i]) != ids[i] || fixture.tokenizer.decode({ ids[i] }, "")[0] != fresh[i]) {
+                    std::lock_guard<std::mutex> lock(failureMutex);
+                    failures.push_back("addTokens: " + fresh[i] + " does not read back with ID " + std::to_string(ids[i]));
+                }
+            }
+            tokensAdded.fetch_add(fresh.size(), std::memory_order_relaxed);
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        }
+        });
+
+    auto begin = std::chrono::steady_clock::now();
+    std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+    stop.store(true);
+    for (auto& worker : workers) worker.join();
+    writer.join();
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+    std::cout.rdbuf(console);
+    fs::remove_all(configDir);
+
+    std::ostringstream report;
+    report << "Stress test: " << numWorkers << " worker threads, " << numCases << " cases of " << numWords << " words and " << fixture.cases.size() - numCases << " tiny batches, "
+        << std::fixed << std::setprecision(1) << elapsed << " s, " << tokensAdded.load() << " tokens added concurrently\n\n";
+    report << std::left << std::setw(30) << "operation" << std::right << std::setw(10) << "calls" << std::setw(10) << "failed" << std::setw(12) << "ops/s" << "\n";
+    uint64_t totalCalls = 0, totalFailures = 0;
+    for (const auto& op : ops) {
+        totalCalls += op->calls;
+        totalFailures += op->failures;
+        report << std::left << std::setw(30) << op->name << std::right << std::setw(10) << op->calls << std::setw(10) << op->failures
+            << std::setw(12) << std::setprecision(1) << op->calls / elapsed << "\n";
+    }
+    report << std::left << std::setw(30) << "total" << std::right << std::setw(10) << totalCalls << std::setw(10) << totalFailures
+        << std::setw(12) << std::setprecision(1) << totalCalls / elapsed << "\n";
+    synchronizedPrint(report.str());
+
+    for (const auto& problem : problems) synchronizedPrint("\033[31mSerial reference: " + problem + "\033[0m");
+    for (const auto& failure : failures) synchronizedPrint("\033[31m" + failure + "\033[0m");
+    if (!problems.empty() || !failures.empty() || totalCalls == 0) {
+        synchronizedPrint("\033[31mFAILED\033[0m");
+        return 1;
+    }
+    synchronizedPrint("\033[32mPASSED\033[0m");
     return 0;
 }
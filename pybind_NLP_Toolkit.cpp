@@ -1,52 +1,686 @@
-﻿//#include <pybind11/pybind11.h>
-//#include <pybind11/stl.h>
-//#include <pybind11/numpy.h>
-//#include <unordered_map>
-//#include <vector>
-//#include <string>
-//#include "Toolkit.h"
-//#include "Tokenizer.h"
-//
-//namespace py = pybind11;
-//
-//// Bind Toolkit methods
-//void bindToolkit(py::module_& m) {
-//    py::class_<Toolkit>(m, "Toolkit")
-//        .def_static("tokenize", &Toolkit::tokenize, py::arg("text"),
-//            "Tokenize a string into words")
-//        .def_static("toLower", &Toolkit::toLower, py::arg("text"),
-//            "Convert string to lowercase")
-//        .def_static("removePunctuation", &Toolkit::removePunctuation, py::arg("text"),
-//            "Remove punctuation from a string")
-//        .def_static("getBagOfWords", &Toolkit::getBagOfWords, py::arg("tokens"), py::arg("numThreads") = 2,
-//            "Generate bag of words from tokens")
-//        .def_static("getNGrams", &Toolkit::getNGrams, py::arg("tokens"), py::arg("n"),
-//            "Generate n-grams from tokens")
-//        .def_static("stem", &Toolkit::stem, py::arg("word"),
-//            "Stem a word")
-//        .def_static("getEmbeddings", &Toolkit::getEmbeddings, py::arg("tokens"), py::arg("embeddingSize") = 100, py::arg("numThreads") = 2,
-//            "Generate random embeddings for tokens");
-//}
-//
-//// Bind Tokenizer methods
-//void bindTokenizer(py::module_& m) {
-//    py::class_<Tokenizer>(m, "Tokenizer")
-//        .def(py::init<const std::vector<std::string>&>(), py::arg("vocab"),
-//            "Initialize a Tokenizer with a vocabulary")
-//        .def("encode", &Tokenizer::encode, py::arg("tokens"),
-//            "Encode a list of tokens into their corresponding IDs")
-//        .def("decode", &Tokenizer::decode, py::arg("ids"),
-//            "Decode a list of IDs into their corresponding tokens")
-//        .def("batchEncode", &Tokenizer::batchEncode, py::arg("sentences"), py::arg("numThreads") = 2,
-//            "Encode a batch of sentences using multiple threads")
-//        .def("batchDecode", &Tokenizer::batchDecode, py::arg("encodedSentences"), py::arg("numThreads") = 2,
-//            "Decode a batch of encoded sentences using multiple threads");
-//}
-//
-//// Pybind11 module definition
-//PYBIND11_MODULE(pybind_Toolkit, m) {
-//    m.doc() = "Pybind11 wrapper for Toolkit and Tokenizer";
-//
-//    bindToolkit(m);
-//    bindTokenizer(m);
-//}
+﻿#include <pybind11/pybind11.h>
+#include <pybind11/stl.h>
+#include <pybind11/numpy.h>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <optional>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include <string>
+#include "Toolkit.h"
+#include "Tokenizer.h"
+#include "Chunker.h"
+#include "ArrowInterop.h"
+#include "DLPackInterop.h"
+#include "DocumentStream.h"
+#include "Trace.h"
+#include "Metrics.h"
+#include "SymbolTable.h"
+
+namespace py = pybind11;
+
+// Native work runs without the GIL, so Python threads calling into the toolkit run concurrently.
+// Arguments are converted before the GIL is released and results after it is taken back.
+using releaseGil = py::call_guard<py::gil_scoped_release>;
+
+// Python callers usually don't want a log file per call, so bindings default logFile to "".
+
+// Hands a C++ vector to NumPy without copying: the array points into the vector's buffer and a
+// capsule owning the vector is the array's base, so the buffer lives as long as the array.
+template <class T>
+py::array_t<T> toArray(std::vector<T>&& values, std::vector<py::ssize_t> shape) {
+    auto* owned = new std::vector<T>(std::move(values));
+    py::capsule owner(owned, [](void* p) { delete static_cast<std::vector<T>*>(p); });
+    return py::array_t<T>(shape, owned->data(), owner);
+}
+
+template <class T>
+py::array_t<T> toArray(std::vector<T>&& values) {
+    py::ssize_t size = static_cast<py::ssize_t>(values.size());
+    return toArray(std::move(values), { size });
+}
+
+// Flat batch as (ids, offsets): the IDs of item i are ids[offsets[i]:offsets[i + 1]].
+py::tuple toArrays(EncodedBuffer&& buffer) {
+    return py::make_tuple(toArray(std::move(buffer.ids)), toArray(std::move(buffer.offsets)));
+}
+
+// Same for the bytes of a std::string, as a uint8 array.
+py::array_t<uint8_t> toArray(std::string&& bytes) {
+    auto* owned = new std::string(std::move(bytes));
+    py::capsule owner(owned, [](void* p) { delete static_cast<std::string*>(p); });
+    return py::array_t<uint8_t>({ static_cast<py::ssize_t>(owned->size()) }, reinterpret_cast<const uint8_t*>(owned->data()), owner);
+}
+
+template <class T>
+T* fromCapsule(py::handle capsule, const char* name) {
+    void* pointer = PyCapsule_GetPointer(capsule.ptr(), name);
+    if (!pointer) throw py::error_already_set();
+    return static_cast<T*>(pointer);
+}
+
+struct ReleaseArrow {
+    void operator()(ArrowSchema* schema) const {
+        if (schema->release) schema->release(schema);
+        delete schema;
+    }
+
+    void operator()(ArrowArray* array) const {
+        if (array->release) array->release(array);
+        delete array;
+    }
+};
+
+// Borrows the UTF-8 bytes of a batch of Python texts so C++ can read them without the GIL.
+// Accepted: any Arrow string array or chunked array (pyarrow, polars, pandas with Arrow strings)
+// through the Arrow PyCapsule Interface, a sequence of str/bytes, or a 1-D NumPy array of dtype
+// object, bytes ('S') or str ('U'). Arrow buffers and 'S' arrays are read in place and str objects
+// expose their UTF-8 form directly (created and cached once for non-ASCII text); only 'U' arrays,
+// which NumPy stores as UTF-32, are encoded into copies.
+class TextBatch {
+private:
+    py::object owner;                       // Keeps the borrowed items alive while the GIL is released.
+    std::deque<std::string> encoded;
+    std::unique_ptr<ArrowSchema, ReleaseArrow> streamSchema;   // Pulled from an Arrow stream, released with the batch.
+    std::vector<std::unique_ptr<ArrowArray, ReleaseArrow>> streamChunks;
+
+    bool addArrow(py::handle texts) {
+        if (py::hasattr(texts, "__arrow_c_array__")) {
+            py::tuple capsules = texts.attr("__arrow_c_array__")();
+            owner = capsules;
+            views = Arrow::importStrings(*fromCapsule<ArrowSchema>(capsules[0], "arrow_schema"), *fromCapsule<ArrowArray>(capsules[1], "arrow_array"));
+            return true;
+        }
+        if (py::hasattr(texts, "__arrow_c_stream__")) {
+            owner = texts.attr("__arrow_c_stream__")();
+            auto* stream = fromCapsule<ArrowArrayStream>(owner, "arrow_array_stream");
+            streamSchema.reset(new ArrowSchema());
+            auto fail = [stream]() {
+                const char* error = stream->get_last_error(stream);
+                throw std::runtime_error(std::string("Arrow stream: ") + (error ? error : "unknown error"));
+            };
+            if (stream->get_schema(stream, streamSchema.get()) != 0) fail();
+            while (true) {
+                std::unique_ptr<ArrowArray, ReleaseArrow> chunk(new ArrowArray());
+                if (stream->get_next(stream, chunk.get()) != 0) fail();
+                if (!chunk->release) break;
+                streamChunks.push_back(std::move(chunk));
+                auto chunkViews = Arrow::importStrings(*streamSchema, *streamChunks.back());
+                views.insert(views.end(), chunkViews.begin(), chunkViews.end());
+            }
+            return true;
+        }
+        return false;
+    }
+
+    void add(py::handle item) {
+        Py_ssize_t size = 0;
+        if (PyUnicode_Check(item.ptr())) {
+            const char* data = PyUnicode_AsUTF8AndSize(item.ptr(), &size);
+            if (!data) throw py::error_already_set();
+            views.emplace_back(data, static_cast<size_t>(size));
+        }
+        else if (PyBytes_Check(item.ptr())) {
+            char* data = nullptr;
+            if (PyBytes_AsStringAndSize(item.ptr(), &data, &size) != 0) throw py::error_already_set();
+            views.emplace_back(data, static_cast<size_t>(size));
+        }
+        else {
+            throw py::type_error("expected str or bytes items, got " + std::string(py::str(py::type::of(item))));
+        }
+    }
+
+public:
+    std::vector<std::string_view> views;
+
+    explicit TextBatch(py::handle texts) {
+        if (addArrow(texts)) return;
+
+        if (py::isinstance<py::array>(texts)) {
+            auto array = py::reinterpret_borrow<py::array>(texts);
+            if (array.ndim() != 1) throw py::value_error("expected a 1-D array of strings");
+            char kind = array.dtype().kind();
+            if (kind == 'S') {
+                owner = array;
+                size_t width = static_cast<size_t>(array.itemsize());
+                const char* base = static_cast<const char*>(array.data());
+                for (py::ssize_t i = 0; i < array.shape(0); ++i) {
+                    const char* item = base + i * array.strides(0);
+                    views.emplace_back(item, strnlen(item, width));     // Items are NUL-padded to the width.
+                }
+                return;
+            }
+            if (kind == 'U') {
+                for (auto item : array) {
+                    encoded.push_back(py::str(item).cast<std::string>());
+                    views.emplace_back(encoded.back());
+                }
+                return;
+            }
+            if (kind != 'O') throw py::type_error("expected an array of dtype object, 'S' or 'U'");
+        }
+
+        // A new list holds a reference to every item, so the texts stay alive even if the caller's
+        // container changes while the batch runs.
+        auto items = py::reinterpret_steal<py::list>(PySequence_List(texts.ptr()));
+        if (!items) throw py::error_already_set();
+        owner = items;
+        views.reserve(items.size());
+        for (auto item : items) {
+            add(item);
+        }
+    }
+
+    TextBatch(const TextBatch&) = delete;
+    TextBatch& operator=(const TextBatch&) = delete;
+};
+
+// A result column in Arrow layout. Consumers such as pyarrow.array(result) or polars.Series(result)
+// take its buffers over through the Arrow PyCapsule Interface without copying them.
+class ArrowColumn {
+private:
+    // A consumer that takes the data over marks the struct released, so only unclaimed data is freed here.
+    static void releaseSchemaCapsule(PyObject* capsule) {
+        ReleaseArrow()(static_cast<ArrowSchema*>(PyCapsule_GetPointer(capsule, "arrow_schema")));
+    }
+
+    static void releaseArrayCapsule(PyObject* capsule) {
+        ReleaseArrow()(static_cast<ArrowArray*>(PyCapsule_GetPointer(capsule, "arrow_array")));
+    }
+
+public:
+    ArrowSchema schema{};
+    ArrowArray array{};
+
+    ArrowColumn() = default;
+    ArrowColumn(const ArrowColumn&) = delete;
+    ArrowColumn& operator=(const ArrowColumn&) = delete;
+
+    ~ArrowColumn() {
+        if (array.release) array.release(&array);
+        if (schema.release) schema.release(&schema);
+    }
+
+    int64_t length() const { return array.release ? array.length : 0; }
+
+    py::tuple capsules(py::object requestedSchema) {
+        // The column has one layout; requested_schema is only a hint in the protocol and is ignored.
+        if (!array.release) throw py::value_error("this Arrow column was already handed over");
+
+        auto* schemaCopy = new ArrowSchema(schema);
+        schema.release = nullptr;
+        py::capsule schemaCapsule(schemaCopy, "arrow_schema", &releaseSchemaCapsule);
+
+        auto* arrayCopy = new ArrowArray(array);
+        array.release = nullptr;
+        py::capsule arrayCapsule(arrayCopy, "arrow_array", &releaseArrayCapsule);
+
+        return py::make_tuple(schemaCapsule, arrayCapsule);
+    }
+};
+
+// A consumer that takes the tensor over renames the capsule to "used_dltensor", so only an
+// unclaimed export is freed here.
+void releaseDLPackCapsule(PyObject* capsule) {
+    if (!PyCapsule_IsValid(capsule, "dltensor")) return;
+    auto* managed = static_cast<DLManagedTensor*>(PyCapsule_GetPointer(capsule, "dltensor"));
+    if (managed->deleter) managed->deleter(managed);
+}
+
+py::capsule toDLPackCapsule(const HostTensor& tensor, py::object dlDevice, py::object copy) {
+    // Host memory needs no stream; any other target device has to be reached by copying outside DLPack.
+    if (!dlDevice.is_none() && dlDevice.cast<std::pair<int, int>>() != std::make_pair(static_cast<int>(kDLCPU), 0)) {
+        PyErr_SetString(PyExc_BufferError, "Tensor lives in host memory and can only be exported to the CPU.");
+        throw py::error_already_set();
+    }
+    return py::capsule(tensor.toDLPack(!copy.is_none() && copy.cast<bool>()), "dltensor", &releaseDLPackCapsule);
+}
+
+std::unique_ptr<DocumentStream> openStream(const std::vector<std::string>& paths, const Tokenizer* tokenizer, int numThreads, size_t batchDocuments,
+    size_t prefetch, std::optional<size_t> maxLength, const std::string& format, const std::string& jsonField) {
+    DocumentStreamOptions options;
+    if (format == "jsonl") {
+        options.format = InputFormat::JSONL;
+    }
+    else if (format != "text") {
+        throw py::value_error("format must be 'text' or 'jsonl'");
+    }
+    options.jsonField = jsonField;
+    options.batchDocuments = batchDocuments;
+    options.prefetchBatches = prefetch;
+    options.numThreads = numThreads;
+    options.maxLength = maxLength.value_or(SIZE_MAX);
+    return tokenizer ? std::make_unique<DocumentStream>(paths, *tokenizer, options) : std::make_unique<DocumentStream>(paths, options);
+}
+
+py::str decodeUtf8(std::string_view text) {
+    PyObject* result = PyUnicode_DecodeUTF8(text.data(), static_cast<Py_ssize_t>(text.size()), "replace");
+    if (!result) throw py::error_already_set();
+    return py::reinterpret_steal<py::str>(result);
+}
+
+// Bind Toolkit methods
+void bindToolkit(py::module_& m) {
+    py::class_<ArrowColumn>(m, "ArrowColumn")
+        .def("__arrow_c_array__", &ArrowColumn::capsules, py::arg("requested_schema") = py::none())
+        .def("__len__", &ArrowColumn::length);
+
+    py::class_<HostTensor>(m, "Tensor")
+        .def("__dlpack__", [](const HostTensor& tensor, py::object /*stream*/, py::object /*maxVersion*/, py::object dlDevice, py::object copy) {
+            return toDLPackCapsule(tensor, dlDevice, copy);
+            }, py::kw_only(), py::arg("stream") = py::none(), py::arg("max_version") = py::none(), py::arg("dl_device") = py::none(), py::arg("copy") = py::none(),
+            "Export the tensor as a DLPack capsule sharing its memory")
+        .def("__dlpack_device__", [](const HostTensor&) {
+            return py::make_tuple(static_cast<int>(kDLCPU), 0);
+            })
+        .def_property_readonly("shape", [](const HostTensor& tensor) {
+            return py::tuple(py::cast(tensor.getShape()));
+            });
+
+    // Iterating waits for the next batch without the GIL; the files are read and processed meanwhile.
+    py::class_<DocumentStream>(m, "DocumentStream")
+        .def("__iter__", [](DocumentStream& stream) -> DocumentStream& { return stream; })
+        .def("__next__", [](DocumentStream& stream) -> py::tuple {
+            DocumentBatch batch;
+            bool more;
+            {
+                py::gil_scoped_release release;
+                more = stream.next(batch);
+            }
+            if (!more) throw py::stop_iteration();
+            if (stream.encodes()) {
+                return toArrays(std::move(batch.encoded));
+            }
+            return py::make_tuple(toArray(std::move(batch.tokens.tokens.data)), toArray(std::move(batch.tokens.tokens.offsets)),
+                toArray(std::move(batch.tokens.textOffsets)));
+            });
+
+    // Records only when the library was built with NLP_ENABLE_TRACING; otherwise the trace stays empty.
+    py::class_<Trace>(m, "Trace")
+        .def_static("start", &Trace::start, py::arg("eventsPerThread") = 65536, "Start recording trace zones")
+        .def_static("stop", &Trace::stop, "Stop recording trace zones")
+        .def_static("isRecording", &Trace::isRecording)
+        .def_static("clear", &Trace::clear, "Drop the recorded events")
+        .def_static("toJson", &Trace::toJson, "The recorded events as Chrome trace JSON")
+        .def_static("dump", &Trace::dump, py::arg("path"), releaseGil(),
+            "Write the recorded events as Chrome trace JSON, for chrome://tracing or ui.perfetto.dev");
+
+    py::class_<LatencyHistogram>(m, "LatencyHistogram")
+        .def_readonly("count", &LatencyHistogram::count)
+        .def_readonly("sumNs", &LatencyHistogram::sumNs)
+        .def_readonly("maxNs", &LatencyHistogram::maxNs)
+        .def("meanNs", &LatencyHistogram::meanNs)
+        .def("percentileNs", &LatencyHistogram::percentileNs, py::arg("percentile"), "Upper bound of the bucket holding the percentile (0-100)");
+
+    py::class_<OperationSnapshot>(m, "OperationSnapshot")
+        .def_readonly("name", &OperationSnapshot::name)
+        .def_readonly("calls", &OperationSnapshot::calls)
+        .def_readonly("items", &OperationSnapshot::items)
+        .def_readonly("bytes", &OperationSnapshot::bytes)
+        .def_readonly("unknownTokens", &OperationSnapshot::unknownTokens)
+        .def_readonly("stopWordsRemoved", &OperationSnapshot::stopWordsRemoved)
+        .def_readonly("allocations", &OperationSnapshot::allocations)
+        .def_readonly("allocatedBytes", &OperationSnapshot::allocatedBytes)
+        .def_readonly("latency", &OperationSnapshot::latency);
+
+    py::class_<Metrics>(m, "Metrics")
+        .def_static("snapshot", &Metrics::snapshot, "Counters and latency histogram of every operation called so far")
+        .def_static("reset", &Metrics::reset)
+        .def_static("toPrometheus", &Metrics::toPrometheus, "The metrics in the Prometheus text format")
+        .def_static("writePrometheus", &Metrics::writePrometheus, py::arg("path"), releaseGil())
+        .def_static("startExporter", [](const std::string& path, double intervalSeconds) {
+            Metrics::startExporter(path, std::chrono::milliseconds(static_cast<long long>(intervalSeconds * 1000)));
+            }, py::arg("path"), py::arg("intervalSeconds") = 15.0, "Rewrite a Prometheus text file periodically from a background thread")
+        .def_static("stopExporter", &Metrics::stopExporter, releaseGil());
+
+    // The process-wide pool (SymbolTable::global()) that the symbol functions of Toolkit and Tokenizer use.
+    py::class_<SymbolTable, std::unique_ptr<SymbolTable, py::nodelete>>(m, "SymbolTable")
+        .def_static("intern", [](const std::string& text) { return SymbolTable::global().intern(text); }, py::arg("text"),
+            "The symbol of a string, adding it to the pool if needed")
+        .def_static("find", [](const std::string& text) -> py::object {
+            uint32_t symbol = SymbolTable::global().find(text);
+            return symbol == SymbolTable::npos ? py::none() : py::cast(symbol);
+            }, py::arg("text"), "The symbol of a string, or None if it was never interned")
+        .def_static("str", [](uint32_t symbol) {
+            if (symbol >= SymbolTable::global().size()) throw py::index_error("Unknown symbol");
+            return std::string(SymbolTable::global().str(symbol));
+            }, py::arg("symbol"), "The string of a symbol")
+        .def_static("size", []() { return SymbolTable::global().size(); });
+
+    py::class_<Toolkit>(m, "Toolkit")
+        .def_static("tokenize", [](const std::string& text, std::optional<size_t> maxTokens, const std::string& logFile) {
+            return maxTokens ? Toolkit::tokenize(text, *maxTokens, logFile) : Toolkit::tokenize(text, logFile);
+            }, py::arg("text"), py::arg("maxTokens") = py::none(), py::arg("logFile") = "", releaseGil(),
+            "Tokenize a string into words, optionally stopping after maxTokens words")
+        .def_static("countTokens", &Toolkit::countTokens, py::arg("text"), py::arg("logFile") = "", releaseGil(),
+            "Count the words tokenize would return")
+        .def_static("batchCountTokens", [](const std::vector<std::string>& texts, int numThreads, const std::string& logFile) {
+            std::vector<size_t> counts;
+            {
+                py::gil_scoped_release release;
+                counts = Toolkit::batchCountTokens(texts, numThreads, logFile);
+            }
+            return toArray(std::move(counts));
+            }, py::arg("texts"), py::arg("numThreads") = 2, py::arg("logFile") = "",
+            "Count the words of a batch of strings using multiple threads, as a NumPy array")
+        .def_static("tokenize_batch", [](py::handle texts, int numThreads) {
+            TextBatch batch(texts);
+            TokenizedBatch tokenized;
+            {
+                py::gil_scoped_release release;
+                tokenized = Toolkit::batchTokenize(batch.views, numThreads, "");
+            }
+            py::list tokens(tokenized.tokens.size());
+            for (size_t i = 0; i < tokenized.tokens.size(); ++i) {
+                tokens[i] = decodeUtf8(tokenized.tokens.at(i));
+            }
+            return py::make_tuple(tokens, toArray(std::move(tokenized.textOffsets)));
+            }, py::arg("texts"), py::arg("numThreads") = 2,
+            "Tokenize a batch of texts (list of str/bytes or NumPy string array) as (flat tokens, offsets); "
+            "the tokens of text i are tokens[offsets[i]:offsets[i + 1]]")
+        .def_static("normalize_batch", [](py::handle texts, bool lower, bool removePunctuation, int numThreads) {
+            TextBatch batch(texts);
+            StringBatch normalized;
+            {
+                py::gil_scoped_release release;
+                normalized = Toolkit::batchNormalize(batch.views, lower, removePunctuation, numThreads, "");
+            }
+            py::list results(normalized.size());
+            for (size_t i = 0; i < normalized.size(); ++i) {
+                results[i] = decodeUtf8(normalized.at(i));
+            }
+            return results;
+            }, py::arg("texts"), py::arg("lower") = true, py::arg("removePunctuation") = true, py::arg("numThreads") = 2,
+            "Lowercase and strip punctuation from a batch of texts (list of str/bytes or NumPy string array)")
+        .def_static("tokenize_arrow", [](py::handle texts, int numThreads) {
+            TextBatch batch(texts);
+            auto column = std::make_unique<ArrowColumn>();
+            {
+                py::gil_scoped_release release;
+                Arrow::exportLists(Toolkit::batchTokenize(batch.views, numThreads, ""), &column->schema, &column->array);
+            }
+            return column;
+            }, py::arg("texts"), py::arg("numThreads") = 2,
+            "Tokenize a batch of texts (Arrow string array, list or NumPy array) into an Arrow large_list<large_utf8> column")
+        .def_static("normalize_arrow", [](py::handle texts, bool lower, bool removePunctuation, int numThreads) {
+            TextBatch batch(texts);
+            auto column = std::make_unique<ArrowColumn>();
+            {
+                py::gil_scoped_release release;
+                Arrow::exportStrings(Toolkit::batchNormalize(batch.views, lower, removePunctuation, numThreads, ""), &column->schema, &column->array);
+            }
+            return column;
+            }, py::arg("texts"), py::arg("lower") = true, py::arg("removePunctuation") = true, py::arg("numThreads") = 2,
+            "Normalize a batch of texts into an Arrow large_utf8 column")
+        .def_static("tokenize_files", [](const std::vector<std::string>& paths, int numThreads, size_t batchDocuments, size_t prefetch, const std::string& format, const std::string& jsonField) {
+            return openStream(paths, nullptr, numThreads, batchDocuments, prefetch, std::nullopt, format, jsonField);
+            }, py::arg("paths"), py::arg("numThreads") = 2, py::arg("batchDocuments") = 1024, py::arg("prefetch") = 4, py::arg("format") = "text", py::arg("jsonField") = "text",
+            "Stream text/JSONL files as batches of NumPy arrays (bytes, tokenOffsets, documentOffsets), read and tokenized in the background")
+        .def_static("toLower", &Toolkit::toLower, py::arg("text"), py::arg("logFile") = "", releaseGil(),
+            "Convert string to lowercase")
+        .def_static("removePunctuation", &Toolkit::removePunctuation, py::arg("text"), py::arg("logFile") = "", releaseGil(),
+            "Remove punctuation from a string")
+        .def_static("getBagOfWords", py::overload_cast<const std::vector<std::string>&, int, const std::string&>(&Toolkit::getBagOfWords), py::arg("tokens"), py::arg("numThreads") = 2, py::arg("logFile") = "", releaseGil(),
+            "Generate bag of words from tokens")
+        .def_static("getBagOfWordsArray", [](const std::vector<std::string>& tokens, int numThreads, const std::string& logFile) {
+            std::vector<std::string> words;
+            std::vector<int> counts;
+            {
+                py::gil_scoped_release release;
+                auto bag = Toolkit::getBagOfWords(tokens, numThreads, logFile);
+                words.reserve(bag.size());
+                counts.reserve(bag.size());
+                for (auto& [word, count] : bag) {
+                    words.push_back(word);
+                    counts.push_back(count);
+                }
+            }
+            return py::make_tuple(words, toArray(std::move(counts)));
+            }, py::arg("tokens"), py::arg("numThreads") = 2, py::arg("logFile") = "",
+            "Generate bag of words from tokens as (words, counts NumPy array)")
+        .def_static("tokenizeToSymbols", &Toolkit::tokenizeToSymbols, py::arg("text"), py::arg("logFile") = "", releaseGil(),
+            "Tokenize a string into interned symbols")
+        .def_static("getBagOfSymbols", &Toolkit::getBagOfSymbols, py::arg("symbols"), py::arg("numThreads") = 2, py::arg("logFile") = "", releaseGil(),
+            "Generate bag of words keyed by symbol")
+        .def_static("getSymbolNGrams", &Toolkit::getSymbolNGrams, py::arg("symbols"), py::arg("n"), py::arg("logFile") = "", releaseGil(),
+            "Generate the symbols of the n-grams of a symbol sequence")
+        .def_static("getNGrams", py::overload_cast<const std::vector<std::string>&, int, const std::string&>(&Toolkit::getNGrams), py::arg("tokens"), py::arg("n"), py::arg("logFile") = "", releaseGil(),
+            "Generate n-grams from tokens")
+        .def_static("stem", &Toolkit::stem, py::arg("word"), py::arg("logFile") = "", releaseGil(),
+            "Stem a word")
+        .def_static("getEmbeddings", &Toolkit::getEmbeddings, py::arg("tokens"), py::arg("embeddingSize") = 300, py::arg("numThreads") = 2, py::arg("logFile") = "", releaseGil(),
+            "Generate random embeddings for tokens")
+        .def_static("getEmbeddingMatrix", [](const std::vector<std::string>& tokens, size_t embeddingSize, int numThreads, const std::string& logFile) {
+            EmbeddingMatrix matrix;
+            {
+                py::gil_scoped_release release;
+                matrix = Toolkit::getEmbeddingMatrix(tokens, embeddingSize, numThreads, logFile);
+            }
+            py::ssize_t rows = static_cast<py::ssize_t>(matrix.tokens.size());
+            py::ssize_t columns = static_cast<py::ssize_t>(matrix.dimension);
+            return py::make_tuple(matrix.tokens, toArray(std::move(matrix.values), { rows, columns }));
+            }, py::arg("tokens"), py::arg("embeddingSize") = 300, py::arg("numThreads") = 2, py::arg("logFile") = "",
+            "Generate random embeddings as (tokens, float32 NumPy matrix with one row per token)")
+        .def_static("getEmbeddingTable", [](const std::vector<std::string>& tokens, size_t embeddingSize, int numThreads, const std::string& logFile) {
+            EmbeddingMatrix matrix;
+            {
+                py::gil_scoped_release release;
+                matrix = Toolkit::getEmbeddingMatrix(tokens, embeddingSize, numThreads, logFile);
+            }
+            std::vector<int64_t> shape = { static_cast<int64_t>(matrix.tokens.size()), static_cast<int64_t>(matrix.dimension) };
+            return py::make_tuple(matrix.tokens, HostTensor(std::move(matrix.values), shape));
+            }, py::arg("tokens"), py::arg("embeddingSize") = 300, py::arg("numThreads") = 2, py::arg("logFile") = "",
+            "Generate random embeddings as (tokens, float32 DLPack Tensor with one row per token)")
+        .def_static("removeSpecialCharacters", &Toolkit::removeSpecialCharacters, py::arg("text"), py::arg("specialCharFile"), py::arg("numThreads") = 2, py::arg("logFile") = "", releaseGil(),
+            "Remove the characters listed in specialCharFile from a string")
+        .def_static("removeStopWords", &Toolkit::removeStopWords, py::arg("text"), py::arg("stopWordsFile"), py::arg("numThreads") = 2, py::arg("logFile") = "", releaseGil(),
+            "Remove the words listed in stopWordsFile from a string");
+}
+
+std::unique_ptr<Tokenizer> tokenizerFromBytes(const py::bytes& data) {
+    char* buffer = nullptr;
+    Py_ssize_t length = 0;
+    if (PyBytes_AsStringAndSize(data.ptr(), &buffer, &length) != 0) {
+        throw py::error_already_set();
+    }
+    py::gil_scoped_release release;
+    return Tokenizer::deserialize(std::string_view(buffer, static_cast<size_t>(length)));
+}
+
+// Bind Tokenizer methods
+void bindTokenizer(py::module_& m) {
+    py::class_<DetokenizeOptions>(m, "DetokenizeOptions")
+        .def(py::init<>())
+        .def_readwrite("continuationPrefix", &DetokenizeOptions::continuationPrefix)
+        .def_readwrite("spaceMarker", &DetokenizeOptions::spaceMarker)
+        .def_readwrite("attachPunctuation", &DetokenizeOptions::attachPunctuation);
+
+    py::class_<Tokenizer>(m, "Tokenizer")
+        .def(py::init<const std::vector<std::string>&, const std::vector<std::string>&>(), py::arg("vocab"), py::arg("specialTokens") = std::vector<std::string>(),
+            "Initialize a Tokenizer with a vocabulary and optional special tokens")
+        .def("encode", [](const Tokenizer& tokenizer, const std::vector<std::string>& tokens, std::optional<size_t> maxLength, const std::string& logFile) {
+            return tokenizer.encode(tokens, maxLength.value_or(SIZE_MAX), logFile);
+            }, py::arg("tokens"), py::arg("maxLength") = py::none(), py::arg("logFile") = "", releaseGil(),
+            "Encode a list of tokens into their corresponding IDs")
+        .def("encodeSymbols", &Tokenizer::encodeSymbols, py::arg("symbols"), py::arg("logFile") = "", releaseGil(),
+            "Encode interned symbols into their corresponding IDs")
+        .def("decode", &Tokenizer::decode, py::arg("ids"), py::arg("logFile") = "", releaseGil(),
+            "Decode a list of IDs into their corresponding tokens")
+        .def("batchEncode", [](const Tokenizer& tokenizer, const std::vector<std::vector<std::string>>& sentences, int numThreads, std::optional<size_t> maxLength, const std::string& logFile) {
+            return tokenizer.batchEncode(sentences, numThreads, maxLength.value_or(SIZE_MAX), logFile);
+            }, py::arg("sentences"), py::arg("numThreads") = 2, py::arg("maxLength") = py::none(), py::arg("logFile") = "", releaseGil(),
+            "Encode a batch of sentences using multiple threads")
+        .def("batchEncodeArray", [](const Tokenizer& tokenizer, const std::vector<std::vector<std::string>>& sentences, int numThreads, std::optional<size_t> maxLength, const std::string& logFile) {
+            EncodedBuffer buffer;
+            {
+                py::gil_scoped_release release;
+                buffer = tokenizer.batchEncodeToBuffer(sentences, numThreads, maxLength.value_or(SIZE_MAX), logFile);
+            }
+            return toArrays(std::move(buffer));
+            }, py::arg("sentences"), py::arg("numThreads") = 2, py::arg("maxLength") = py::none(), py::arg("logFile") = "",
+            "Encode a batch of sentences into flat NumPy arrays (ids, offsets) without copying")
+        .def("batchDecode", &Tokenizer::batchDecode, py::arg("encodedSentences"), py::arg("numThreads") = 2, py::arg("logFile") = "", releaseGil(),
+            "Decode a batch of encoded sentences using multiple threads")
+        .def("decodeToString", &Tokenizer::decodeToString, py::arg("ids"), py::arg("options") = DetokenizeOptions(), py::arg("logFile") = "", releaseGil(),
+            "Decode a list of IDs into one string")
+        .def("batchDecodeToString", &Tokenizer::batchDecodeToString, py::arg("encodedSentences"), py::arg("numThreads") = 2, py::arg("options") = DetokenizeOptions(), py::arg("logFile") = "", releaseGil(),
+            "Decode a batch of encoded sentences into strings using multiple threads")
+        .def("encodeText", [](const Tokenizer& tokenizer, const std::string& text, std::optional<size_t> maxLength, const std::string& logFile) {
+            return tokenizer.encodeText(text, maxLength.value_or(SIZE_MAX), logFile);
+            }, py::arg("text"), py::arg("maxLength") = py::none(), py::arg("logFile") = "", releaseGil(),
+            "Encode raw text, keeping special tokens whole")
+        .def("batchEncodeText", [](const Tokenizer& tokenizer, const std::vector<std::string>& texts, int numThreads, std::optional<size_t> maxLength, const std::string& logFile) {
+            return tokenizer.batchEncodeText(texts, numThreads, maxLength.value_or(SIZE_MAX), logFile);
+            }, py::arg("texts"), py::arg("numThreads") = 2, py::arg("maxLength") = py::none(), py::arg("logFile") = "", releaseGil(),
+            "Encode a batch of raw texts using multiple threads")
+        .def("batchEncodeTextArray", [](const Tokenizer& tokenizer, const std::vector<std::string>& texts, int numThreads, std::optional<size_t> maxLength, const std::string& logFile) {
+            EncodedBuffer buffer;
+            {
+                py::gil_scoped_release release;
+                buffer = tokenizer.batchEncodeTextToBuffer(texts, numThreads, maxLength.value_or(SIZE_MAX), logFile);
+            }
+            return toArrays(std::move(buffer));
+            }, py::arg("texts"), py::arg("numThreads") = 2, py::arg("maxLength") = py::none(), py::arg("logFile") = "",
+            "Encode a batch of raw texts into flat NumPy arrays (ids, offsets) without copying")
+        .def("encode_texts", [](const Tokenizer& tokenizer, py::handle texts, int numThreads, std::optional<size_t> maxLength) {
+            TextBatch batch(texts);
+            EncodedBuffer buffer;
+            {
+                py::gil_scoped_release release;
+                buffer = tokenizer.batchEncodeTextToBuffer(batch.views, numThreads, maxLength.value_or(SIZE_MAX), "");
+            }
+            return toArrays(std::move(buffer));
+            }, py::arg("texts"), py::arg("numThreads") = 2, py::arg("maxLength") = py::none(),
+            "Encode a batch of raw texts (list of str/bytes or NumPy string array) into flat NumPy arrays (ids, offsets)")
+        .def("encode_texts_arrow", [](const Tokenizer& tokenizer, py::handle texts, int numThreads, std::optional<size_t> maxLength) {
+            TextBatch batch(texts);
+            auto column = std::make_unique<ArrowColumn>();
+            {
+                py::gil_scoped_release release;
+                Arrow::exportLists(tokenizer.batchEncodeTextToBuffer(batch.views, numThreads, maxLength.value_or(SIZE_MAX), ""), &column->schema, &column->array);
+            }
+            return column;
+            }, py::arg("texts"), py::arg("numThreads") = 2, py::arg("maxLength") = py::none(),
+            "Encode a batch of raw texts into an Arrow large_list<int32> column")
+        .def("encode_texts_padded", [](const Tokenizer& tokenizer, py::handle texts, int numThreads, std::optional<size_t> maxLength, int padId) {
+            TextBatch batch(texts);
+            PaddedBatch padded;
+            {
+                py::gil_scoped_release release;
+                padded = tokenizer.batchEncodeTextPadded(batch.views, numThreads, maxLength.value_or(SIZE_MAX), padId, "");
+            }
+            std::vector<int64_t> shape = { static_cast<int64_t>(padded.rows), static_cast<int64_t>(padded.columns) };
+            return py::make_tuple(HostTensor(std::move(padded.ids), shape), HostTensor(std::move(padded.attentionMask), shape));
+            }, py::arg("texts"), py::arg("numThreads") = 2, py::arg("maxLength") = py::none(), py::arg("padId") = 0,
+            "Encode a batch of raw texts into padded (ids, attention_mask) int32 DLPack Tensors")
+        .def("encode_files", [](const Tokenizer& tokenizer, const std::vector<std::string>& paths, int numThreads, size_t batchDocuments, size_t prefetch, std::optional<size_t> maxLength, const std::string& format, const std::string& jsonField) {
+            return openStream(paths, &tokenizer, numThreads, batchDocuments, prefetch, maxLength, format, jsonField);
+            }, py::arg("paths"), py::arg("numThreads") = 2, py::arg("batchDocuments") = 1024, py::arg("prefetch") = 4, py::arg("maxLength") = py::none(), py::arg("format") = "text", py::arg("jsonField") = "text",
+            py::keep_alive<0, 1>(),
+            "Stream text/JSONL files as batches of NumPy arrays (ids, offsets), read and encoded in the background")
+        .def("countTokens", &Tokenizer::countTokens, py::arg("text"), py::arg("logFile") = "", releaseGil(),
+            "Count the IDs encodeText would return")
+        .def("batchCountTokens", [](const Tokenizer& tokenizer, const std::vector<std::string>& texts, int numThreads, const std::string& logFile) {
+            std::vector<size_t> counts;
+            {
+                py::gil_scoped_release release;
+                counts = tokenizer.batchCountTokens(texts, numThreads, logFile);
+            }
+            return toArray(std::move(counts));
+            }, py::arg("texts"), py::arg("numThreads") = 2, py::arg("logFile") = "",
+            "Count the IDs of a batch of raw texts using multiple threads, as a NumPy array")
+        .def("addTokens", &Tokenizer::addTokens, py::arg("tokens"), releaseGil(),
+            "Add tokens to the vocabulary and return their IDs")
+        .def("addSpecialTokens", &Tokenizer::addSpecialTokens, py::arg("tokens"), releaseGil(),
+            "Add special tokens and return their IDs")
+        .def("getSpecialTokens", &Tokenizer::getSpecialTokens)
+        .def("tokenId", &Tokenizer::tokenId, py::arg("token"))
+        .def("vocabSize", &Tokenizer::vocabSize)
+        .def("serialize", [](const Tokenizer& tokenizer, bool withTable) {
+            std::string image;
+            {
+                py::gil_scoped_release release;
+                image = tokenizer.serialize(withTable);
+            }
+            return py::bytes(image);
+            }, py::arg("withTable") = false,
+            "Serialize the vocabulary and special tokens to a compact binary image")
+        .def_static("deserialize", &tokenizerFromBytes, py::arg("data"),
+            "Build a Tokenizer from an image written by serialize")
+        .def("shareMemory", &Tokenizer::shareMemory, py::arg("name"), releaseGil(),
+            "Move the vocabulary into a new POSIX shared-memory segment; pickles then attach to it instead of copying")
+        .def("sharedMemoryName", &Tokenizer::sharedMemoryName,
+            "Segment the vocabulary is read from, or '' if it is private")
+        .def_static("attachSharedMemory", &Tokenizer::attachSharedMemory, py::arg("name"), releaseGil(),
+            "Build a Tokenizer that reads the vocabulary from a segment created by shareMemory")
+        .def_static("unlinkSharedMemory", &Tokenizer::unlinkSharedMemory, py::arg("name"),
+            "Remove a shared-memory segment; attached tokenizers keep working")
+        // Pickles carry the binary image, or only the segment name once the tokenizer is in shared
+        // memory, so multiprocessing workers attach to one copy of the vocabulary.
+        .def(py::pickle(
+            [](const Tokenizer& tokenizer) {
+                std::string name = tokenizer.sharedMemoryName();
+                if (!name.empty()) {
+                    return py::make_tuple("shm", name);
+                }
+                std::string image;
+                {
+                    py::gil_scoped_release release;
+                    image = tokenizer.serialize();
+                }
+                return py::make_tuple("bytes", py::bytes(image));
+            },
+            [](const py::tuple& state) {
+                if (state.size() != 2) {
+                    throw std::runtime_error("Invalid Tokenizer pickle state.");
+                }
+                std::string kind = state[0].cast<std::string>();
+                if (kind == "shm") {
+                    std::string name = state[1].cast<std::string>();
+                    py::gil_scoped_release release;
+                    return Tokenizer::attachSharedMemory(name);
+                }
+                if (kind == "bytes") {
+                    return tokenizerFromBytes(state[1].cast<py::bytes>());
+                }
+                throw std::runtime_error("Invalid Tokenizer pickle state.");
+            }));
+}
+
+// Bind Chunker
+void bindChunker(py::module_& m) {
+    py::class_<ChunkerOptions>(m, "ChunkerOptions")
+        .def(py::init<>())
+        .def_readwrite("maxTokens", &ChunkerOptions::maxTokens)
+        .def_readwrite("overlapTokens", &ChunkerOptions::overlapTokens)
+        .def_readwrite("preferSentenceBoundaries", &ChunkerOptions::preferSentenceBoundaries);
+
+    py::class_<Chunk>(m, "Chunk")
+        .def_readonly("tokenBegin", &Chunk::tokenBegin)
+        .def_readonly("tokenEnd", &Chunk::tokenEnd)
+        .def_readonly("charBegin", &Chunk::charBegin)
+        .def_readonly("charEnd", &Chunk::charEnd);
+
+    py::class_<ChunkedDocument>(m, "ChunkedDocument")
+        .def_readonly("ids", &ChunkedDocument::ids)
+        .def_readonly("chunks", &ChunkedDocument::chunks);
+
+    // The Chunker keeps a reference to the Tokenizer, which must stay alive as long as the Chunker.
+    py::class_<Chunker>(m, "Chunker")
+        .def(py::init<const Tokenizer&, const ChunkerOptions&>(), py::arg("tokenizer"), py::arg("options") = ChunkerOptions(), py::keep_alive<1, 2>())
+        .def("chunk", &Chunker::chunk, py::arg("text"), py::arg("logFile") = "", releaseGil(),
+            "Split a document into overlapping token windows")
+        .def("batchChunk", &Chunker::batchChunk, py::arg("texts"), py::arg("numThreads") = 2, py::arg("logFile") = "", releaseGil(),
+            "Split a batch of documents using multiple threads");
+}
+
+// Pybind11 module definition
+PYBIND11_MODULE(pynlptoolkit, m) {
+    m.doc() = "Pybind11 wrapper for Toolkit and Tokenizer";
+
+    bindToolkit(m);
+    bindTokenizer(m);
+    bindChunker(m);
+}